@@ -2,10 +2,12 @@
 #define _BACKGROUND_H_
 
 #include <vector>
+#include <string>
 
 #include "GLES.h"
 #include "Tile.h"
 #include "Animation.h"
+#include "Layer.h"
 
 class Background {
 private:
@@ -15,18 +17,35 @@ private:
   float mixing;
   Tile *lastTile, *currentTile, *queuedTile;
   Animation animation;
+  Layer layer;
+
+  struct LayerContent { // everything background layer depends on, opacity is applied while compositing
+    GLuint textureId;
+    GLuint texture2Id;
+    int textureVersion;
+    int texture2Version;
+    float mixing;
+    std::string name;
+    std::string description;
+    bool operator==(const LayerContent& other) const {
+      return textureId == other.textureId && texture2Id == other.texture2Id && textureVersion == other.textureVersion && texture2Version == other.texture2Version
+             && mixing == other.mixing && name == other.name && description == other.description;
+    }
+  } layerContent;
 
   GLuint samplerLoc  = GL_INVALID_VALUE;
   GLuint sampler2Loc  = GL_INVALID_VALUE;
-  GLint posLoc       = GL_INVALID_VALUE;
-  GLint texLoc       = GL_INVALID_VALUE;
+  GLuint posLoc      = GL_INVALID_VALUE;
+  GLuint texLoc      = GL_INVALID_VALUE;
   GLuint opacityLoc  = GL_INVALID_VALUE;
   GLuint mixingLoc    = GL_INVALID_VALUE;
   GLuint viewportLoc = GL_INVALID_VALUE;
 
   void initGL();
+  void renderBackground(GLuint textureId, GLuint texture2Id);
   void renderNameAndDescription();
   void runBackgroundChangeAnimation();
+  void releaseUnusedTexture(Tile *tile);
   void endAnimation();
 
 public:
@@ -36,6 +55,8 @@ public:
   void setOpacity(float opacity);
   void setSourceTile(Tile *tile);
   float getOpacity();
+  bool isAnimating() { return animation.isActive(); }
+  bool isShown(Tile *tile) { return tile != nullptr && (tile == currentTile || tile == lastTile || tile == queuedTile); } // its background texture is needed
 };
 
 #endif // _BACKGROUND_H_
@@ -0,0 +1,31 @@
+#ifndef _DAMAGE_H_
+#define _DAMAGE_H_
+
+#include <vector>
+
+#include "Utility.h"
+
+class Damage {
+public:
+  struct Region { // in pixels, origin in the bottom-left corner of the viewport (like glScissor and eglSwapBuffersWithDamageKHR)
+    Position<int> position;
+    Size<int> size;
+  };
+
+private:
+  std::vector<Region> regions;
+  bool full;
+
+public:
+  Damage();
+  void add(Position<int> position, Size<int> size);
+  void add(const Damage &other);
+  void addFull();
+  void clear();
+  bool isFull() const { return full; }
+  bool isEmpty() const { return !full && regions.empty(); }
+  Region getBounds() const;
+  std::vector<Region> getRegions() const;
+};
+
+#endif // _DAMAGE_H_
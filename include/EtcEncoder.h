@@ -0,0 +1,45 @@
+#ifndef _ETC_ENCODER_H_
+#define _ETC_ENCODER_H_
+
+#include <vector>
+#include <cstddef>
+
+#include "GLES.h"
+#include "Utility.h"
+
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+// Compresses opaque images to ETC1 blocks, 4 bits per pixel, split over a few threads by rows of blocks.
+// ETC1 blocks are valid ETC2 RGB8 blocks too (T, H and planar modes aren't used), so the same data is uploaded
+// as GL_COMPRESSED_RGB8_ETC2 on GLES3 and as GL_ETC1_RGB8_OES on GLES2 devices with the extension.
+// Quality::Fast takes differential mode whenever it fits, Normal also tries individual mode; both pick modifiers
+// by brightness. High also searches base colors around the average of each half block and picks modifiers by color error.
+class EtcEncoder {
+public:
+  enum class Quality {
+    Fast,
+    Normal,
+    High
+  };
+
+  struct Level {
+    Size<int> size;
+    std::vector<char> data;
+  };
+
+  static size_t getEncodedSize(Size<int> size); // 8 bytes per 4x4 block, partial blocks included
+  static bool isOpaque(const char *pixels, Size<int> size, GLenum format); // ETC1 has no alpha
+  // GL_RGB, GL_RGBA or GL_BGRA_EXT pixels; alpha is dropped
+  static std::vector<char> encode(const char *pixels, Size<int> size, GLenum format, Quality quality, int threads);
+  static std::vector<Level> encodeChain(const char *pixels, Size<int> size, GLenum format, Quality quality, bool mipmaps); // level 0 first
+  static void uploadChain(const std::vector<Level> &levels, GLenum compressedFormat); // to the texture bound on the active unit
+  // encode time in us, kilopixels per second, PSNR in 1/100 dB; returns number of values
+  static int benchmark(Size<int> size, Quality quality, int threads, int *results, int count);
+};
+
+#endif // _ETC_ENCODER_H_
@@ -13,20 +13,17 @@ enum class Format
   Unknown
 };
 
-inline GLuint ConvertFormat(int format)
+inline GLuint ConvertFormat(int format) // GL_NONE for unknown formats, such images aren't uploaded
 {
   switch (static_cast<Format>(format)) {
     case Format::Rgba:
       return GL_RGBA;
     case Format::Bgra:
-#ifndef GL_BGRA_EXT
-#error "GL_BGRA_EXT is not defined"
-#endif
       return GL_BGRA_EXT;
     case Format::Rgb:
       return GL_RGB;
     default:
-      assert(nullptr);
+      return GL_NONE;
   }
 }
 
@@ -52,6 +49,17 @@ struct StoryboardExternData
   long long duration;
 };
 
+struct StoryboardLayoutExternData
+{
+  int sheetCount; // 0 removes the storyboard
+  int columns;
+  int rows;
+  int frameCount;
+  int frameIntervalMs; // media time between frames
+  int previewFrameMs; // tile preview time per frame
+  void (*requestSheet)(int storyboardId, int sheetIndex); // answer with SetStoryboardSheet(), but not SetStoryboard()
+};
+
 struct TileExternData
 {
   int tileId;
@@ -116,4 +124,41 @@ struct SelectionExternData
   int selectedSubOptionId;
 };
 
+struct SubtitleCueExternData
+{
+  int startTime; // ms of media time
+  int endTime;
+  char* text;
+  int textLen;
+};
+
+enum class UiState // flags of JankInfo::uiState
+{
+  Loader = 1 << 0,
+  Menu = 1 << 1,
+  Playback = 1 << 2,
+  SeekPreview = 1 << 3,
+  Options = 1 << 4,
+  Modal = 1 << 5
+};
+
+struct JankInfo
+{
+  float frameMs;
+  float budgetMs;
+  int severe; // 0 if frame took over 1.5x budget, 1 if over 2x budget
+  int uiState;
+};
+
+struct FrameStatsExternData
+{
+  int frames;
+  float p50Ms;
+  float p90Ms;
+  float p99Ms;
+  float maxMs;
+  int jankFrames; // over 1.5x budget, includes severe ones
+  int severeJankFrames; // over 2x budget
+};
+
 #endif // _EXTERN_STRUCTS_H_
@@ -0,0 +1,48 @@
+#ifndef _FRAME_STATS_H_
+#define _FRAME_STATS_H_
+
+#include <vector>
+
+// Histogram of frame durations with log-scaled buckets (BUCKETS_PER_OCTAVE per doubling of duration, starting from MIN_MS),
+// so percentiles have the same relative precision for 8 ms and 800 ms frames.
+class FrameStats {
+public:
+  struct Summary {
+    int frames;
+    float p50;
+    float p90;
+    float p99;
+    float max;
+    int jankFrames;       // over 1.5x budget
+    int severeJankFrames; // over 2x budget
+  };
+
+  enum class Jank {
+    None,
+    Jank,
+    Severe
+  };
+
+private:
+  static constexpr float MIN_MS = 1.0f;
+  static constexpr int BUCKETS_PER_OCTAVE = 8;
+  static constexpr int OCTAVES = 12; // up to ~4 s, longer frames land in the last bucket
+
+  std::vector<unsigned int> histogram;
+  unsigned int frames;
+  float maxMs;
+  unsigned int jankFrames;
+  unsigned int severeJankFrames;
+
+  static int getBucket(float ms);
+  static float getBucketUpperBound(int bucket);
+
+public:
+  FrameStats();
+  Jank add(float ms, float budgetMs);
+  float getPercentile(float percentile); // upper bound of the bucket, in ms
+  Summary getSummary();
+  void reset();
+};
+
+#endif // _FRAME_STATS_H_
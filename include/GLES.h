@@ -2,5 +2,9 @@
 #define _INCLUDE_GLES_
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+
+#ifndef GL_BGRA_EXT
+#define GL_BGRA_EXT 0x80E1 // passed to GL only when GL_EXT_texture_format_BGRA8888 is reported, see PixelConverter
+#endif
 #endif // _INCLUDE_GLES_
 
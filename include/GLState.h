@@ -0,0 +1,115 @@
+#ifndef _GL_STATE_H_
+#define _GL_STATE_H_
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <initializer_list>
+#include <atomic>
+#include <cstddef>
+
+#include "GLES.h"
+
+// Shadows the GL state touched by widgets, so that only real changes reach the driver.
+// All programs, 2D texture bindings, vertex attribute arrays, blending and uniforms have to go through it,
+// otherwise the shadowed state goes out of sync with the context.
+class GLState {
+public:
+  enum class Stat { // counters in the order reported by getStats()
+    Program,
+    Texture,
+    VertexAttrib,
+    Blend,
+    Capability,
+    Uniform,
+    Count
+  };
+
+  struct BlendFunc {
+    GLenum srcRGB;
+    GLenum dstRGB;
+    GLenum srcAlpha;
+    GLenum dstAlpha;
+  };
+
+private:
+  GLState();
+  ~GLState() = default;
+  GLState(const GLState&) = delete;
+  GLState& operator=(const GLState&) = delete;
+
+  static constexpr GLuint UNKNOWN = 0xFFFFFFFF;
+  static constexpr int TEXTURE_UNITS = 8;
+  static constexpr GLuint MAX_ATTRIBS = 32;
+
+  GLuint program;
+  GLuint activeTextureUnit;
+  GLuint textures[TEXTURE_UNITS];
+  unsigned int enabledAttribs; // bit per attribute location
+  bool attribsKnown;
+  GLuint maxAttribs;
+  BlendFunc blend;
+  bool blendKnown;
+  std::map<GLenum, bool> capabilities;
+
+  struct TextureSize {
+    size_t bytes; // level 0
+    bool mipmaps;
+  };
+  std::unordered_map<GLuint, TextureSize> textureSizes; // textures allocated through texImage2D
+  std::atomic<size_t> textureBytes;
+
+  typedef std::unordered_map<GLint, std::vector<GLfloat>> UniformValues;
+  std::unordered_map<GLuint, UniformValues> uniforms; // last values set for each program
+  UniformValues *currentUniforms;
+
+  unsigned int issued[static_cast<int>(Stat::Count)];
+  unsigned int suppressed[static_cast<int>(Stat::Count)];
+
+  bool count(Stat stat, bool changed);
+  bool uniformChanged(GLuint location, const GLfloat *values, int count);
+  void setActiveTextureUnit(GLuint unit);
+  void setTextureBytes(GLuint texture, TextureSize size);
+
+public:
+  static GLState& instance() {
+    static GLState glState;
+    return glState;
+  }
+
+  void invalidate(); // forgets the shadowed state, e.g. after context (re)creation
+  void useProgram(GLuint program);
+  void deleteProgram(GLuint program);
+  void bindTexture(GLuint unit, GLuint texture); // GL_TEXTURE_2D on GL_TEXTURE0 + unit
+  void deleteTexture(GLuint texture);
+  // GL_TEXTURE_2D level 0 of the texture bound on the active unit, with GL_UNSIGNED_BYTE data; keeps track of its size
+  void texImage2D(GLenum format, GLsizei width, GLsizei height, const void *pixels);
+  void generateMipmap();
+  // storage of a texture allocated in another context of the share group, for getTextureBytes()
+  void setTextureStorage(GLuint texture, GLenum format, GLsizei width, GLsizei height, bool mipmaps);
+  static size_t getBytesPerPixel(GLenum format); // of GL_UNSIGNED_BYTE pixels
+  static size_t getImageBytes(GLenum format, GLsizei width, GLsizei height); // compressed formats included
+  size_t getTextureBytes() { return textureBytes.load(std::memory_order_relaxed); } // estimate of texture memory, can be read from any thread
+  size_t getTextureBytes(GLuint texture); // estimate for one texture, including mipmaps
+  void vertexAttribArrays(std::initializer_list<GLuint> locations); // enables exactly these arrays, disables the rest
+  void blendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+  void blendFunc(const BlendFunc &func) { blendFunc(func.srcRGB, func.dstRGB, func.srcAlpha, func.dstAlpha); }
+  BlendFunc getBlendFunc();
+  void enable(GLenum capability);
+  void disable(GLenum capability);
+  bool isEnabled(GLenum capability);
+
+  // uniforms of the program in use
+  void uniform1i(GLuint location, GLint v0);
+  void uniform1f(GLuint location, GLfloat v0);
+  void uniform2f(GLuint location, GLfloat v0, GLfloat v1);
+  void uniform3f(GLuint location, GLfloat v0, GLfloat v1, GLfloat v2);
+  void uniform4f(GLuint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+  void uniform1fv(GLuint location, GLsizei count, const GLfloat *values);
+
+  unsigned int getIssued(Stat stat) { return issued[static_cast<int>(stat)]; }
+  unsigned int getSuppressed(Stat stat) { return suppressed[static_cast<int>(stat)]; }
+  int getStats(int *stats, int count); // {issued, suppressed} pairs for each Stat, returns number of values available
+};
+
+#endif // _GL_STATE_H_
@@ -4,9 +4,12 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <map>
+#include <cstdint>
 
 #include "GLES.h"
 #include "Utility.h"
+#include "RingBuffer.h"
 
 class Graph {
 private:
@@ -15,17 +18,33 @@ private:
   GLuint posLoc;
   GLuint sizLoc;
   GLuint valLoc;
+  GLuint histLoc;
+  GLuint startLoc;
   GLuint opaLoc;
 
-  static constexpr int VALUES = 100;
+  static constexpr int MAX_ROW_LENGTH = 1024; // longer histories wrap into next texture rows
+
+  // samples of a trace normalized to [0, 1] and stored as 16-bit fixed point in R and G channels of RGBA8 texture,
+  // sample with absolute index n lives in texel n % capacity, so only new samples need to be uploaded
+  class History {
+  public:
+    GLuint textureId;
+    Size<int> textureSize;
+    int capacity;
+    uint64_t uploaded; // absolute index of the first sample which isn't in the texture yet
+    std::pair<float, float> minMax;
+  };
+  std::map<int, History> histories; // by trace id
 
   void initialize();
+  History& getHistory(int traceId, int capacity);
+  void upload(History &history, const RingBuffer<float> &values, const std::pair<float, float> &minMax);
   inline float clamp(const float v, const float lo, const float hi) { return v < lo ? lo : v > hi ? hi : v; }
 
 public:
   Graph();
   ~Graph();
-  void render(const std::vector<float> &values, const std::pair<float, float> &minMax, const Position<int> &position, const Size<int> &size);
+  void render(int traceId, const RingBuffer<float> &values, const std::pair<float, float> &minMax, const Position<int> &position, const Size<int> &size);
 };
 
 #endif // _GRAPH_H_
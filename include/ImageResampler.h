@@ -0,0 +1,19 @@
+#ifndef _IMAGE_RESAMPLER_H_
+#define _IMAGE_RESAMPLER_H_
+
+#include <vector>
+
+#include "GLES.h"
+#include "Utility.h"
+
+// Downscales host images on ingest to the largest size they are ever drawn at, so full-HD art for a small tile
+// doesn't take GPU memory and upload time of a full-HD texture. Separable Lanczos-2 filter, stretched by the
+// scale factor, in 14-bit fixed point: rows are filtered first (any format, SSE2 or NEON), then columns
+// (SSE2 or NEON for 4-byte pixels, plain loops for others).
+class ImageResampler {
+public:
+  static Size<int> getIngestSize(Size<int> size, Size<int> maxSize); // each dimension limited separately, images are stretched to their quads anyway
+  static std::vector<char> resize(const char *pixels, Size<int> size, GLenum format, Size<int> targetSize); // downscaling only, targetSize <= size
+};
+
+#endif // _IMAGE_RESAMPLER_H_
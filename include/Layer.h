@@ -0,0 +1,40 @@
+#ifndef _LAYER_H_
+#define _LAYER_H_
+
+#include <functional>
+
+#include "GLES.h"
+#include "Utility.h"
+
+// Offscreen render target keeping content that changes rarely. Content is rendered once
+// at full opacity and composited every frame with a single textured quad until invalidated.
+class Layer {
+private:
+  GLuint framebuffer = 0;
+  GLuint textureId = 0;
+  Size<int> size;
+  bool valid;
+
+  GLuint programObject = GL_INVALID_VALUE;
+  GLuint posLoc     = GL_INVALID_VALUE;
+  GLuint texLoc     = GL_INVALID_VALUE;
+  GLuint samplerLoc = GL_INVALID_VALUE;
+  GLuint opacityLoc = GL_INVALID_VALUE;
+
+  void initialize();
+  bool createTarget();
+
+public:
+  Layer();
+  ~Layer();
+  Layer(const Layer& other) = delete;
+  Layer& operator=(const Layer& other) = delete;
+
+  void update(std::function<void()> renderContent);
+  void composite(float opacity);
+  void invalidate() { valid = false; }
+  bool isValid() { return valid; }
+  void release();
+};
+
+#endif // _LAYER_H_
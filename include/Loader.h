@@ -9,24 +9,9 @@
 
 class Loader {
 private:
-  void initialize();
   int percent;
   Animation animation;
 
-  GLuint programObject = GL_INVALID_VALUE;
-  GLuint percentLoc  = GL_INVALID_VALUE;
-  GLuint viewportLoc = GL_INVALID_VALUE;
-  GLuint positionLoc = GL_INVALID_VALUE;
-  GLuint posLoc      = GL_INVALID_VALUE;
-  GLuint sizLoc      = GL_INVALID_VALUE;
-  GLuint fgColorLoc  = GL_INVALID_VALUE;
-  GLuint bgColorLoc  = GL_INVALID_VALUE;
-
-  GLuint logoProgramObject = GL_INVALID_VALUE;
-  GLuint logoPosLoc = GL_INVALID_VALUE;
-  GLuint logoSamplerLoc = GL_INVALID_VALUE;
-  GLuint logoTexLoc = GL_INVALID_VALUE;
-
   GLuint logoTextureId = 0;
 
   Size<int> progressBarSize;
@@ -46,11 +31,11 @@ public:
   void render();
   void setValue(int value);
   void setLogo(int id, char* pixels, Size<int> size, GLuint format);
-  void initTexture();
   void recalculateSizesAndPositions(Size<int> bitmapSize);
   void renderLogo(Size<int> size, Position<int> position);
   void renderProgressBar(Size<int> size, Position<int> position, float percent);
   void updatePercent();
+  bool isAnimating() { return animation.isActive(); }
 };
 
 #endif // _LOADER_H_
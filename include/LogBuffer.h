@@ -0,0 +1,44 @@
+#ifndef _LOG_BUFFER_H_
+#define _LOG_BUFFER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-size ring of preallocated log lines, written from any thread without locks.
+// Every line gets a consecutive absolute index; once CAPACITY newer lines are pushed, the oldest one is overwritten.
+// Each slot is guarded by a sequence number (odd while being written), so a reader can tell
+// whether it copied a complete line, and two writers lapping each other on one slot can't mix their bytes.
+class LogBuffer {
+public:
+  static constexpr size_t CAPACITY = 256;       // lines
+  static constexpr size_t MAX_LINE_BYTES = 256; // longer lines are truncated
+
+  enum class Read {
+    Ok,
+    Pending,    // line is still being written
+    Overwritten // line was replaced by a newer one, or dropped
+  };
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> sequence; // 2 * index + 2 when line index is complete, 2 * index + 1 while it is being written
+    size_t length;
+    char text[MAX_LINE_BYTES];
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  std::atomic<uint64_t> pushed; // absolute index of the next line
+
+public:
+  LogBuffer();
+  void push(const char *text, size_t length);
+  Read read(uint64_t index, std::string &line);
+  uint64_t getPushed() { return pushed.load(std::memory_order_acquire); }
+  uint64_t getFirstIndex(); // oldest line which can still be read
+  uint64_t getDropped() { return getFirstIndex(); } // lines pushed out by newer ones (including lines lost while their slot was busy)
+};
+
+#endif // _LOG_BUFFER_H_
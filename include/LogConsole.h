@@ -4,25 +4,35 @@
 #include <string>
 #include <utility>
 #include <deque>
+#include <cstdint>
 
 #include "GLES.h"
 #include "Utility.h"
+#include "LogBuffer.h"
 
 class LogConsole {
 private:
+  LogBuffer logs;
+  uint64_t renderedLogs; // lines before this index are already in the texture (or never will be)
+  uint64_t unfinishedLog; // line that was still being written during last update, to wait for it only once
 
-  GLuint programObject;
-  GLuint posALoc;
-  GLuint posLoc;
-  GLuint sizLoc;
-  GLuint colLoc;
-  GLuint opaLoc;
+  // Lines are rasterized once into a texture used as a ring of rows: each new line goes below the previous one,
+  // wrapping around to the top, and overwrites the oldest rows. Frames without new logs only composite the texture.
+  GLuint framebuffer;
+  GLuint textureId;
+  Size<int> textureSize;
+  int textureFontId;
+  int textureFontSize;
+  int writeRow;      // row (counted from the top) where the next line starts
+  int contentHeight; // rows taken by visible lines, which end at writeRow
+  std::deque<int> lineHeights; // of visible lines including margin, oldest first
 
-  std::deque<std::string> logs;
+  const Size<int> margin;
 
-  void initialize();
-  void renderText(Position<int> position, Size<int> size, int fontId, int fontSize);
-  void renderLogs(Position<int> position, Size<int> size, int fontId, int fontSize, Size<int> margin, int lineWidth);
+  bool createTexture(Size<int> size);
+  void updateTexture(Size<int> size, int fontId, int fontSize);
+  void clearRows(int row, int height);
+  void addRows(Position<int> position, int row, int height);
   int getTextHeight(std::string s, int lineWidth, int fontHeight, int fontId);
 
   LogConsole();
@@ -43,8 +53,12 @@ public:
   };
 
   void render(Position<int> position, Size<int> size, int fontId, int fontSize);
-  void pushLog(std::string log);
-  void log(std::string log, LogLevel logLevel);
+  void release(); // GL resources, while the context is still current
+  void pushLog(const std::string &log); // can be called from any thread
+  bool hasPendingLogs();
+  uint64_t getDroppedLogs() { return logs.getDropped(); }
+  // rate limited per call site and written to dlog asynchronously, see LogSink
+  void log(std::string log, LogLevel logLevel, const char *file = __builtin_FILE(), int line = __builtin_LINE());
 };
 
 #endif // _LOGCONSOLE_H_
@@ -0,0 +1,79 @@
+#ifndef _LOG_SINK_H_
+#define _LOG_SINK_H_
+
+#include <string>
+#include <map>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "LogConsole.h"
+#include "LogBuffer.h"
+
+// Rate limits diagnostics per call site and writes them to dlog from its own thread,
+// so an error repeated every frame costs neither a dlog write nor a console line per frame.
+// Repeats of the last message of a site are collapsed into "last message repeated N times".
+// Messages longer than a LogBuffer line reach dlog as several lines, each continuation starting with "... ".
+class LogSink {
+private:
+  LogSink();
+  ~LogSink();
+  LogSink(const LogSink&) = delete;
+  LogSink& operator=(const LogSink&) = delete;
+
+  static constexpr float BURST = 10.0f;             // messages a site can log at once
+  static constexpr float RATE = 2.0f;               // messages per second a site can log once its burst is used up
+  static constexpr int REPEAT_REPORT_MS = 5000;     // how often repeats of the same message are reported
+  static constexpr int FLUSH_INTERVAL_MS = 1000;    // how often pending repeat counts are checked without new messages
+
+  typedef std::pair<const char*, int> Site; // file and line
+
+  struct SiteState {
+    std::string lastMessage;
+    LogConsole::LogLevel level;
+    int repeated;
+    int suppressed;
+    float tokens;
+    std::chrono::time_point<std::chrono::steady_clock> lastRefill;
+    std::chrono::time_point<std::chrono::steady_clock> lastReport;
+  };
+
+  struct Message {
+    LogConsole::LogLevel level;
+    std::string text;
+  };
+
+  std::mutex sitesMutex;
+  std::map<Site, SiteState> sites;
+
+  LogBuffer queue; // lines for dlog, prefixed with level
+  // used by the writer thread only
+  uint64_t written; // next queue index to write
+  uint64_t checked; // lines pushed when queue was last written out
+  uint64_t unfinishedLine;
+
+  std::thread thread;
+  std::mutex threadMutex;
+  std::condition_variable wakeUp;
+  bool stopRequested;
+
+  void run();
+  void writeQueued();
+  void flushRepeats(std::vector<Message> &messages, std::chrono::time_point<std::chrono::steady_clock> now, bool all);
+  void emit(const std::vector<Message> &messages);
+  static std::string repeatedMessage(int repeated);
+
+public:
+  static LogSink& instance() {
+    static LogSink logSink;
+    return logSink;
+  }
+
+  void log(const std::string &message, LogConsole::LogLevel level, const char *file, int line); // can be called from any thread
+};
+
+#endif // _LOG_SINK_H_
@@ -4,9 +4,14 @@
 #include <chrono>
 #include <cstdlib> // malloc
 #include <cstring> // memcpy
+#include <list>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
 
 #include "CommonStructs.h"
 #include "Tile.h"
@@ -17,6 +22,10 @@
 #include "Metrics.h"
 #include "Options.h"
 #include "ModalWindow.h"
+#include "TextureUploader.h"
+#include "TileImageResizer.h"
+#include "WorkScheduler.h"
+#include "Damage.h"
 #include "Utility.h"
 
 class Menu {
@@ -27,6 +36,11 @@ private:
   int selectedTile;
   int firstTile;
   std::string footer;
+  Damage damage; // accumulated since last frame
+  std::vector<Damage::Region> frameDamage; // redrawn in last frame
+  bool partialRedraw;
+  bool firstFrameRendered;
+  bool programsReady; // first batch of prefetched programs is compiled and reported
 
   // UI helper objects
   Loader loader;
@@ -36,29 +50,54 @@ private:
   Metrics metrics;
   Options options;
   ModalWindow modalWindow;
+  TextureUploader uploader; // tile images are uploaded on the main thread while it isn't running
+  TileImageResizer resizer;
+  std::unordered_map<int, uint64_t> resizedImages; // tile id to the TileImageResizer sequence of its latest image
+  std::list<int> backgroundImageTiles; // tiles keeping a background image, most recently shown first
+  size_t backgroundImageBytes;
 
 private:
   void initialize();
   int addTile(char *pixels, Size<int> size);
   Position<int> getTilePosition(int tileNo, bool initialMargin = true);
   Size<int> getGridSize();
+  void requestRedraw() { damage.addFull(); }
+  void collectDamage(Damage &damage);
+  void compileProgramsInBackground();
+  void collectUploads();
+  void setTileImage(int tileId, std::shared_ptr<std::vector<char>> pixels, Size<int> size, GLuint format, Tile::BackgroundImage backgroundImage);
+  void keepBackgroundImage(int tileId, Tile::BackgroundImage image);
+  void prepareBackground(int tileId);
+  void runDeferredWork();
+  WorkScheduler::Priority getUploadPriority(int tileId);
+  int getUiState();
 
 public:
   Menu();
   ~Menu();
 
   void render();
+  bool needsRedraw();
+  void setPartialRedraw(bool enable);
+  int getDamageRegion(int *rects, int count);
   void showMenu(int enable);
   int addTile();
   void selectTile(int tileNo, bool runPreview);
   int addFont(char *data, int size);
   void showLoader(bool enabled, int percent);
-  void setTileData(TileData tileData);
+  void setTileData(TileData tileData, uint64_t cacheKey = 0); // with a cacheKey, the downscaled image is also stored in TextureCache
+  bool setCachedTileData(TileData tileData, uint64_t cacheKey); // image from TextureCache when pixels are nullptr, false on a miss
+  bool setBackgroundUploads(bool enable);
+  void setDeferredWorkBudget(std::chrono::microseconds budget);
   void updatePlaybackControls(PlaybackData playbackData);
   void setIcon(ImageData imageData);
   void setLoaderLogo(ImageData imageData);
   void setFooter(std::string footer);
   void showSubtitle(int duration, std::string text);
+  void addSubtitleCues(std::vector<Subtitles::Cue> cues);
+  int loadSubtitleTrack(const char *data, size_t length, SubtitleTrack::Format format);
+  void clearSubtitleCues();
+  void setMediaTime(int time, bool playing);
   bool addOption(int id, std::string name);
   bool addSuboption(int parentId, int id, std::string name);
   bool updateSelection(SelectionData selectionData);
@@ -71,10 +110,17 @@ public:
   void selectAction(int id);
   void setLogConsoleVisibility(bool visible);
   void pushLog(std::string log);
+  uint64_t getDroppedLogs();
   void showAlert(AlertData alertData);
   void hideAlert();
   bool isAlertVisible();
   void setSeekPreviewCallback(StoryboardExternData (*getSeekPreviewStoryboardData)());
+  void setStoryboard(int storyboardId, Storyboard::Layout layout);
+  void setStoryboardSheet(int storyboardId, int sheetIndex, ImageData imageData);
+  void setJankCallback(void (*jankCallback)(JankInfo));
+  FrameStats::Summary getFrameStats(bool reset);
+  int startProcessSampler(int intervalMs);
+  void stopProcessSampler();
 };
 
 #endif // _MENU_H_
@@ -1,7 +1,6 @@
 #ifndef _METRICS_H_
 #define _METRICS_H_
 
-#include <deque>
 #include <chrono>
 #include <vector>
 #include <string>
@@ -9,6 +8,11 @@
 
 #include "Graph.h"
 #include "LogConsole.h"
+#include "Damage.h"
+#include "RingBuffer.h"
+#include "FrameStats.h"
+#include "ProcessSampler.h"
+#include "ExternStructs.h"
 
 class Metrics {
 private:
@@ -19,9 +23,9 @@ private:
     float currentValue;
     float minValue;
     float maxValue;
-    int valueMaxCount;
-    std::deque<float> values;
+    RingBuffer<float> values; // last valueMaxCount values
     bool visible;
+    bool changed;
     Trace(int id, std::string tag, float minValue, float maxValue, int valueMaxCount);
     virtual ~Trace() = default;
   };
@@ -38,20 +42,45 @@ private:
 
   Graph graph;
   bool logConsoleVisible;
+  const Size<int> margin;
+  const Size<int> graphSize;
   
   std::vector<std::unique_ptr<Trace>> traces;
 
+  FrameStats frameStats;
+  std::chrono::time_point<std::chrono::steady_clock> lastFrameTime;
+  bool lastFrameContinuous; // next frame was expected right away, so time between them is frame duration, not idle time
+  void (*jankCallback)(JankInfo);
+
+  ProcessSampler processSampler;
+  int processTraceId; // first of cpu, rss, threads and gpu memory traces, -1 until sampler is started
+  unsigned int processSampleSequence;
+  void pollProcessSampler();
+  void pushProcessValue(int traceId, float value, float rangeStep);
+
+  Position<int> getGraphPosition(int row);
+  Position<int> getLogConsolePosition();
+  Size<int> getLogConsoleSize(int rows);
+
 public:
   Metrics();
+  ~Metrics();
   void render();
+  void collectDamage(Damage &damage);
   int addGraph(std::string tag, float minVal, float maxVal, int valuesMaxCount);
   void setGraphVisibility(int graphId, bool visible);
   void updateGraphValues(int graphId, std::vector<float> values);
   void updateGraphValue(int graphId, float value);
   void updateGraphRange(int graphId, float minVal, float maxVal);
+  void frameRendered(int uiState, bool continuous);
+  void setJankCallback(void (*jankCallback)(JankInfo)) { this->jankCallback = jankCallback; }
+  FrameStats::Summary getFrameStats(bool reset);
+  int startProcessSampler(int intervalMs);
+  void stopProcessSampler();
 
   void setLogConsoleVisibility(bool visible);
   void pushLog(std::string log);
+  uint64_t getDroppedLogs();
 };
 
 #endif // _METRICS_H_
@@ -0,0 +1,75 @@
+#ifndef _MIPMAP_GENERATOR_H_
+#define _MIPMAP_GENERATOR_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+#include "GLES.h"
+#include "EtcEncoder.h"
+#include "Utility.h"
+
+// Builds mip chains on the CPU with a 2x2 box filter, on its own thread, instead of glGenerateMipmap,
+// which some TV drivers implement on the CPU inside the driver, blocking the render thread.
+// 4-byte pixels (RGBA, BGRA) are filtered with NEON or SSE2 when available, other formats with plain loops.
+// Finished chains are collected on the render thread, which uploads them level by level with glTexImage2D.
+// The same thread ETC compresses textures uploaded uncompressed, see compress().
+class MipmapGenerator {
+public:
+  struct Level {
+    Size<int> size;
+    std::vector<char> pixels;
+  };
+
+  struct Chain {
+    GLuint texture;
+    uint64_t generation; // of texture content the chain was built from
+    GLenum format; // of levels, or of compressed ones
+    std::vector<Level> levels; // from level 1 down to 1x1
+    std::vector<EtcEncoder::Level> compressed; // level 0 first, replacing the whole texture; levels is empty then
+  };
+
+private:
+  struct Job {
+    GLuint texture;
+    uint64_t generation;
+    GLenum format;
+    Size<int> size;
+    std::vector<char> pixels; // level 0, copied
+    GLenum compressedFormat; // GL_NONE to build a mip chain
+    int quality; // EtcEncoder::Quality
+    bool mipmaps; // compressed too
+  };
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::deque<Job> jobs;
+  std::deque<Chain> finished;
+  bool stopRequested;
+
+  void queue(Job job);
+  void run();
+
+public:
+  MipmapGenerator();
+  ~MipmapGenerator();
+  MipmapGenerator(const MipmapGenerator&) = delete;
+  MipmapGenerator& operator=(const MipmapGenerator&) = delete;
+
+  void generate(GLuint texture, uint64_t generation, GLenum format, Size<int> size, const void *pixels); // thread is started on first use
+  void compress(GLuint texture, uint64_t generation, GLenum compressedFormat, int quality, bool mipmaps, GLenum format, Size<int> size, const void *pixels);
+  std::vector<Chain> collect();
+  bool hasFinished();
+  void stop(); // pending chains are dropped
+
+  static std::vector<Level> buildChain(const char *pixels, Size<int> size, GLenum format, bool simd = true);
+  static void uploadChain(const std::vector<Level> &levels, GLenum format); // to the texture bound on the active unit
+  // average microseconds per chain: glGenerateMipmap, scalar and SIMD buildChain(), uploadChain(); returns number of values
+  static int benchmark(Size<int> size, GLenum format, int iterations, int *results, int count);
+};
+
+#endif // _MIPMAP_GENERATOR_H_
@@ -10,13 +10,6 @@
 
 class ModalWindow {
 private:
-  GLuint programObject;
-  GLuint posALoc;
-  GLuint posLoc;
-  GLuint sizLoc;
-  GLuint colLoc;
-  GLuint opaLoc;
-
   bool visible;
   std::string title;
   std::string body;
@@ -56,7 +49,6 @@ private:
   Params params;
   bool paramsNeedRecalculation;
 
-  void initialize();
   void renderContent();
   void renderRectangle(Position<int> position, Size<int> size);
   void renderTitle();
@@ -67,7 +59,6 @@ private:
 
 public:
   ModalWindow();
-  ~ModalWindow();
   void show(std::string title, std::string body, std::string button);
   void hide();
   void render();
@@ -8,6 +8,7 @@
 
 #include "GLES.h"
 #include "Utility.h"
+#include "Layer.h"
 
 class Options {
   private:
@@ -47,19 +48,21 @@ class Options {
     int selectedSuboptionId; // suboption selected at the moment in the menu
     float opacity;
     bool show;
+    Layer layer; // panel changes only with selection, so it's composited from cache
 
-    GLuint programObject = GL_INVALID_VALUE;
-    GLuint positionALoc  = GL_INVALID_VALUE;
-    GLuint positionLoc   = GL_INVALID_VALUE;
-    GLuint sizeLoc       = GL_INVALID_VALUE;
-    GLuint colorLoc      = GL_INVALID_VALUE;
-    GLuint opacityLoc    = GL_INVALID_VALUE;
-    GLuint frameWidthLoc = GL_INVALID_VALUE;
-    GLuint frameColorLoc = GL_INVALID_VALUE;
+    class Label {
+      public:
+        std::string text;
+        Position<int> position;
+        int fontHeight;
+        float opacity;
+    };
+    std::vector<Label> labels; // texts waiting for their rectangles to be flushed
 
-    void initialize();
     void render(Position<int> position, Size<int> optionRectangleSize, Size<int> suboptionRectangleSize, float opacity);
+    void renderOptions();
     void renderRectangle(Position<int> position, Size<int> size, std::vector<float> color, float opacity, std::string name, int frameWidth, std::vector<float> frameColor, bool submenuSelected = false);
+    void renderLabels();
 
   public:
     Options();
@@ -72,6 +75,7 @@ class Options {
     void renderIcon();
     int getMaxTextLength() { return maxTextLength; }
     float getOpacity() { return opacity; }
+    bool isVisible() { return show && opacity > 0.0f; }
     void setOpacity(float opacity) { this->opacity = opacity; }
 };
 
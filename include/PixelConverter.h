@@ -0,0 +1,44 @@
+#ifndef _PIXEL_CONVERTER_H_
+#define _PIXEL_CONVERTER_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "GLES.h"
+#include "Utility.h"
+
+// Converts host images to a format the GL implementation takes directly, before they are uploaded:
+// BGRA when GL_EXT_texture_format_BGRA8888 isn't reported, and RGB, which many drivers repack on the CPU
+// (one byte at a time with GL_UNPACK_ALIGNMENT 1), when Settings::expandRgbUploads is on.
+// Capabilities, ETC texture compression among them, are probed at runtime, so one binary takes the fast path wherever it exists.
+// Kernels use SSE2/SSSE3 or NEON when available. Probed on the render thread, read from any.
+class PixelConverter {
+private:
+  PixelConverter();
+  ~PixelConverter() = default;
+  PixelConverter(const PixelConverter&) = delete;
+  PixelConverter& operator=(const PixelConverter&) = delete;
+
+  bool bgraSupported;
+  bool expandRgb;
+  GLenum etcFormat;
+
+public:
+  static PixelConverter& instance() {
+    static PixelConverter pixelConverter;
+    return pixelConverter;
+  }
+
+  void probe(); // needs to be run from eglContext synced methods, again for every new context
+  bool isBgraSupported() { return bgraSupported; }
+  GLenum getEtcFormat() { return etcFormat; } // GL_COMPRESSED_RGB8_ETC2 on GLES3, GL_ETC1_RGB8_OES with the extension, or GL_NONE
+  GLenum getUploadFormat(GLenum format); // format pixels are passed to GL in
+  // pixels in getUploadFormat(format); either the original ones or converted into buffer
+  const void* convert(GLenum format, Size<int> size, const void *pixels, std::vector<char> &buffer);
+
+  static void bgraToRgba(const uint8_t *src, uint8_t *dst, size_t count); // count pixels, src and dst may be the same
+  static void rgbToRgba(const uint8_t *src, uint8_t *dst, size_t count);
+};
+
+#endif // _PIXEL_CONVERTER_H_
@@ -10,6 +10,8 @@
 #include "Animation.h"
 #include "CommonStructs.h"
 #include "ExternStructs.h"
+#include "Damage.h"
+#include "Storyboard.h"
 #include "Utility.h"
 
 class Playback {
@@ -62,6 +64,8 @@ private:
   float bufferingPercent;
   bool seeking;
   std::chrono::time_point<std::chrono::steady_clock> lastUpdate;
+  bool overlayChanged;
+  bool controlsChanged;
 
   const int progressUiLineLevel = 100;
   Size<int> progressBarSizePx;
@@ -95,7 +99,7 @@ private:
   GLuint viewportLoaderLoc = GL_INVALID_VALUE; 
   GLuint sizeLoaderLoc     = GL_INVALID_VALUE;
 
-  GLuint seekTextureId     = 0;
+  GLuint seekTextureId     = 0; // sheet from StoryboardCache, looked up every frame
   GLuint seekProgramObject = GL_INVALID_VALUE;
   GLuint samplerSeekLoc    = GL_INVALID_VALUE;
   GLuint texCoordSeekLoc   = GL_INVALID_VALUE;
@@ -111,12 +115,13 @@ private:
   int storyboardBitmapHash;
   Rect storytileRect;
   StoryboardExternData (*getStoryboardDataCallback)() = nullptr;
+  Storyboard seekStoryboard; // pushed by the host, used instead of the callback when valid
+  int seekStoryboardFrame; // last frame shown from it
   bool displaySeekPreview;
   bool seekPreviewReady;
 
 private:
   void initialize();
-  void initTexture(int id);
   void renderIcons();
   void renderIcon(Icon icon, Position<int> position, Size<int> size, std::vector<float> color, float opacity, bool bloom);
   void renderText();
@@ -126,14 +131,15 @@ private:
   void renderLoader(float opacity);
   void renderSeekPreview();
   void updateSeekPreviewTexture();
+  void updateSeekPreviewStoryboard();
   Position<int> getSeekPreviewPosition(Size<int> size);
-  void setPreviewTexture(SubBitmapExtern frame);
   StoryboardExternData getStoryboardData();
-  void initTextures();
   template<typename T> inline T max(T a, T b) { return a > b ? a : b; }
   template<typename T> inline T clamp(T v, T lo, T hi) { return v < lo ? lo : v > hi ? hi : v; }
   void renderSeekPreviewTime();
   Size<int> getSeekPreviewTileSize();
+  bool isLoaderVisible();
+  int getControlsHeight();
 
 public:
   Playback();
@@ -143,8 +149,13 @@ public:
   void update(int show, int state, int currentTime, int totalTime, std::string text, std::chrono::milliseconds animationDuration, std::chrono::milliseconds animationDelay, bool buffering, float bufferingPercent, bool seeking);
   void setOpacity(float opacity) { this->opacity = opacity; }
   float getOpacity() { return opacity; }
+  bool isSeeking() { return seeking && opacity > 0.0f; }
+  bool isPlaying() { return state == State::Playing && !buffering && !seeking; } // media time is advancing
   void selectAction(int id);
+  void collectDamage(Damage &damage);
   void setStoryboardCallback(StoryboardExternData (*getSeekPreviewStoryboardDataCallback)());
+  void setStoryboard(Storyboard storyboard);
+  void setStoryboardSheet(int sheetIndex, const ImageData &sheet) { seekStoryboard.setSheet(sheetIndex, sheet); }
 
   enum class Shadow {
     None,
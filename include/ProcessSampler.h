@@ -0,0 +1,59 @@
+#ifndef _PROCESS_SAMPLER_H_
+#define _PROCESS_SAMPLER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+
+// Samples process CPU usage, resident memory and thread count from /proc, plus the texture memory estimate
+// kept by GLState, on its own thread. The latest sample is published through a sequence lock,
+// so the render thread reads it without blocking.
+class ProcessSampler {
+public:
+  struct Sample {
+    float cpuPercent; // of all cores, since previous sample
+    float rssMB;
+    float threads;
+    float gpuMB;      // textures allocated by this library
+  };
+
+private:
+  static constexpr int MIN_INTERVAL_MS = 100;
+
+  std::thread thread;
+  std::mutex mutex; // guards only stopping and waking up the thread, not the published sample
+  std::condition_variable wakeUp;
+  bool stopRequested;
+  std::atomic<int> intervalMs;
+
+  std::atomic<unsigned int> sequence; // odd while a sample is being written
+  std::atomic<float> cpuPercent;
+  std::atomic<float> rssMB;
+  std::atomic<float> threads;
+  std::atomic<float> gpuMB;
+
+  // used by the sampling thread only
+  unsigned long long lastProcessTicks;
+  unsigned long long lastTotalTicks;
+  long pageSize;
+
+  void run();
+  void sample();
+  bool readProcessStat(unsigned long long &ticks, int &threadCount);
+  bool readTotalTicks(unsigned long long &ticks);
+  bool readResidentPages(long &pages);
+  static bool parseNumber(const std::string &text, unsigned long long &value); // whole text, no exceptions
+  static bool parseNumber(const std::string &text, long &value);
+
+public:
+  ProcessSampler();
+  ~ProcessSampler();
+  void start(int intervalMs); // changes interval if already running
+  void stop();
+  bool isRunning() { return thread.joinable(); }
+  bool getSample(unsigned int &lastSequence, Sample &sample); // true if there is a sample newer than lastSequence
+};
+
+#endif // _PROCESS_SAMPLER_H_
@@ -1,13 +1,41 @@
 #ifndef _PROGRAM_BUILDER_H_
 #define _PROGRAM_BUILDER_H_
 
+#include <string>
+#include <vector>
+#include <chrono>
+
 #include "GLES.h"
 
 class ProgramBuilder {
 public:
-  static GLuint buildProgram(const GLchar* vshader, const GLchar* fshader);
+  static GLuint buildProgram(const GLchar* vshader, const GLchar* fshader, const std::string &name = "");
+  static void prefetchProgram(const std::string &name, const GLchar* vshader, const GLchar* fshader); // no GL calls, compiled by compilePrefetched()
+  static bool compilePrefetched(); // returns true when all prefetched programs are ready
+  static bool isCompilationPending();
+  static void deletePrefetched();
 private:
+  struct PrefetchedProgram {
+    std::string name;
+    const GLchar* vshader;
+    const GLchar* fshader;
+    GLuint program;
+    GLuint vertexShader;
+    GLuint fragmentShader;
+    bool started;
+    bool cached; // binary is already in ProgramCache
+    bool ready;  // build time is already reported
+    std::chrono::time_point<std::chrono::steady_clock> start;
+  };
+  static std::vector<PrefetchedProgram> prefetched;
+  static int parallelCompile; // -1 until KHR_parallel_shader_compile availability is checked
+
+  static GLuint build(const GLchar* vshader, const GLchar* fshader, const std::string &name);
   static GLuint loadShader(const GLenum type, const GLchar* source);
+  static bool checkShader(GLuint shader);
+  static bool checkProgram(GLuint program);
+  static void startCompilation(PrefetchedProgram &prefetchedProgram);
+  static bool isParallelCompileSupported();
 };
 
 #endif // _PROGRAM_BUILDER_H_
@@ -0,0 +1,52 @@
+#ifndef _PROGRAM_CACHE_H_
+#define _PROGRAM_CACHE_H_
+
+#include <string>
+#include <cstdint>
+
+#include "GLES.h"
+
+// Keeps linked program binaries (GL_OES_get_program_binary) in a host provided directory,
+// so programs don't have to be compiled from source on every start.
+class ProgramCache {
+private:
+  ProgramCache();
+  ~ProgramCache() = default;
+  ProgramCache(const ProgramCache&) = delete;
+  ProgramCache& operator=(const ProgramCache&) = delete;
+
+  std::string directory;
+  bool initialized;
+  bool supported;
+  std::string driverId; // binaries are valid only for the driver which produced them
+  PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOESFunc;
+  PFNGLPROGRAMBINARYOESPROC glProgramBinaryOESFunc;
+  int hits;
+  int misses;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t length;
+  };
+
+  void initialize();
+  uint64_t getKey(const GLchar* vshader, const GLchar* fshader);
+  std::string getPath(uint64_t key);
+
+public:
+  static ProgramCache& instance() {
+    static ProgramCache programCache;
+    return programCache;
+  }
+
+  void setDirectory(const std::string &directory);
+  GLuint load(const GLchar* vshader, const GLchar* fshader); // returns GL_INVALID_VALUE if there is no usable binary
+  void store(GLuint program, const GLchar* vshader, const GLchar* fshader);
+  int getHits() { return hits; }
+  int getMisses() { return misses; }
+};
+
+#endif // _PROGRAM_CACHE_H_
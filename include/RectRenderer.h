@@ -0,0 +1,53 @@
+#ifndef _RECT_RENDERER_H_
+#define _RECT_RENDERER_H_
+
+#include <vector>
+
+#include "GLES.h"
+#include "Utility.h"
+
+// Draws flat UI rectangles (fill, frame, rounded corners, optional texture) with one shared program.
+// Rectangles are batched until flush() or until a different texture is requested.
+class RectRenderer {
+
+private:
+  RectRenderer();
+  ~RectRenderer();
+  RectRenderer(const RectRenderer&) = delete;
+  RectRenderer& operator=(const RectRenderer&) = delete;
+public:
+  static RectRenderer& instance() {
+    static RectRenderer rectRenderer;
+    return rectRenderer;
+  }
+
+private:
+  GLuint programObject = GL_INVALID_VALUE;
+  GLuint posLoc        = GL_INVALID_VALUE;
+  GLuint rectLoc       = GL_INVALID_VALUE;
+  GLuint fillColorLoc  = GL_INVALID_VALUE;
+  GLuint frameColorLoc = GL_INVALID_VALUE;
+  GLuint styleLoc      = GL_INVALID_VALUE;
+  GLuint texLoc        = GL_INVALID_VALUE;
+  GLuint samplerLoc    = GL_INVALID_VALUE;
+  GLuint viewportLoc   = GL_INVALID_VALUE;
+
+  static constexpr int VERTEX_SIZE = 20; // position(2), rect(4), fill color(4), frame color(4), style(4), texture coordinates(2)
+  static constexpr int MAX_RECTS = 1024;
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLushort> indices;
+  GLuint batchTextureId;
+
+  void initialize();
+
+public:
+  // colors are RGBA, position is the bottom-left corner in pixels,
+  // textureRect holds texture coordinates of the top-left and bottom-right corners
+  void add(Position<float> position, Size<float> size, const std::vector<float> &fillColor,
+           float frameWidth = 0.0f, const std::vector<float> &frameColor = {0.0f, 0.0f, 0.0f, 0.0f},
+           float radius = 0.0f, GLuint textureId = 0, const std::vector<float> &textureRect = {0.0f, 0.0f, 1.0f, 1.0f});
+  void flush();
+};
+
+#endif // _RECT_RENDERER_H_
@@ -0,0 +1,48 @@
+#ifndef _RING_BUFFER_H_
+#define _RING_BUFFER_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-capacity FIFO which overwrites the oldest element when full.
+// Every pushed element gets a consecutive absolute index, stored in slot index % capacity,
+// so consumers can tell which elements they haven't seen yet (e.g. to upload only new samples).
+template<typename T> class RingBuffer {
+private:
+  std::vector<T> data;
+  uint64_t pushed; // absolute index of the next element
+  size_t count;
+
+public:
+  explicit RingBuffer(size_t capacity)
+    : data(capacity > 0 ? capacity : 1),
+      pushed(0),
+      count(0) {
+  }
+
+  void push(const T &value) {
+    data[pushed % data.size()] = value;
+    ++pushed;
+    if(count < data.size())
+      ++count;
+  }
+
+  void clear() { count = 0; } // absolute indices keep growing, so slots stay where they were
+
+  size_t size() const { return count; }
+  size_t capacity() const { return data.size(); }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == data.size(); }
+
+  uint64_t getPushed() const { return pushed; }
+  uint64_t getFirstIndex() const { return pushed - count; } // absolute index of the oldest element
+  size_t getSlot(uint64_t index) const { return static_cast<size_t>(index % data.size()); }
+  const T& at(uint64_t index) const { return data[getSlot(index)]; } // by absolute index
+
+  const T& operator[](size_t i) const { return at(getFirstIndex() + i); } // 0 is the oldest element
+  const T& front() const { return at(getFirstIndex()); }
+  const T& back() const { return at(pushed - 1); }
+};
+
+#endif // _RING_BUFFER_H_
@@ -3,6 +3,7 @@
 
 #include <utility>
 #include <chrono>
+#include <cstddef>
 
 #include "Utility.h"
 
@@ -37,6 +38,19 @@ public:
   const std::chrono::milliseconds loaderUpdateAnimationDuration;
   const std::chrono::milliseconds loaderUpdateAnimationDelay;
   const int seekPreviewTileWidth;
+  const std::chrono::microseconds frameBudget;
+  const size_t storyboardCacheBytes;
+  const size_t textureBudgetBytes;
+  const int texturePoolSize;
+  const bool cpuMipmaps; // built by MipmapGenerator instead of glGenerateMipmap
+  const bool expandRgbUploads; // RGB images are uploaded as RGBA (a third more memory) for drivers repacking RGB slowly, see PixelConverter
+  const int textureCompression; // of opaque tile and storyboard textures, -1 for none, else an EtcEncoder::Quality
+  const Size<int> tileImageMaxSize; // tile images and storyboard frames are downscaled to it on ingest, zoomed tile size
+  const Size<int> backgroundImageMaxSize; // larger tile images are kept at it for the full screen background, see Tile::setBackgroundImage
+  const size_t backgroundImageBudgetBytes; // of background images kept in CPU memory, least recently shown ones are dropped
+  const size_t textureCacheBytes; // of files in the TextureCache directory, least recently used ones are deleted
+  const std::chrono::microseconds deferredWorkBudget; // of a frame, see WorkScheduler
+  const std::chrono::milliseconds deferredWorkMaxDelay;
 };
 
 #endif // _SETTINGS_H_
@@ -0,0 +1,46 @@
+#ifndef _STARTUP_REPORT_H_
+#define _STARTUP_REPORT_H_
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Collects timings of startup phases (Create(), first frame, program builds) for cold start analysis.
+class StartupReport {
+private:
+  StartupReport();
+  ~StartupReport() = default;
+  StartupReport(const StartupReport&) = delete;
+  StartupReport& operator=(const StartupReport&) = delete;
+
+  struct Event {
+    std::string name;
+    double time; // ms since start()
+  };
+
+  struct ProgramBuild {
+    std::string name;
+    std::string origin; // "compiled", "cache" or "parallel"
+    double time;        // ms since start() when program became usable
+    double compileMs;   // time spent waiting for a program built in parallel
+    double linkMs;      // load time for cached program, time since start of compilation for parallel one
+  };
+
+  std::chrono::time_point<std::chrono::steady_clock> startTime;
+  std::vector<Event> events;
+  std::vector<ProgramBuild> programs;
+
+public:
+  static StartupReport& instance() {
+    static StartupReport startupReport;
+    return startupReport;
+  }
+
+  void start();
+  double getElapsedMs(std::chrono::time_point<std::chrono::steady_clock> since);
+  void addEvent(const std::string &name);
+  void addProgram(const std::string &name, const std::string &origin, double compileMs, double linkMs);
+  std::string toString();
+};
+
+#endif // _STARTUP_REPORT_H_
@@ -0,0 +1,56 @@
+#ifndef _STORYBOARD_H_
+#define _STORYBOARD_H_
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#include "GLES.h"
+#include "CommonStructs.h"
+#include "StoryboardCache.h"
+#include "Utility.h"
+
+// Storyboard pushed by the host once: sheets laid out as a grid of frames, and their timing.
+// The frame for an elapsed preview time or a media position, and its rectangle, are computed natively;
+// the host is only asked (once) for sheets which aren't in StoryboardCache, instead of being called every frame.
+class Storyboard {
+public:
+  struct Layout {
+    int sheetCount;
+    int columns;
+    int rows;
+    int frameCount; // in all sheets, the last one may be filled partially
+    std::chrono::milliseconds frameInterval; // media time between frames, for the seek preview
+    std::chrono::milliseconds previewFrameDuration; // how long a tile preview shows each frame
+    void (*requestSheet)(int storyboardId, int sheetIndex);
+  };
+
+  struct Frame {
+    GLuint textureId;
+    Rect rect; // in sheet pixels
+    Size<int> sheetSize;
+  };
+
+private:
+  int id;
+  Layout layout;
+  StoryboardCache::Key firstKey; // of sheet 0, unique for every storyboard set
+  std::vector<Size<int>> sheetSizes; // {0, 0} until the sheet arrives
+  std::vector<bool> requested; // asked for and not received yet
+
+  static StoryboardCache::Key nextKey;
+
+public:
+  Storyboard();
+  Storyboard(int id, Layout layout);
+
+  bool isValid() { return layout.frameCount > 0; }
+  int getFrameCount() { return layout.frameCount; }
+  int getFrameAt(std::chrono::milliseconds position); // for media position, clamped to existing frames
+  int getPreviewFrameAt(std::chrono::milliseconds elapsed); // frameCount or more when the preview is over
+  void setSheet(int sheetIndex, const ImageData &image); // needs to be run from eglContext synced methods
+  bool getFrame(int frame, Frame &result, bool requestMissing = true); // false if its sheet isn't there (yet)
+  void releaseSheets(); // when replaced, its cached sheets are deleted at the end of the frame
+};
+
+#endif // _STORYBOARD_H_
@@ -0,0 +1,68 @@
+#ifndef _STORYBOARD_CACHE_H_
+#define _STORYBOARD_CACHE_H_
+
+#include <list>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "GLES.h"
+#include "ExternStructs.h"
+#include "Utility.h"
+
+// Storyboard sheet textures shared by tile previews and the seek preview, keyed by bitmapHash
+// (or by a key above the int range for sheets pushed with SetStoryboardSheet(), see Storyboard).
+// Least recently used sheets are deleted once their textures take more than Settings::storyboardCacheBytes,
+// so scrubbing back over a sheet boundary or reselecting a tile doesn't upload a sheet we had moments ago.
+// Returned texture ids are valid until the next getTexture() call, users look them up again every frame.
+class StoryboardCache {
+public:
+  enum class Stat { // counters in the order reported by getStats()
+    Hits,
+    Misses,
+    Evictions,
+    Textures,
+    KiloBytes,
+    Count
+  };
+
+  typedef int64_t Key;
+
+private:
+  StoryboardCache();
+  ~StoryboardCache() = default;
+  StoryboardCache(const StoryboardCache&) = delete;
+  StoryboardCache& operator=(const StoryboardCache&) = delete;
+
+  struct Sheet {
+    Key key;
+    GLuint textureId;
+    size_t bytes; // including mipmaps
+  };
+
+  std::list<Sheet> sheets; // most recently used first
+  std::unordered_map<Key, std::list<Sheet>::iterator> sheetsByKey;
+  size_t bytes;
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int evictions;
+
+  GLuint upload(const char *pixels, Size<int> size, GLuint format);
+  void evict(size_t budget);
+
+public:
+  static StoryboardCache& instance() {
+    static StoryboardCache storyboardCache;
+    return storyboardCache;
+  }
+
+  GLuint getTexture(const SubBitmapExtern &frame); // uploads the sheet if it isn't cached, 0 on failure
+  GLuint getTexture(Key key, const char *pixels, Size<int> size, GLuint format);
+  GLuint findTexture(Key key); // 0 if the sheet isn't cached anymore
+  void remove(Key first, Key last); // deletes sheets with keys in [first, last), which are never requested again
+  void trim(size_t bytes); // evicts least recently used sheets taking at least that much, for TextureManager's budget
+  void clear(); // deletes all textures, while the context is still current
+  int getStats(int *stats, int count); // returns number of available stats
+};
+
+#endif // _STORYBOARD_CACHE_H_
@@ -0,0 +1,66 @@
+#ifndef _SUBTITLE_TRACK_H_
+#define _SUBTITLE_TRACK_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Cues of one subtitle track. Texts of all cues are kept in a single arena string, cues only refer to them.
+// Cues are sorted by start time and a segment tree keeps the latest end time of each range of cues,
+// so the cues shown at any media time, overlapping ones included, are found in O(k log n), also right after a seek.
+class SubtitleTrack {
+public:
+  enum class Format {
+    Srt,
+    WebVtt,
+    Unknown
+  };
+
+private:
+  struct Cue {
+    std::chrono::milliseconds start;
+    std::chrono::milliseconds end;
+    uint32_t textOffset; // in texts
+    uint32_t textLength;
+  };
+
+  std::vector<Cue> cues;
+  std::string texts;
+  std::vector<std::chrono::milliseconds> latestEnds; // segment tree over cues, root at 1, leaves start at leafCount
+  size_t leafCount;
+  bool indexed;
+
+  void buildIndex();
+  void findEndingAfter(size_t node, size_t nodeBegin, size_t nodeEnd, size_t last, std::chrono::milliseconds time, std::vector<size_t> &found);
+
+  // parser
+  enum class Block {
+    None,    // between blocks
+    Header,  // WebVTT header, NOTE, STYLE or REGION block
+    Timing,  // identifier read, timing line expected
+    Text
+  };
+  Cue parsedCue;
+  void parseLine(const char *line, size_t length, Format format, Block &block);
+  static bool parseTiming(const char *line, size_t length, std::chrono::milliseconds &start, std::chrono::milliseconds &end);
+  static bool parseTimestamp(const char *&position, const char *end, std::chrono::milliseconds &time);
+  void appendText(const char *line, size_t length, Format format);
+  void finishCue();
+
+public:
+  SubtitleTrack();
+  void add(std::chrono::milliseconds start, std::chrono::milliseconds end, const std::string &text);
+  int load(const char *data, size_t length, Format format); // adds cues parsed from SRT or WebVTT data, returns their count
+  void clear();
+
+  size_t size() { return cues.size(); }
+  std::chrono::milliseconds getStart(size_t cue) { return cues[cue].start; }
+  std::chrono::milliseconds getEnd(size_t cue) { return cues[cue].end; }
+  std::string getText(size_t cue) { return texts.substr(cues[cue].textOffset, cues[cue].textLength); }
+  std::vector<size_t> find(std::chrono::milliseconds time); // cues started but not ended yet, in start order
+  size_t findNext(std::chrono::milliseconds time); // first cue starting after time
+};
+
+#endif // _SUBTITLE_TRACK_H_
@@ -3,19 +3,63 @@
 
 #include <chrono>
 #include <string>
+#include <vector>
+
+#include "Damage.h"
+#include "GLES.h"
+#include "SubtitleTrack.h"
 
 class Subtitles {
+public:
+  struct Cue {
+    std::chrono::milliseconds start; // media time
+    std::chrono::milliseconds end;
+    std::string text;
+  };
+
 private:
   std::chrono::time_point<std::chrono::steady_clock> start;
   std::chrono::milliseconds duration;
   std::string subtitle;
   bool active;
   bool showForOneFrame;
+  bool changed;
+
+  // Cues are shown by media time, which advances on its own between setMediaTime() calls while playing
+  // and follows the position reported by playback controls.
+  // The next few cues are rasterized before they are due, so the frame in which a cue appears only draws a ready texture.
+  SubtitleTrack track;
+  std::chrono::milliseconds mediaTime; // at mediaTimeSet
+  std::chrono::time_point<std::chrono::steady_clock> mediaTimeSet;
+  bool mediaPlaying;
+  std::chrono::milliseconds playbackTime; // last reported by playback controls
+  std::vector<size_t> shownCues; // rendered in last frame, in start order
+  std::vector<size_t> preparedCues; // their text textures are ready and kept until the cues end
+  int preparedWidth; // text width the cues were prepared for
+
+  const int fontHeight;
+  const int maxLines;
+  const Size<int> margin;
+  const size_t cuesAhead; // prepared starting with the current one
+
+  std::chrono::milliseconds getMediaTime();
+  std::vector<size_t> getCuesToPrepare();
+  Size<GLuint> getTextSize(const std::string &text);
+  void keepText(const std::string &text, std::chrono::time_point<std::chrono::steady_clock> until);
+  void renderText(const std::string &text, int raise); // raise: px above the bottom margin
 
 public:
   Subtitles();
   void render();
+  void collectDamage(Damage &damage);
   void showSubtitle(const std::chrono::milliseconds duration, const std::string subtitle); // duration == 0 means "show it just for next frame"
+  void addCues(std::vector<Cue> cues);
+  int loadTrack(const char *data, size_t length, SubtitleTrack::Format format); // returns number of cues added
+  void clearCues();
+  void setMediaTime(std::chrono::milliseconds time, bool playing);
+  void updatePlaybackTime(std::chrono::milliseconds time, bool playing); // follows playback position, unchanged reports don't reset the clock
+  void prepareCues(bool rasterize); // rasterizes at most one upcoming cue when rasterize is set, keeps textures of prepared ones
+  bool hasCuesToPrepare();
 };
 
 #endif // _SUBTITLES_H_
@@ -1,9 +1,13 @@
 #ifndef _TEXT_RENDERER_H_
 #define _TEXT_RENDERER_H_
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <utility>
+#include <unordered_set>
+#include <cstddef>
+#include <cstdint>
 
 #include "GLES.h"
 #include <glm/vec2.hpp>
@@ -33,12 +37,18 @@ private:
   GLuint shaOffLoc     = GL_INVALID_VALUE;
   GLuint opaLoc        = GL_INVALID_VALUE;
 
+  std::unordered_set<uint64_t> failedTexts; // deferred rasterization threw, these are retried inline so errors get logged; cleared when fonts change
+  unsigned int skippedRenders = 0;
+
   void prepareShaders();
+  bool isTextReady(const std::string &text, Size<int> size, int fontId);
 
 public:
   int addFont(char *data, int size);
   Size<GLuint> getTextSize(const std::string text, Size<GLuint> size, int fontId);
+  void keepText(const std::string &text, Size<GLuint> size, int fontId, std::chrono::time_point<std::chrono::steady_clock> until); // rasterized text isn't collected before until
   void render(std::string text, Position<int> position, Size<int> size, int fontId, std::vector<float> color);
+  unsigned int getSkippedRenders() { return skippedRenders; } // texts not drawn while waiting for deferred rasterization
 };
 
 #endif // _TEXT_RENDERER_H_
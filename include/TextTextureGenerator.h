@@ -84,6 +84,7 @@ public:
   private:
     GLuint textureId;
     std::chrono::time_point<std::chrono::steady_clock> lastTimeAccessed;
+    std::chrono::time_point<std::chrono::steady_clock> pinnedUntil; // not collected before, even when unused
     Size<GLuint> size;
     int fontId;
     FontFace font;
@@ -92,6 +93,7 @@ public:
     TextureInfo(GLuint textureId, Size<GLuint> size, GLuint fontId, FontFace font)
     : textureId(textureId),
       lastTimeAccessed(std::chrono::steady_clock::now()),
+      pinnedUntil(lastTimeAccessed),
       size(size),
       fontId(fontId),
       font(font) {
@@ -116,6 +118,14 @@ public:
       return lastTimeAccessed;
     }
 
+    void pin(std::chrono::time_point<std::chrono::steady_clock> until) {
+      pinnedUntil = std::max(pinnedUntil, until);
+    }
+
+    const std::chrono::time_point<std::chrono::steady_clock>& getPinnedUntil() {
+      return pinnedUntil;
+    }
+
     const FontFace getFont() {
       lastTimeAccessed = std::chrono::steady_clock::now();
       return font;
@@ -178,6 +188,9 @@ public:
   }
 
   TextureInfo getTexture(TextureKey textureKey);
+  bool isTextureGenerated(const TextureKey &textureKey) { return generatedTextures.count(textureKey) != 0; }
+  void pinTexture(const TextureKey &textureKey, std::chrono::time_point<std::chrono::steady_clock> until); // generated texture is kept at least until then
+  bool isFontFaceGenerated(int fontId, int fontSize) { return fonts.count(FontFaceKey { fontId, fontSize }) != 0; }
   int addFont(char *data, int size);
 
   Size<GLuint> getTextSize(TextureKey TextureKey);
@@ -0,0 +1,120 @@
+#ifndef _TEXTURE_CACHE_H_
+#define _TEXTURE_CACHE_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "GLES.h"
+#include "Utility.h"
+
+// Keeps processed tile images in a host provided directory, keyed by a content hash the host computes,
+// so a returning user's menu gets its textures without decoding, downscaling or mipmapping any image.
+// Files are KTX 1.1 containers with the complete mip chain, ETC1 compressed when TextureManager compresses tiles,
+// otherwise in the format PixelConverter uploads. Files are written on a worker thread and renamed into place,
+// so a crash never leaves a truncated one; they are memory-mapped and uploaded straight from the mapping.
+// A key/value entry records the settings a file was made with, files made with other settings are misses.
+// Tiles with a background image larger than the tile image get a second, single level file of it, ETC1 whenever
+// the context samples ETC and the image is opaque (1 MB at 1080p instead of 8 MB of RGBA).
+// Once the files take more than Settings::textureCacheBytes, the least recently used ones (by mtime, which a hit
+// updates) are deleted on the worker thread. The host's hash is the key, 0 isn't a valid one.
+class TextureCache {
+public:
+  enum class Stat { // counters of tile images, not their backgrounds, in the order reported by getStats()
+    Hits,
+    Misses,
+    Writes,
+    Evictions, // files of tile images and backgrounds deleted over the budget
+    Count
+  };
+
+  struct Level {
+    Size<int> size;
+    const char *data; // in the mapping
+    size_t bytes;
+  };
+
+  class Image { // mapped file, unmapped when the last reference is dropped
+  public:
+    GLenum format; // to upload in, an ETC format of this context or an uncompressed one
+    bool compressed;
+    Size<int> size;
+    std::vector<Level> levels; // level 0 first, down to 1x1
+
+    Image(void *mapping, size_t length) : mapping(mapping), length(length) {}
+    ~Image();
+    Image(const Image&) = delete;
+    Image& operator=(const Image&) = delete;
+
+  private:
+    void *mapping;
+    size_t length;
+  };
+
+private:
+  TextureCache();
+  ~TextureCache();
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+
+  struct Job {
+    uint64_t key;
+    std::shared_ptr<const std::vector<char>> pixels; // shared with the tile upload, never modified
+    Size<int> size;
+    GLenum format;
+    GLenum compressedFormat; // GL_NONE for uncompressed
+    int quality; // EtcEncoder::Quality, -1 for none
+    bool background; // Tile::BackgroundImage, a single level
+    std::string path; // directory may change while the job is queued
+  };
+
+  struct Variant { // key/value entry of every file
+    uint64_t key;
+    int32_t maxWidth; // Settings::tileImageMaxSize, or backgroundImageMaxSize
+    int32_t maxHeight;
+    int32_t quality; // TextureManager::getCompressionQuality(), see getQuality() for backgrounds
+    int32_t reserved;
+  };
+
+  std::string directory; // guarded by mutex, set from any thread
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::deque<Job> jobs;
+  bool stopRequested;
+  int stats[static_cast<int>(Stat::Count)];
+
+  void run();
+  void write(const Job &job);
+  void trim(const std::string &directory);
+  void increment(Stat stat);
+  std::string getDirectory();
+  static int getQuality(bool background);
+  Variant getVariant(uint64_t key, int quality, bool background);
+  static std::string getPath(const std::string &directory, uint64_t key, bool background);
+
+public:
+  static TextureCache& instance() {
+    static TextureCache textureCache;
+    return textureCache;
+  }
+
+  void setDirectory(const std::string &directory);
+  bool isEnabled() { return !getDirectory().empty(); }
+  // nullptr on a miss: no file, made with other settings, or a format this context can't sample
+  std::shared_ptr<Image> open(uint64_t key, bool background = false);
+  GLuint upload(const Image &image); // new texture, mipmapped unless single level, left bound on unit 0; 0 on failure; needs to be run from eglContext synced methods
+  static void uploadLevels(const Image &image); // to the texture bound on the active unit, in any context
+  // downscaled tile or background image, processed and written on the worker thread, which is started on first use
+  void store(uint64_t key, std::shared_ptr<const std::vector<char>> pixels, Size<int> size, GLenum format, bool background = false);
+  void stop(); // waits for the file being written, pending ones are dropped
+  int getStats(int *stats, int count); // returns number of available stats
+};
+
+#endif // _TEXTURE_CACHE_H_
@@ -0,0 +1,105 @@
+#ifndef _TEXTURE_MANAGER_H_
+#define _TEXTURE_MANAGER_H_
+
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "GLES.h"
+#include "MipmapGenerator.h"
+#include "Utility.h"
+
+// Owns the storage of all 2D textures: what each one holds, by category, and how much memory it takes.
+// Uploading an image of unchanged size and format reuses the storage with glTexSubImage2D.
+// Released textures are pooled with their storage and handed out again, preferably for the same size and format.
+// Once all textures take more than Settings::textureBudgetBytes, the pool is dropped first,
+// then categories with an eviction callback are asked to free the difference.
+// Mipmaps are built by MipmapGenerator off the render thread; until collectMipmaps() uploads them, such a texture
+// is sampled from level 0 only. Opaque tile and storyboard images are ETC compressed by EtcEncoder on the same
+// thread once setCompression() is given a quality and the GL implementation supports ETC2 or ETC1;
+// they are stored uncompressed, without mipmaps, until collectMipmaps() replaces them with the blocks.
+class TextureManager {
+public:
+  enum class Category { // in the order reported by getStats()
+    Tile,
+    Storyboard,
+    Icon,
+    Logo,
+    Text,
+    Glyph,
+    Layer,
+    Graph,
+    Console,
+    Pool, // released, kept for reuse
+    Background, // full screen tile images, never compressed; after Pool to keep the order hosts know
+    Count
+  };
+
+  enum class Filter {
+    Nearest,
+    Linear,
+    Mipmap // regenerated after every upload, on the CPU unless disabled with setCpuMipmaps()
+  };
+
+  typedef void (*EvictionCallback)(size_t bytes); // asked to delete at least that many bytes of its textures
+
+private:
+  TextureManager();
+  ~TextureManager() = default;
+  TextureManager(const TextureManager&) = delete;
+  TextureManager& operator=(const TextureManager&) = delete;
+
+  struct Texture {
+    Category category;
+    Filter filter;
+    GLenum format;
+    Size<int> size;
+    size_t bytes; // including mipmaps
+    uint64_t generation; // of content, unique across all textures; mipmaps built from other content are dropped
+    bool mipmapsPending;
+  };
+
+  std::unordered_map<GLuint, Texture> textures;
+  std::deque<GLuint> pool; // oldest first
+  size_t categoryBytes[static_cast<int>(Category::Count)];
+  EvictionCallback evictionCallbacks[static_cast<int>(Category::Count)];
+  size_t totalBytes;
+  uint64_t lastGeneration; // only increases, texture ids are reused once deleted
+  bool evicting;
+  bool cpuMipmaps;
+  int compressionQuality; // EtcEncoder::Quality, -1 for none
+  MipmapGenerator mipmapGenerator;
+
+  GLuint acquire(GLenum format, Size<int> size);
+  void store(GLuint texture, Texture &info, GLenum format, Size<int> size, const void *pixels, GLenum compressedFormat);
+  void compress(GLuint texture, Texture &info, GLenum compressedFormat, GLenum format, Size<int> size, const void *pixels); // on the MipmapGenerator thread
+  void account(Texture &info, Category category, size_t bytes);
+  void destroy(GLuint texture);
+  void enforceBudget();
+
+public:
+  static TextureManager& instance() {
+    static TextureManager textureManager;
+    return textureManager;
+  }
+
+  // texture with GL_UNSIGNED_BYTE pixels (or undefined content for nullptr), left bound on unit 0; 0 on failure
+  GLuint create(Category category, Filter filter, GLenum format, Size<int> size, const void *pixels);
+  void upload(GLuint texture, GLenum format, Size<int> size, const void *pixels); // new content, storage is kept when size and format match
+  void adopt(GLuint texture, Category category, Filter filter, GLenum format, Size<int> size); // texture uploaded in a shared context
+  void release(GLuint texture); // texture id mustn't be used afterwards
+  void setEvictionCallback(Category category, EvictionCallback callback);
+  void clear(); // deletes pooled textures, while the context is still current
+  int collectMipmaps(); // uploads finished mip chains and compressed textures, returns number of textures updated
+  bool hasFinishedMipmaps() { return mipmapGenerator.hasFinished(); }
+  void setCpuMipmaps(bool enable) { cpuMipmaps = enable; }
+  bool isCpuMipmaps() { return cpuMipmaps; }
+  void setCompression(int quality) { compressionQuality = quality; }
+  int getCompressionQuality() { return compressionQuality; }
+  // ETC format the pixels are to be compressed to, GL_NONE if they are uploaded as they are; from any thread
+  GLenum getCompressedFormat(Category category, GLenum format, Size<int> size, const void *pixels);
+  int getStats(int *stats, int count); // KB per category, returns number of available stats
+};
+
+#endif // _TEXTURE_MANAGER_H_
@@ -0,0 +1,84 @@
+#ifndef _TEXTURE_UPLOADER_H_
+#define _TEXTURE_UPLOADER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "GLES.h"
+#include "TextureCache.h"
+#include "Utility.h"
+
+// Uploads tile images and generates their mipmaps on its own thread, in a second EGL context sharing textures
+// with the context current when start() is called, so glTexImage2D and mipmap generation don't stall rendering.
+// Every finished texture is followed by an EGL_KHR_fence_sync fence; collect() on the render thread returns
+// only textures whose fences have signaled. Without fence support the uploader waits with glFinish instead.
+// Opaque images are ETC compressed here as well when TextureManager is set to compress them.
+// Full screen background images are uploaded as a single level from the caller's buffer or a TextureCache mapping,
+// so its page faults are taken here too.
+// EGL is resolved at runtime, like in Utility, and handles are kept as void pointers.
+class TextureUploader {
+public:
+  struct Upload {
+    int tileId;
+    GLuint texture; // mipmapped unless background, owned by the caller from now on
+    Size<int> size;
+    GLuint format; // as uploaded, see PixelConverter, or an ETC format
+    bool background; // see uploadBackground()
+  };
+
+private:
+  struct Job {
+    int tileId;
+    std::vector<char> pixels; // copied, host's buffer is only valid during the call
+    std::shared_ptr<const std::vector<char>> background; // not copied, instead of pixels
+    std::shared_ptr<TextureCache::Image> file; // mapped background, uploaded as it is
+    Size<int> size;
+    GLuint format;
+    bool cpuMipmaps;
+    GLenum compressedFormat; // GL_NONE for uncompressed
+    int quality; // EtcEncoder::Quality
+  };
+
+  struct Finished {
+    Upload upload;
+    void *fence; // EGLSyncKHR, nullptr if the upload has completed already
+  };
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::deque<Job> jobs;
+  std::deque<Finished> finished; // in order of upload() calls
+  bool stopRequested;
+  bool started; // thread got its context current, or gave up
+  bool running;
+  bool fenceSync; // EGL_KHR_fence_sync is supported
+
+  void *display; // EGLDisplay
+  void *context; // EGLContext of the uploader thread
+  void *surface; // EGLSurface, 1x1 pbuffer when EGL_KHR_surfaceless_context isn't supported
+
+  void run();
+  void process(Job &job);
+  bool createContext();
+  void destroyContext();
+  void deleteFinished();
+
+public:
+  TextureUploader();
+  ~TextureUploader();
+  bool start(); // from the render thread, returns false if the shared context can't be used
+  void stop(); // from the render thread, pending uploads are dropped
+  bool isRunning() { return running; }
+  void upload(int tileId, const char *pixels, Size<int> size, GLuint format);
+  void uploadBackground(int tileId, std::shared_ptr<const std::vector<char>> pixels, Size<int> size, GLuint format); // for Tile::setUploadedBackgroundTexture()
+  void uploadBackground(int tileId, std::shared_ptr<TextureCache::Image> file);
+  std::vector<Upload> collect(); // finished uploads ready to be rendered, never blocks on the GPU
+  bool hasFinished(); // uploads completed on the thread but not collected yet
+};
+
+#endif // _TEXTURE_UPLOADER_H_
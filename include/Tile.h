@@ -3,15 +3,29 @@
 
 #include <string>
 #include <chrono>
+#include <memory>
 #include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 #include "GLES.h"
 #include "TileAnimation.h"
 #include "CommonStructs.h"
 #include "ExternStructs.h"
+#include "Storyboard.h"
 #include "Utility.h"
 
 class Tile {
+public:
+  struct BackgroundImage { // tile image at the size Background shows it, when larger than the tile texture
+    std::shared_ptr<const std::vector<char>> pixels; // resized from the host's image, nullptr for none
+    Size<int> size;
+    GLuint format;
+
+    size_t getBytes() const { return pixels ? pixels->size() : 0; }
+  };
+
 private:
   int id;
   Position<int> position;
@@ -27,13 +41,19 @@ private:
   std::chrono::time_point<std::chrono::steady_clock> storyboardPreviewStartTimePoint;
   Rect storytileRect;
   bool previewReady;
-  GLuint previewTextureId = 0;
+  bool previewShown; // getCurrentTextureId() returned a storyboard sheet from StoryboardCache
   SubBitmapExtern storyboardBitmap;
   int bitmapHash;
   StoryboardExternData (*getStoryboardDataCallback)(long long position, int tileId);
+  Storyboard storyboard; // pushed by the host, used instead of the callback when valid
+  int storyboardFrame; // last frame shown from it
 
   GLuint textureId = 0;
   GLuint textureFormat = GL_INVALID_VALUE;
+  int textureVersion = 0; // bumped on every texture upload, textureId is reused
+  BackgroundImage backgroundImage = {}; // dropped by Menu beyond Settings::backgroundImageBudgetBytes
+  GLuint backgroundTextureId = 0; // uploaded from backgroundImage while Background shows the tile
+  uint64_t cacheKey = 0; // of the image in TextureCache, 0 if it isn't cached
 
   static int staticTileObjectCount;
   static GLuint programObject;
@@ -47,7 +67,8 @@ private:
   static GLuint scaleLoc;
   static GLuint storytileRectLoc;
 
-  void initTextures();
+  GLuint getStoryboardTextureId(std::chrono::time_point<std::chrono::steady_clock> now, std::chrono::milliseconds delta);
+  static void requestProgram();
   void initGL();
 
 public:
@@ -67,8 +88,20 @@ public:
   void runPreview(bool run);
   StoryboardExternData getStoryboardData(std::chrono::milliseconds position, int tileId);
   GLuint getCurrentTextureId();
-  void setPreviewTexture(SubBitmapExtern frame);
   void setStoryboardCallback(StoryboardExternData (*getStoryboardDataCallback)(long long position, int tileId));
+  void setUploadedTexture(GLuint texture, Size<int> size, GLuint format); // mipmapped by TextureUploader or TextureCache
+  void setStoryboard(Storyboard storyboard) { this->storyboard.releaseSheets(); this->storyboard = storyboard; storyboardFrame = 0; }
+  void setStoryboardSheet(int sheetIndex, const ImageData &sheet) { storyboard.setSheet(sheetIndex, sheet); }
+  void setBackgroundImage(BackgroundImage image); // without pixels, background shows the tile texture
+  void dropBackgroundImage() { backgroundImage = {}; } // its texture is kept while it's shown
+  const BackgroundImage& getBackgroundImage() { return backgroundImage; }
+  void uploadBackgroundTexture(); // single level, from the background image; Menu uploads it outside of Background::render()
+  void setUploadedBackgroundTexture(GLuint texture, Size<int> size, GLuint format); // by TextureUploader or TextureCache
+  bool hasBackgroundTexture() { return backgroundTextureId != 0; }
+  GLuint getBackgroundTextureId() { return backgroundTextureId != 0 ? backgroundTextureId : textureId; }
+  void releaseBackgroundTexture();
+  void setCacheKey(uint64_t cacheKey) { this->cacheKey = cacheKey; }
+  uint64_t getCacheKey() { return cacheKey; }
 
 
   void setId(int id) { this->id = id; }
@@ -88,6 +121,7 @@ public:
   std::string getDescription() { return description; }
   void setDescription(const std::string &description) { this->description = description; }
   int getTextureId() { return textureId; }
+  int getTextureVersion() { return textureVersion; }
   void setZoom(float zoom) { this->zoom = zoom; }
   void setOpacity(float opacity) { this->opacity = opacity; }
   float getZoom() { return zoom; }
@@ -102,6 +136,7 @@ public:
   float getSourceOpacity() { return animation.isActive() ? animation.getSourceOpacity() : getOpacity(); }
   float getTargetOpacity() { return animation.isActive() ? animation.getTargetOpacity() : getOpacity(); }
   bool isAnimationActive() { return animation.isActive(); }
+  bool isPreviewRunning() { return runningPreview; }
   void setActive(bool value) { active = value; }
   bool isActive() { return active; }
 };
@@ -0,0 +1,64 @@
+#ifndef _TILE_IMAGE_RESIZER_H_
+#define _TILE_IMAGE_RESIZER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "GLES.h"
+#include "Utility.h"
+
+// Downscales host images of tiles with ImageResampler on its own thread, so SetTileData() with full-HD art
+// doesn't spend tens of ms of the render thread. Each image is resized to Settings::tileImageMaxSize for the tile
+// texture and, when it is larger than that, to Settings::backgroundImageMaxSize for the full screen background.
+// Resized images are collected on the render thread, which uploads them like any other tile image.
+class TileImageResizer {
+public:
+  struct Result {
+    int tileId;
+    uint64_t sequence; // returned by resize(), images superseded meanwhile are dropped by the caller
+    std::shared_ptr<std::vector<char>> pixels;
+    Size<int> size;
+    GLuint format;
+    std::shared_ptr<std::vector<char>> backgroundPixels; // nullptr when the image isn't larger than the tile texture
+    Size<int> backgroundSize;
+  };
+
+private:
+  struct Job {
+    int tileId;
+    uint64_t sequence;
+    std::vector<char> pixels; // copied, host's buffer is only valid during the call
+    Size<int> size;
+    GLuint format;
+  };
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::deque<Job> jobs;
+  std::deque<Result> finished;
+  uint64_t lastSequence;
+  bool stopRequested;
+
+  void run();
+  static Result process(Job &job);
+
+public:
+  TileImageResizer();
+  ~TileImageResizer();
+  TileImageResizer(const TileImageResizer&) = delete;
+  TileImageResizer& operator=(const TileImageResizer&) = delete;
+
+  static bool needsResize(Size<int> size); // larger than the tile texture, or a background is kept for it
+  uint64_t resize(int tileId, const char *pixels, Size<int> size, GLuint format); // thread is started on first use
+  std::vector<Result> collect();
+  bool hasFinished();
+  void stop(); // pending images are dropped
+};
+
+#endif // _TILE_IMAGE_RESIZER_H_
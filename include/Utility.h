@@ -3,6 +3,8 @@
 
 #include <string>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 #define logGLErrors() __logGLErrors__(__FILE__, __LINE__)
 
@@ -16,6 +18,9 @@ private:
 public:
   static void __logGLErrors__(const char *filename, int line);
   static std::string getGLErrorString(int err);
+  static bool hasGLExtension(const std::string &extension);
+  static void* getProcAddress(const char *name); // extension entry points, resolved through eglGetProcAddress
+  static uint64_t fnv1a(uint64_t hash, const void *data, size_t length); // 64-bit FNV-1a, first hash is 0xcbf29ce484222325
 };
 
 template<typename T> struct Size;
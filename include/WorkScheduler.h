@@ -0,0 +1,66 @@
+#ifndef _WORK_SCHEDULER_H_
+#define _WORK_SCHEDULER_H_
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+// One-off work deferred from the moment it's needed to the end of a frame: tile uploads, font faces, text rasterization.
+// Menu::render() runs queued tasks, highest priority first, only while the frame is within the budget,
+// so a burst of new content is spread over a few frames. Until its task runs, a widget shows what it had before
+// (or nothing). A task waiting longer than Settings::deferredWorkMaxDelay runs even in a frame over budget.
+// Render thread only.
+class WorkScheduler {
+public:
+  enum class Priority { // in order of execution
+    High,
+    Normal,
+    Low,
+    Count
+  };
+
+  enum class Group { // keys of different groups never replace each other
+    None, // tasks are never replaced
+    TileUpload, // key is the tile id
+    BackgroundUpload, // key is the tile id
+    Text // key is a 64-bit hash of the text, its size and font
+  };
+
+  typedef std::function<void()> Task;
+
+private:
+  WorkScheduler();
+  ~WorkScheduler() = default;
+  WorkScheduler(const WorkScheduler&) = delete;
+  WorkScheduler& operator=(const WorkScheduler&) = delete;
+
+  struct Entry {
+    Group group;
+    uint64_t key;
+    Task task;
+  };
+
+  std::deque<Entry> queues[static_cast<int>(Priority::Count)];
+  std::chrono::microseconds budget;
+  std::chrono::time_point<std::chrono::steady_clock> frameStart;
+  std::chrono::time_point<std::chrono::steady_clock> waitingSince; // last task run, or first one queued after that
+
+  bool pop(Entry &entry);
+
+public:
+  static WorkScheduler& instance() {
+    static WorkScheduler workScheduler;
+    return workScheduler;
+  }
+
+  void schedule(Priority priority, Group group, uint64_t key, Task task); // replaces the task queued with the same group and key in its place
+  void beginFrame() { frameStart = std::chrono::steady_clock::now(); }
+  bool isWithinBudget() { return std::chrono::steady_clock::now() - frameStart < budget; } // inline work still fits this frame
+  int run(); // returns number of tasks run
+  bool hasPending();
+  void clear();
+  void setBudget(std::chrono::microseconds budget) { this->budget = budget; }
+};
+
+#endif // _WORK_SCHEDULER_H_
@@ -1,12 +1,18 @@
 R"(
 
-precision highp float;
+#if __VERSION__ < 130
+#define TEXTURE2D texture2D
+#else
+#define TEXTURE2D texture
+#endif
 
-const int VALUES = 100;
+precision highp float;
 
 uniform vec2 u_position;
 uniform vec2 u_size;
-uniform float u_value[VALUES];
+uniform sampler2D s_values; // 16-bit samples in R (high byte) and G (low byte)
+uniform vec4 u_history;     // texture width, texture height, capacity, number of samples
+uniform float u_start;      // texel of the oldest sample
 uniform float u_opacity;
 
 float rect(vec2 uv, vec2 p, vec2 s) {
@@ -18,11 +24,19 @@ float rectEdge(vec2 uv, vec2 p, vec2 s, float b) {
     return clamp(rect(uv, p, s) - rect(uv, p + b, s - 2. * b), 0., 1.);
 }
 
+float value(float i) { // i-th oldest sample [0.0, 1.0], missing samples are 0.0
+    if(i >= u_history.w)
+        return 0.;
+    float n = mod(u_start + i, u_history.z);
+    vec2 texel = vec2(mod(n, u_history.x), floor(n / u_history.x));
+    vec2 rg = TEXTURE2D(s_values, (texel + .5) / u_history.xy).rg;
+    return dot(floor(rg * 255. + .5), vec2(256., 1.)) / 65535.;
+}
+
 void main() {
-    float f = (gl_FragCoord.x - u_position.x) / u_size.x; // global x position [0.0,1.0]
-    int i = int(f * float(VALUES - 1)); // left value index [0, VALUES - 1]
-    float k = f * float(VALUES - 1) - float(i); // local x pos (btwn samples) [0.0, 1.0]
-    float v = mix(u_value[i], u_value[i + 1], k); // value for current position [0.0, 1.0]
+    float x = (gl_FragCoord.x - u_position.x) / u_size.x * (u_history.z - 1.); // position in samples
+    float i = floor(x); // left sample index
+    float v = mix(value(i), value(i + 1.), x - i); // value for current position [0.0, 1.0]
     float border = rectEdge(gl_FragCoord.xy, u_position, u_size, 1.);
     gl_FragColor = vec4(vec3(mix(smoothstep(0., 4., v * u_size.y - (gl_FragCoord.y - u_position.y)), 1., border)), .75 * u_opacity);
 }
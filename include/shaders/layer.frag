@@ -10,9 +10,10 @@ precision highp float;
 
 varying vec2 v_texCoord;
 uniform sampler2D s_texture;
+uniform float u_opacity;
 
 void main() {
-	gl_FragColor = TEXTURE2D(s_texture, v_texCoord);
+	gl_FragColor = TEXTURE2D(s_texture, v_texCoord) * u_opacity; // layer content is premultiplied
 }
 
 )"
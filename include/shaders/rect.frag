@@ -0,0 +1,36 @@
+R"(
+
+#if __VERSION__ < 130
+#define TEXTURE2D texture2D
+#else
+#define TEXTURE2D texture
+#endif
+
+precision highp float;
+
+varying vec4 v_rect;       // position and size in pixels
+varying vec4 v_fillColor;
+varying vec4 v_frameColor;
+varying vec4 v_style;      // frame width, corner radius, textured
+varying vec2 v_texCoord;
+uniform sampler2D s_texture;
+
+float roundedRect(vec2 uv, vec2 center, vec2 halfSize, float radius) { // signed distance to the edge
+  vec2 q = abs(uv - center) - (halfSize - radius);
+  return length(max(q, vec2(0.))) + min(max(q.x, q.y), 0.) - radius;
+}
+
+void main() {
+  vec2 halfSize = v_rect.zw * .5;
+  float radius = min(v_style.y, min(halfSize.x, halfSize.y));
+  float distance = roundedRect(gl_FragCoord.xy, v_rect.xy + halfSize, halfSize, radius);
+  float inside = clamp(.5 - distance, 0., 1.);
+  float frame = v_style.x > 0. ? clamp(.5 + distance + v_style.x, 0., 1.) : 0.;
+  vec4 fill = v_fillColor;
+  if(v_style.z > .5)
+    fill *= TEXTURE2D(s_texture, v_texCoord);
+  vec4 color = mix(fill, v_frameColor, frame);
+  gl_FragColor = vec4(color.rgb, color.a * inside);
+}
+
+)"
@@ -0,0 +1,25 @@
+R"(
+
+attribute vec2 a_position;
+attribute vec4 a_rect;
+attribute vec4 a_fillColor;
+attribute vec4 a_frameColor;
+attribute vec4 a_style;
+attribute vec2 a_texCoord;
+uniform vec2 u_viewport;
+varying vec4 v_rect;
+varying vec4 v_fillColor;
+varying vec4 v_frameColor;
+varying vec4 v_style;
+varying vec2 v_texCoord;
+
+void main() {
+  v_rect = a_rect;
+  v_fillColor = a_fillColor;
+  v_frameColor = a_frameColor;
+  v_style = a_style;
+  v_texCoord = a_texCoord;
+  gl_Position = vec4(a_position / u_viewport * 2. - 1., 0., 1.);
+}
+
+)"
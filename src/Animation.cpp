@@ -1,5 +1,7 @@
 #include "Animation.h"
 
+#include <algorithm>
+
 Animation::Animation()
   : active(false) {
 }
@@ -76,6 +78,7 @@ std::vector<double> Animation::update() {
     std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::steady_clock::now() - start - delay).count() / duration.count() :
     1.0;
   updateActivity(fraction);
+  fraction = std::min(fraction, 1.0); // last frame has to land exactly on target, it may be kept on screen with partial redraw
 
   std::vector<double> values;
   for(size_t i = 0, sn = source.size(), tn = target.size(); i < sn && i < tn; ++i)
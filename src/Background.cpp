@@ -1,4 +1,5 @@
 #include "Background.h"
+#include "GLState.h"
 #include "ProgramBuilder.h"
 #include "Settings.h"
 #include "TextRenderer.h"
@@ -6,6 +7,18 @@
 
 #include <string>
 
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/background.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/background.frag"
+;
+
+} // namespace
+
 Background::Background()
   : programObject(GL_INVALID_VALUE),
     textureFormat(GL_INVALID_VALUE),
@@ -13,29 +26,22 @@ Background::Background()
     mixing(1.0f),
     lastTile(nullptr),
     currentTile(nullptr),
-    queuedTile(nullptr) {
-  initGL();
+    queuedTile(nullptr),
+    layerContent({0, 0, 0, 0, 0.0f, "", ""}) {
+  ProgramBuilder::prefetchProgram("background", vShaderTexStr, fShaderTexStr);
 }
 
 Background::~Background() {
   assertCurrentEGLContext();
 
   if(programObject != GL_INVALID_VALUE)
-    glDeleteProgram(programObject);
+    GLState::instance().deleteProgram(programObject);
 }
 
 void Background::initGL() {
   assertCurrentEGLContext();
 
-  const GLchar* vShaderTexStr = 
-#include "shaders/background.vert"
-;
- 
-  const GLchar* fShaderTexStr =  
-#include "shaders/background.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "background");
 
   posLoc = glGetAttribLocation(programObject, "a_position");
   texLoc = glGetAttribLocation(programObject, "a_texCoord");
@@ -50,15 +56,36 @@ void Background::render() {
   assertCurrentEGLContext();
 
   opacity = getOpacity();
-  if(opacity < 0.001f)
+  if(opacity < 0.001f) {
+    layer.release(); // hidden during playback, no need to keep full screen texture
     return;
+  }
 
-  GLuint textureId = currentTile != nullptr ? currentTile->getTextureId() : 0;
+  GLuint textureId = currentTile != nullptr ? currentTile->getBackgroundTextureId() : 0;
   if(!textureId)
     return;
-  GLuint texture2Id = lastTile != nullptr ? lastTile->getTextureId() : 0;
-  if(texture2Id == 0)
-    texture2Id = textureId;
+  Tile *tile2 = lastTile != nullptr && lastTile->getTextureId() != 0 ? lastTile : currentTile;
+  GLuint texture2Id = tile2->getBackgroundTextureId();
+
+  std::vector<double> updated = animation.update();
+  if(!updated.empty())
+    mixing = updated[0];
+
+  LayerContent content = { textureId, texture2Id, currentTile->getTextureVersion(), tile2->getTextureVersion(), mixing, currentTile->getName(), currentTile->getDescription() };
+  if(!(content == layerContent)) {
+    layerContent = content;
+    layer.invalidate();
+  }
+  layer.update([&]() {
+    renderBackground(textureId, texture2Id);
+    renderNameAndDescription();
+  });
+  layer.composite(opacity);
+}
+
+void Background::renderBackground(GLuint textureId, GLuint texture2Id) {
+  if(programObject == GL_INVALID_VALUE)
+    initGL();
 
   float left = -1.0;
   float right = 1.0;
@@ -74,37 +101,23 @@ void Background::render() {
   float texCoord[] = { 0.0f, 0.0f,    0.0f, 1.0f,
                        1.0f, 1.0f,    1.0f, 0.0f };
                        
-  glUseProgram(programObject);
+  GLState::instance().useProgram(programObject);
 
-  glUniform1f(opacityLoc, static_cast<GLfloat>(opacity));
+  GLState::instance().uniform1f(opacityLoc, 1.0f); // opacity is applied to the whole layer
+  GLState::instance().uniform1f(mixingLoc, static_cast<GLfloat>(mixing));
+  GLState::instance().uniform2f(viewportLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
 
-  std::vector<double> updated = animation.update();
-  if(!updated.empty())
-    mixing = updated[0];
-  glUniform1f(mixingLoc, static_cast<GLfloat>(mixing));
-  glUniform2f(viewportLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
+  GLState::instance().bindTexture(0, textureId);
+  GLState::instance().uniform1i(samplerLoc, 0);
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textureId);
-  glUniform1i(samplerLoc, 0);
+  GLState::instance().bindTexture(1, texture2Id);
+  GLState::instance().uniform1i(sampler2Loc, 1);
 
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, texture2Id);
-  glUniform1i(sampler2Loc, 1);
-
-  glEnableVertexAttribArray(posLoc);
+  GLState::instance().vertexAttribArrays({posLoc, texLoc});
   glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
-  glEnableVertexAttribArray(texLoc);
   glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(posLoc);
-  glDisableVertexAttribArray(texLoc);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glUseProgram(0);
-
-  renderNameAndDescription();
 }
 
 void Background::renderNameAndDescription() {
@@ -118,7 +131,7 @@ void Background::renderNameAndDescription() {
                 {leftText, topText},
                 {Settings::instance().viewport.width - 2 * leftText, fontHeight},
                 0,
-                {1.0, 1.0, 1.0, opacity});
+                {1.0, 1.0, 1.0, 1.0});
 
     textLineOffset = TextRenderer::instance().getTextSize(
                        name,
@@ -135,7 +148,7 @@ void Background::renderNameAndDescription() {
                 {leftText, topText},
                 {Settings::instance().viewport.width - 2 * leftText, fontHeight},
                 0,
-                {1.0, 1.0, 1.0, opacity});
+                {1.0, 1.0, 1.0, 1.0});
   }
 }
 
@@ -149,13 +162,18 @@ float Background::getOpacity() {
 
 void Background::setSourceTile(Tile *tile) {
   if(animation.isActive() && !animation.isDuringDelay()) {
+    Tile *previousQueued = queuedTile;
     queuedTile = tile;
+    releaseUnusedTexture(previousQueued);
     return;
   }
 
+  Tile *previousLast = lastTile, *previousCurrent = currentTile;
   if(tile != currentTile && !animation.isActive())
     lastTile = currentTile;
   currentTile = tile;
+  releaseUnusedTexture(previousLast);
+  releaseUnusedTexture(previousCurrent);
 
   runBackgroundChangeAnimation();
 }
@@ -164,13 +182,20 @@ void Background::endAnimation() {
   if(queuedTile == nullptr)
     return;
 
+  Tile *previousLast = lastTile;
   lastTile = currentTile;
   currentTile = queuedTile;
   queuedTile = nullptr;
+  releaseUnusedTexture(previousLast);
 
   runBackgroundChangeAnimation();
 }
 
+void Background::releaseUnusedTexture(Tile *tile) { // full screen textures are kept only for tiles shown
+  if(tile != nullptr && !isShown(tile))
+    tile->releaseBackgroundTexture();
+}
+
 void Background::runBackgroundChangeAnimation() {
   animation = Animation(Settings::instance().backgroundChangeDuration,
                         Settings::instance().backgroundChangeDelay,
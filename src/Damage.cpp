@@ -0,0 +1,75 @@
+#include "Damage.h"
+#include "Settings.h"
+
+#include <algorithm>
+
+Damage::Damage()
+  : full(false) {
+}
+
+void Damage::add(Position<int> position, Size<int> size) {
+  if(full)
+    return;
+
+  // clip to viewport
+  int left = std::max(position.x, 0);
+  int down = std::max(position.y, 0);
+  int right = std::min(position.x + size.width, Settings::instance().viewport.width);
+  int top = std::min(position.y + size.height, Settings::instance().viewport.height);
+  if(right <= left || top <= down)
+    return;
+
+  for(Region &region : regions) { // merge with a region that already contains or is contained by the new one
+    int regionRight = region.position.x + region.size.width;
+    int regionTop = region.position.y + region.size.height;
+    if(region.position.x <= left && region.position.y <= down && regionRight >= right && regionTop >= top)
+      return;
+    if(left <= region.position.x && down <= region.position.y && right >= regionRight && top >= regionTop) {
+      region = Region { { left, down }, { right - left, top - down } };
+      return;
+    }
+  }
+  regions.push_back(Region { { left, down }, { right - left, top - down } });
+}
+
+void Damage::add(const Damage &other) {
+  if(other.full)
+    addFull();
+  for(const Region &region : other.regions)
+    add(region.position, region.size);
+}
+
+void Damage::addFull() {
+  full = true;
+  regions.clear();
+}
+
+void Damage::clear() {
+  full = false;
+  regions.clear();
+}
+
+Damage::Region Damage::getBounds() const {
+  if(full)
+    return Region { { 0, 0 }, Settings::instance().viewport };
+  if(regions.empty())
+    return Region { { 0, 0 }, { 0, 0 } };
+
+  int left = regions[0].position.x;
+  int down = regions[0].position.y;
+  int right = left + regions[0].size.width;
+  int top = down + regions[0].size.height;
+  for(const Region &region : regions) {
+    left = std::min(left, region.position.x);
+    down = std::min(down, region.position.y);
+    right = std::max(right, region.position.x + region.size.width);
+    top = std::max(top, region.position.y + region.size.height);
+  }
+  return Region { { left, down }, { right - left, top - down } };
+}
+
+std::vector<Damage::Region> Damage::getRegions() const {
+  if(full)
+    return { getBounds() };
+  return regions;
+}
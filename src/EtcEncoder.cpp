@@ -0,0 +1,453 @@
+#include "EtcEncoder.h"
+#include "GLState.h"
+#include "MipmapGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const int MODIFIERS[8][2] = { {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183} };
+const int MAX_THREADS = 4;
+
+struct Color {
+  int r, g, b;
+};
+
+struct Half {
+  Color base;
+  int table;
+  unsigned int error;
+  uint8_t indices[8]; // pixel index codes, msb << 1 | lsb
+};
+
+struct Candidate {
+  bool differential;
+  int flip;
+  Color quantized[2]; // 5 bits for differential mode, 4 for individual
+  Half halves[2];
+  unsigned int error;
+};
+
+int clampByte(int value) {
+  return std::min(std::max(value, 0), 255);
+}
+
+int expand5(int value) {
+  return (value << 3) | (value >> 2);
+}
+
+int expand4(int value) {
+  return value | (value << 4);
+}
+
+int modifierFor(int table, int code) { // codes: 0 = +small, 1 = +large, 2 = -small, 3 = -large
+  int modifier = MODIFIERS[table][code & 1];
+  return code & 2 ? -modifier : modifier;
+}
+
+unsigned int getError(Color pixel, Color base, int modifier) {
+  int dr = clampByte(base.r + modifier) - pixel.r;
+  int dg = clampByte(base.g + modifier) - pixel.g;
+  int db = clampByte(base.b + modifier) - pixel.b;
+  return static_cast<unsigned int>(dr * dr + dg * dg + db * db);
+}
+
+// Best table and per pixel modifiers for 8 pixels around a decoded base color. Unless exhaustive, the modifier
+// of a pixel is the one nearest to its brightness difference from the base, which is exact except near clamping.
+void fitHalf(const Color *pixels, Color base, unsigned int limit, bool exhaustive, Half &half) {
+  half.base = base;
+  half.error = UINT_MAX;
+  int differences[8];
+  for(int p = 0; p < 8; ++p)
+    differences[p] = (pixels[p].r - base.r) + (pixels[p].g - base.g) + (pixels[p].b - base.b);
+
+  for(int table = 0; table < 8; ++table) {
+    unsigned int error = 0;
+    uint8_t indices[8];
+    int threshold = 3 * (MODIFIERS[table][0] + MODIFIERS[table][1]) / 2; // between small and large modifier, times 3 channels
+    for(int p = 0; p < 8 && error < limit && error < half.error; ++p) {
+      if(!exhaustive) {
+        int code = (differences[p] < 0 ? 2 : 0) | (std::abs(differences[p]) > threshold ? 1 : 0);
+        indices[p] = static_cast<uint8_t>(code);
+        error += getError(pixels[p], base, modifierFor(table, code));
+        continue;
+      }
+      unsigned int best = UINT_MAX;
+      for(int code = 0; code < 4; ++code) {
+        unsigned int e = getError(pixels[p], base, modifierFor(table, code));
+        if(e < best) {
+          best = e;
+          indices[p] = static_cast<uint8_t>(code);
+        }
+      }
+      error += best;
+    }
+    if(error < half.error && error < limit) {
+      half.error = error;
+      half.table = table;
+      std::copy(indices, indices + 8, half.indices);
+    }
+  }
+}
+
+Color average(const Color *pixels) {
+  Color sum = { 0, 0, 0 };
+  for(int p = 0; p < 8; ++p) {
+    sum.r += pixels[p].r;
+    sum.g += pixels[p].g;
+    sum.b += pixels[p].b;
+  }
+  return Color { sum.r, sum.g, sum.b }; // times 8
+}
+
+Color quantize(Color sum, int levels) {
+  return Color { (sum.r * levels + 255 * 4) / (255 * 8), (sum.g * levels + 255 * 4) / (255 * 8), (sum.b * levels + 255 * 4) / (255 * 8) };
+}
+
+Color expand(Color quantized, bool differential) {
+  if(differential)
+    return Color { expand5(quantized.r), expand5(quantized.g), expand5(quantized.b) };
+  return Color { expand4(quantized.r), expand4(quantized.g), expand4(quantized.b) };
+}
+
+bool isDeltaValid(Color first, Color second) {
+  return second.r - first.r >= -4 && second.r - first.r <= 3 && second.g - first.g >= -4 && second.g - first.g <= 3 && second.b - first.b >= -4 && second.b - first.b <= 3;
+}
+
+// Quantized base color near start with the smallest error, one step away in a channel or in brightness
+Color refine(const Color *pixels, Color start, bool differential, Half &half) {
+  static const int steps[8][3] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {1, 1, 1}, {-1, -1, -1} };
+  int maximum = differential ? 31 : 15;
+  Color best = start;
+  fitHalf(pixels, expand(start, differential), UINT_MAX, false, half);
+  for(const int *step : steps) {
+    Color candidate = { start.r + step[0], start.g + step[1], start.b + step[2] };
+    if(candidate.r < 0 || candidate.g < 0 || candidate.b < 0 || candidate.r > maximum || candidate.g > maximum || candidate.b > maximum)
+      continue;
+    Half trial;
+    fitHalf(pixels, expand(candidate, differential), half.error, false, trial);
+    if(trial.error < half.error) {
+      half = trial;
+      best = candidate;
+    }
+  }
+  return best;
+}
+
+void tryMode(const Color halves[2][8], int flip, bool differential, EtcEncoder::Quality quality, Candidate &best) {
+  Candidate candidate;
+  candidate.differential = differential;
+  candidate.flip = flip;
+  for(int h = 0; h < 2; ++h)
+    candidate.quantized[h] = quantize(average(halves[h]), differential ? 31 : 15);
+  if(differential && !isDeltaValid(candidate.quantized[0], candidate.quantized[1]))
+    return;
+
+  bool exhaustive = quality == EtcEncoder::Quality::High;
+  for(int h = 0; h < 2; ++h)
+    fitHalf(halves[h], expand(candidate.quantized[h], differential), UINT_MAX, exhaustive, candidate.halves[h]);
+  candidate.error = candidate.halves[0].error + candidate.halves[1].error;
+
+  if(quality == EtcEncoder::Quality::High && candidate.error > 0) {
+    Candidate refined = candidate;
+    for(int h = 0; h < 2; ++h) {
+      refined.quantized[h] = refine(halves[h], candidate.quantized[h], differential, refined.halves[h]);
+      fitHalf(halves[h], expand(refined.quantized[h], differential), UINT_MAX, true, refined.halves[h]);
+    }
+    refined.error = refined.halves[0].error + refined.halves[1].error;
+    if(refined.error < candidate.error && (!differential || isDeltaValid(refined.quantized[0], refined.quantized[1])))
+      candidate = refined;
+  }
+  if(candidate.error < best.error)
+    best = candidate;
+}
+
+void writeBlock(const Candidate &block, uint8_t *out) {
+  uint32_t r1 = block.quantized[0].r, g1 = block.quantized[0].g, b1 = block.quantized[0].b;
+  uint32_t r2 = block.quantized[1].r, g2 = block.quantized[1].g, b2 = block.quantized[1].b;
+  uint32_t high = 0;
+  if(block.differential) // second color as 3-bit two's complement delta
+    high = (r1 << 27) | (((r2 - r1) & 7) << 24) | (g1 << 19) | (((g2 - g1) & 7) << 16) | (b1 << 11) | (((b2 - b1) & 7) << 8) | (1 << 1);
+  else
+    high = (r1 << 28) | (r2 << 24) | (g1 << 20) | (g2 << 16) | (b1 << 12) | (b2 << 8);
+  high |= static_cast<uint32_t>((block.halves[0].table << 5) | (block.halves[1].table << 2) | block.flip);
+
+  uint32_t low = 0;
+  int counts[2] = { 0, 0 };
+  for(int x = 0; x < 4; ++x) { // same pixel order as in encodeBlock()
+    for(int y = 0; y < 4; ++y) {
+      int h = block.flip ? y / 2 : x / 2;
+      int code = block.halves[h].indices[counts[h]++];
+      int bit = x * 4 + y;
+      low |= static_cast<uint32_t>((code >> 1) & 1) << (bit + 16);
+      low |= static_cast<uint32_t>(code & 1) << bit;
+    }
+  }
+  for(int i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(high >> (24 - i * 8));
+    out[4 + i] = static_cast<uint8_t>(low >> (24 - i * 8));
+  }
+}
+
+void encodeBlock(const Color pixels[4][4], EtcEncoder::Quality quality, uint8_t *out) {
+  Candidate best;
+  best.error = UINT_MAX;
+  for(int flip = 0; flip < 2; ++flip) {
+    Color halves[2][8];
+    int counts[2] = { 0, 0 };
+    for(int x = 0; x < 4; ++x) {
+      for(int y = 0; y < 4; ++y) {
+        int h = flip ? y / 2 : x / 2;
+        halves[h][counts[h]++] = pixels[y][x];
+      }
+    }
+    tryMode(halves, flip, true, quality, best);
+    if(quality != EtcEncoder::Quality::Fast || best.error == UINT_MAX)
+      tryMode(halves, flip, false, quality, best);
+  }
+  writeBlock(best, out);
+}
+
+struct Layout {
+  int bpp;
+  int red, green, blue; // byte offsets
+};
+
+Layout getLayout(GLenum format) {
+  if(format == GL_BGRA_EXT)
+    return Layout { 4, 2, 1, 0 };
+  if(format == GL_RGB)
+    return Layout { 3, 0, 1, 2 };
+  return Layout { 4, 0, 1, 2 };
+}
+
+void encodeRows(const uint8_t *pixels, Size<int> size, Layout layout, EtcEncoder::Quality quality, int firstRow, int lastRow, uint8_t *out) {
+  int blocksX = (size.width + 3) / 4;
+  for(int by = firstRow; by < lastRow; ++by) {
+    for(int bx = 0; bx < blocksX; ++bx) {
+      Color block[4][4];
+      for(int y = 0; y < 4; ++y) {
+        int py = std::min(by * 4 + y, size.height - 1); // partial blocks repeat the last row and column
+        for(int x = 0; x < 4; ++x) {
+          int px = std::min(bx * 4 + x, size.width - 1);
+          const uint8_t *pixel = pixels + (static_cast<size_t>(py) * size.width + px) * layout.bpp;
+          block[y][x] = Color { pixel[layout.red], pixel[layout.green], pixel[layout.blue] };
+        }
+      }
+      encodeBlock(block, quality, out + (static_cast<size_t>(by) * blocksX + bx) * 8);
+    }
+  }
+}
+
+void decodeBlock(const uint8_t *in, uint8_t out[4][4][3]) {
+  uint32_t high = (static_cast<uint32_t>(in[0]) << 24) | (in[1] << 16) | (in[2] << 8) | in[3];
+  uint32_t low = (static_cast<uint32_t>(in[4]) << 24) | (in[5] << 16) | (in[6] << 8) | in[7];
+  bool flip = high & 1;
+  Color bases[2];
+  if(high & 2) {
+    Color first = { static_cast<int>(high >> 27) & 31, static_cast<int>(high >> 19) & 31, static_cast<int>(high >> 11) & 31 };
+    int dr = static_cast<int>((high >> 24) & 7), dg = static_cast<int>((high >> 16) & 7), db = static_cast<int>((high >> 8) & 7);
+    Color second = { first.r + (dr > 3 ? dr - 8 : dr), first.g + (dg > 3 ? dg - 8 : dg), first.b + (db > 3 ? db - 8 : db) };
+    bases[0] = expand(first, true);
+    bases[1] = expand(second, true);
+  }
+  else {
+    bases[0] = expand(Color { static_cast<int>(high >> 28) & 15, static_cast<int>(high >> 20) & 15, static_cast<int>(high >> 12) & 15 }, false);
+    bases[1] = expand(Color { static_cast<int>(high >> 24) & 15, static_cast<int>(high >> 16) & 15, static_cast<int>(high >> 8) & 15 }, false);
+  }
+  int tables[2] = { static_cast<int>(high >> 5) & 7, static_cast<int>(high >> 2) & 7 };
+  for(int x = 0; x < 4; ++x) {
+    for(int y = 0; y < 4; ++y) {
+      int h = flip ? y / 2 : x / 2;
+      int bit = x * 4 + y;
+      int code = static_cast<int>((((low >> (bit + 16)) & 1) << 1) | ((low >> bit) & 1));
+      int modifier = modifierFor(tables[h], code);
+      out[y][x][0] = static_cast<uint8_t>(clampByte(bases[h].r + modifier));
+      out[y][x][1] = static_cast<uint8_t>(clampByte(bases[h].g + modifier));
+      out[y][x][2] = static_cast<uint8_t>(clampByte(bases[h].b + modifier));
+    }
+  }
+}
+
+// Threads encode() splits images over, started on first use and kept; starting threads for every mip level cost
+// about as much as encoding the small ones. Callers take parts of their own batch too, so an encode finishes even
+// while all workers are busy with another one. Never destroyed, encoding threads may still use it during static destruction.
+class WorkerPool {
+private:
+  struct Batch {
+    std::function<void(int)> task;
+    int next;
+    int count;
+    int finished;
+  };
+
+  int workers = 0; // detached
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::condition_variable batchFinished;
+  std::deque<std::shared_ptr<Batch>> batches; // with parts not taken yet
+
+  WorkerPool() = default;
+
+  bool runPart(std::unique_lock<std::mutex> &lock, Batch &batch) { // lock is held again on return
+    if(batch.next == batch.count)
+      return false;
+    int part = batch.next++;
+    if(batch.next == batch.count)
+      batches.erase(std::find_if(batches.begin(), batches.end(), [&batch](const std::shared_ptr<Batch> &queued) { return queued.get() == &batch; }));
+    lock.unlock();
+    batch.task(part);
+    lock.lock();
+    if(++batch.finished == batch.count)
+      batchFinished.notify_all();
+    return true;
+  }
+
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+      wakeUp.wait(lock, [this] { return !batches.empty(); });
+      std::shared_ptr<Batch> batch = batches.front(); // kept alive until its part is counted
+      runPart(lock, *batch);
+    }
+  }
+
+public:
+  static WorkerPool& instance() {
+    static WorkerPool *pool = new WorkerPool();
+    return *pool;
+  }
+
+  void run(int count, std::function<void(int)> task) { // task(0) .. task(count - 1), returns once all finished
+    if(count <= 1) {
+      task(0);
+      return;
+    }
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>(Batch { std::move(task), 0, count, 0 });
+    std::unique_lock<std::mutex> lock(mutex);
+    for(; workers < MAX_THREADS - 1; ++workers)
+      std::thread(&WorkerPool::work, this).detach();
+    batches.push_back(batch);
+    wakeUp.notify_all();
+    while(runPart(lock, *batch))
+      ;
+    batchFinished.wait(lock, [&batch] { return batch->finished == batch->count; });
+  }
+};
+
+} // namespace
+
+size_t EtcEncoder::getEncodedSize(Size<int> size) {
+  return static_cast<size_t>((size.width + 3) / 4) * ((size.height + 3) / 4) * 8;
+}
+
+bool EtcEncoder::isOpaque(const char *pixels, Size<int> size, GLenum format) {
+  if(format == GL_RGB)
+    return true;
+  if(format != GL_RGBA && format != GL_BGRA_EXT)
+    return false;
+  size_t count = static_cast<size_t>(size.width) * size.height;
+  const uint8_t *alpha = reinterpret_cast<const uint8_t*>(pixels) + 3;
+  for(size_t i = 0; i < count; ++i) {
+    if(alpha[i * 4] != 255)
+      return false;
+  }
+  return true;
+}
+
+std::vector<char> EtcEncoder::encode(const char *pixels, Size<int> size, GLenum format, Quality quality, int threads) {
+  std::vector<char> result(getEncodedSize(size));
+  if(pixels == nullptr || size.width <= 0 || size.height <= 0)
+    return result;
+
+  const uint8_t *src = reinterpret_cast<const uint8_t*>(pixels);
+  uint8_t *out = reinterpret_cast<uint8_t*>(result.data());
+  Layout layout = getLayout(format);
+  int blockRows = (size.height + 3) / 4;
+  threads = std::max(1, std::min(threads, blockRows / 8)); // a thread for less than 8 rows of blocks doesn't pay off
+
+  WorkerPool::instance().run(threads, [=](int part) {
+    encodeRows(src, size, layout, quality, blockRows * part / threads, blockRows * (part + 1) / threads, out);
+  });
+  return result;
+}
+
+std::vector<EtcEncoder::Level> EtcEncoder::encodeChain(const char *pixels, Size<int> size, GLenum format, Quality quality, bool mipmaps) {
+  int threads = std::max(1, std::min(MAX_THREADS, static_cast<int>(std::thread::hardware_concurrency())));
+  std::vector<Level> levels;
+  levels.push_back({ size, encode(pixels, size, format, quality, threads) });
+  if(!mipmaps)
+    return levels;
+  for(const MipmapGenerator::Level &level : MipmapGenerator::buildChain(pixels, size, format))
+    levels.push_back({ level.size, encode(level.pixels.data(), level.size, format, quality, threads) });
+  return levels;
+}
+
+void EtcEncoder::uploadChain(const std::vector<Level> &levels, GLenum compressedFormat) {
+  for(size_t i = 0; i < levels.size(); ++i)
+    glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), compressedFormat, levels[i].size.width, levels[i].size.height, 0, static_cast<GLsizei>(levels[i].data.size()), levels[i].data.data());
+}
+
+int EtcEncoder::benchmark(Size<int> size, Quality quality, int threads, int *results, int count) {
+  const int available = 3;
+  if(size.width <= 0 || size.height <= 0)
+    return available;
+
+  std::vector<char> pixels(static_cast<size_t>(size.width) * size.height * 3);
+  uint32_t seed = 12345;
+  for(int y = 0; y < size.height; ++y) { // gradients with noise and hard edges, like photos with text on them
+    for(int x = 0; x < size.width; ++x) {
+      seed = seed * 1664525u + 1013904223u;
+      int noise = static_cast<int>(seed >> 28) - 8;
+      bool edge = (x / 37 + y / 23) % 5 == 0;
+      char *pixel = &pixels[(static_cast<size_t>(y) * size.width + x) * 3];
+      pixel[0] = static_cast<char>(clampByte((edge ? 230 : x * 255 / size.width) + noise));
+      pixel[1] = static_cast<char>(clampByte((edge ? 20 : y * 255 / size.height) + noise));
+      pixel[2] = static_cast<char>(clampByte((x + y) * 128 / (size.width + size.height) + 64 + noise));
+    }
+  }
+
+  std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+  std::vector<char> encoded = encode(pixels.data(), size, GL_RGB, quality, std::max(threads, 1));
+  long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+  double squaredError = 0.0;
+  int blocksX = (size.width + 3) / 4;
+  for(int by = 0; by < (size.height + 3) / 4; ++by) {
+    for(int bx = 0; bx < blocksX; ++bx) {
+      uint8_t decoded[4][4][3];
+      decodeBlock(reinterpret_cast<const uint8_t*>(&encoded[(static_cast<size_t>(by) * blocksX + bx) * 8]), decoded);
+      for(int y = 0; y < 4 && by * 4 + y < size.height; ++y) {
+        for(int x = 0; x < 4 && bx * 4 + x < size.width; ++x) {
+          const char *pixel = &pixels[((static_cast<size_t>(by) * 4 + y) * size.width + bx * 4 + x) * 3];
+          for(int c = 0; c < 3; ++c) {
+            double d = static_cast<double>(decoded[y][x][c]) - static_cast<uint8_t>(pixel[c]);
+            squaredError += d * d;
+          }
+        }
+      }
+    }
+  }
+  double mse = squaredError / (static_cast<double>(size.width) * size.height * 3);
+  double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+
+  int values[available] = {
+    static_cast<int>(elapsed),
+    static_cast<int>(static_cast<double>(size.width) * size.height * 1000.0 / std::max(elapsed, 1LL)),
+    static_cast<int>(psnr * 100.0)
+  };
+  for(int i = 0; results != nullptr && i < std::min(count, available); ++i)
+    results[i] = values[i];
+  return available;
+}
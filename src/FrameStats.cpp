@@ -0,0 +1,72 @@
+#include "FrameStats.h"
+
+#include <cmath>
+#include <algorithm>
+
+FrameStats::FrameStats()
+  : histogram(BUCKETS_PER_OCTAVE * OCTAVES, 0),
+    frames(0),
+    maxMs(0.0f),
+    jankFrames(0),
+    severeJankFrames(0) {
+}
+
+int FrameStats::getBucket(float ms) {
+  if(ms <= MIN_MS)
+    return 0;
+  int bucket = static_cast<int>(std::log2(ms / MIN_MS) * BUCKETS_PER_OCTAVE);
+  return std::min(bucket, BUCKETS_PER_OCTAVE * OCTAVES - 1);
+}
+
+float FrameStats::getBucketUpperBound(int bucket) {
+  return MIN_MS * std::exp2(static_cast<float>(bucket + 1) / BUCKETS_PER_OCTAVE);
+}
+
+FrameStats::Jank FrameStats::add(float ms, float budgetMs) {
+  ++histogram[getBucket(ms)];
+  ++frames;
+  maxMs = std::max(maxMs, ms);
+  if(ms > 2.0f * budgetMs) {
+    ++jankFrames;
+    ++severeJankFrames;
+    return Jank::Severe;
+  }
+  if(ms > 1.5f * budgetMs) {
+    ++jankFrames;
+    return Jank::Jank;
+  }
+  return Jank::None;
+}
+
+float FrameStats::getPercentile(float percentile) {
+  if(frames == 0)
+    return 0.0f;
+  unsigned int rank = static_cast<unsigned int>(std::ceil(percentile / 100.0f * frames));
+  unsigned int counted = 0;
+  for(int bucket = 0; bucket < static_cast<int>(histogram.size()); ++bucket) {
+    counted += histogram[bucket];
+    if(counted >= rank)
+      return std::min(getBucketUpperBound(bucket), maxMs);
+  }
+  return maxMs;
+}
+
+FrameStats::Summary FrameStats::getSummary() {
+  Summary summary;
+  summary.frames = static_cast<int>(frames);
+  summary.p50 = getPercentile(50.0f);
+  summary.p90 = getPercentile(90.0f);
+  summary.p99 = getPercentile(99.0f);
+  summary.max = maxMs;
+  summary.jankFrames = static_cast<int>(jankFrames);
+  summary.severeJankFrames = static_cast<int>(severeJankFrames);
+  return summary;
+}
+
+void FrameStats::reset() {
+  std::fill(histogram.begin(), histogram.end(), 0);
+  frames = 0;
+  maxMs = 0.0f;
+  jankFrames = 0;
+  severeJankFrames = 0;
+}
@@ -0,0 +1,269 @@
+#include "GLState.h"
+#include "EtcEncoder.h"
+#include "Utility.h"
+
+#include <algorithm>
+#include <cstring>
+
+GLState::GLState()
+  : textureBytes(0),
+    currentUniforms(nullptr) {
+  std::fill(issued, issued + static_cast<int>(Stat::Count), 0);
+  std::fill(suppressed, suppressed + static_cast<int>(Stat::Count), 0);
+  invalidate();
+}
+
+void GLState::invalidate() {
+  program = UNKNOWN;
+  activeTextureUnit = UNKNOWN;
+  std::fill(textures, textures + TEXTURE_UNITS, UNKNOWN);
+  enabledAttribs = 0;
+  attribsKnown = false;
+  maxAttribs = 0;
+  blendKnown = false;
+  capabilities.clear();
+  uniforms.clear();
+  currentUniforms = nullptr;
+}
+
+bool GLState::count(Stat stat, bool changed) {
+  if(changed)
+    ++issued[static_cast<int>(stat)];
+  else
+    ++suppressed[static_cast<int>(stat)];
+  return changed;
+}
+
+void GLState::useProgram(GLuint program) {
+  if(count(Stat::Program, program != this->program))
+    glUseProgram(program);
+  this->program = program;
+  currentUniforms = program != 0 ? &uniforms[program] : nullptr;
+}
+
+void GLState::deleteProgram(GLuint program) {
+  glDeleteProgram(program);
+  uniforms.erase(program);
+  if(this->program == program) { // stays in use until another program is bound, its name must not be trusted anymore
+    this->program = UNKNOWN;
+    currentUniforms = nullptr;
+  }
+}
+
+void GLState::setActiveTextureUnit(GLuint unit) {
+  if(unit != activeTextureUnit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    activeTextureUnit = unit;
+  }
+}
+
+void GLState::bindTexture(GLuint unit, GLuint texture) {
+  if(unit >= TEXTURE_UNITS) {
+    activeTextureUnit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    count(Stat::Texture, true);
+    return;
+  }
+  if(!count(Stat::Texture, textures[unit] != texture)) {
+    // texture functions (glTexImage2D, glGenerateMipmap...) work on the active unit
+    setActiveTextureUnit(unit);
+    return;
+  }
+  setActiveTextureUnit(unit);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  textures[unit] = texture;
+}
+
+void GLState::deleteTexture(GLuint texture) {
+  if(texture == 0)
+    return;
+  glDeleteTextures(1, &texture);
+  for(GLuint &bound : textures) { // deleted texture is unbound from every unit
+    if(bound == texture)
+      bound = 0;
+  }
+  setTextureBytes(texture, { 0, false });
+}
+
+void GLState::setTextureBytes(GLuint texture, TextureSize size) {
+  std::unordered_map<GLuint, TextureSize>::iterator it = textureSizes.find(texture);
+  size_t previous = 0;
+  if(it != textureSizes.end()) {
+    previous = it->second.mipmaps ? it->second.bytes * 4 / 3 : it->second.bytes;
+    textureSizes.erase(it);
+  }
+  if(size.bytes > 0)
+    textureSizes[texture] = size;
+  size_t current = size.mipmaps ? size.bytes * 4 / 3 : size.bytes;
+  textureBytes.fetch_add(current - previous, std::memory_order_relaxed); // wraps around correctly when shrinking
+}
+
+size_t GLState::getTextureBytes(GLuint texture) {
+  std::unordered_map<GLuint, TextureSize>::iterator it = textureSizes.find(texture);
+  if(it == textureSizes.end())
+    return 0;
+  return it->second.mipmaps ? it->second.bytes * 4 / 3 : it->second.bytes;
+}
+
+void GLState::texImage2D(GLenum format, GLsizei width, GLsizei height, const void *pixels) {
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+  if(activeTextureUnit >= TEXTURE_UNITS || textures[activeTextureUnit] == UNKNOWN || textures[activeTextureUnit] == 0)
+    return;
+  setTextureStorage(textures[activeTextureUnit], format, width, height, false);
+}
+
+void GLState::setTextureStorage(GLuint texture, GLenum format, GLsizei width, GLsizei height, bool mipmaps) {
+  setTextureBytes(texture, { getImageBytes(format, width, height), mipmaps });
+}
+
+size_t GLState::getImageBytes(GLenum format, GLsizei width, GLsizei height) {
+  if(format == GL_ETC1_RGB8_OES || format == GL_COMPRESSED_RGB8_ETC2)
+    return EtcEncoder::getEncodedSize(Size<int>(width, height));
+  return static_cast<size_t>(width) * height * getBytesPerPixel(format);
+}
+
+size_t GLState::getBytesPerPixel(GLenum format) {
+  switch(format) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+  }
+  return 4;
+}
+
+void GLState::generateMipmap() {
+  glGenerateMipmap(GL_TEXTURE_2D);
+  if(activeTextureUnit >= TEXTURE_UNITS)
+    return;
+  std::unordered_map<GLuint, TextureSize>::iterator it = textureSizes.find(textures[activeTextureUnit]);
+  if(it != textureSizes.end() && !it->second.mipmaps)
+    setTextureBytes(it->first, { it->second.bytes, true });
+}
+
+void GLState::vertexAttribArrays(std::initializer_list<GLuint> locations) {
+  if(maxAttribs == 0) {
+    GLint max = 0;
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max);
+    maxAttribs = std::min(static_cast<GLuint>(std::max(max, 1)), MAX_ATTRIBS);
+  }
+
+  unsigned int requested = 0;
+  for(GLuint location : locations) {
+    if(location < maxAttribs)
+      requested |= 1u << location;
+  }
+  for(GLuint location = 0; location < maxAttribs; ++location) {
+    unsigned int bit = 1u << location;
+    bool enable = requested & bit;
+    bool changed = !attribsKnown || (enabledAttribs & bit) != (requested & bit);
+    if(!enable && !changed)
+      continue; // attribute not used by anyone
+    if(count(Stat::VertexAttrib, changed)) {
+      if(enable)
+        glEnableVertexAttribArray(location);
+      else
+        glDisableVertexAttribArray(location);
+    }
+  }
+  enabledAttribs = requested;
+  attribsKnown = true;
+}
+
+void GLState::blendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+  bool changed = !blendKnown || blend.srcRGB != srcRGB || blend.dstRGB != dstRGB || blend.srcAlpha != srcAlpha || blend.dstAlpha != dstAlpha;
+  if(count(Stat::Blend, changed))
+    glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+  blend = { srcRGB, dstRGB, srcAlpha, dstAlpha };
+  blendKnown = true;
+}
+
+GLState::BlendFunc GLState::getBlendFunc() {
+  if(!blendKnown) {
+    GLint func[4] = { GL_ONE, GL_ZERO, GL_ONE, GL_ZERO };
+    glGetIntegerv(GL_BLEND_SRC_RGB, &func[0]);
+    glGetIntegerv(GL_BLEND_DST_RGB, &func[1]);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &func[2]);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &func[3]);
+    blend = { static_cast<GLenum>(func[0]), static_cast<GLenum>(func[1]), static_cast<GLenum>(func[2]), static_cast<GLenum>(func[3]) };
+    blendKnown = true;
+  }
+  return blend;
+}
+
+void GLState::enable(GLenum capability) {
+  std::map<GLenum, bool>::iterator it = capabilities.find(capability);
+  if(count(Stat::Capability, it == capabilities.end() || !it->second))
+    glEnable(capability);
+  capabilities[capability] = true;
+}
+
+void GLState::disable(GLenum capability) {
+  std::map<GLenum, bool>::iterator it = capabilities.find(capability);
+  if(count(Stat::Capability, it == capabilities.end() || it->second))
+    glDisable(capability);
+  capabilities[capability] = false;
+}
+
+bool GLState::isEnabled(GLenum capability) {
+  std::map<GLenum, bool>::iterator it = capabilities.find(capability);
+  if(it == capabilities.end())
+    it = capabilities.insert({capability, glIsEnabled(capability) == GL_TRUE}).first;
+  return it->second;
+}
+
+bool GLState::uniformChanged(GLuint location, const GLfloat *values, int count) {
+  if(currentUniforms == nullptr)
+    return this->count(Stat::Uniform, true);
+  std::vector<GLfloat> &cached = (*currentUniforms)[static_cast<GLint>(location)];
+  bool changed = cached.size() != static_cast<size_t>(count) || std::memcmp(cached.data(), values, count * sizeof(GLfloat)) != 0;
+  if(changed)
+    cached.assign(values, values + count);
+  return this->count(Stat::Uniform, changed);
+}
+
+void GLState::uniform1i(GLuint location, GLint v0) {
+  GLfloat values[] = { static_cast<GLfloat>(v0) };
+  if(uniformChanged(location, values, 1))
+    glUniform1i(location, v0);
+}
+
+void GLState::uniform1f(GLuint location, GLfloat v0) {
+  GLfloat values[] = { v0 };
+  if(uniformChanged(location, values, 1))
+    glUniform1f(location, v0);
+}
+
+void GLState::uniform2f(GLuint location, GLfloat v0, GLfloat v1) {
+  GLfloat values[] = { v0, v1 };
+  if(uniformChanged(location, values, 2))
+    glUniform2f(location, v0, v1);
+}
+
+void GLState::uniform3f(GLuint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+  GLfloat values[] = { v0, v1, v2 };
+  if(uniformChanged(location, values, 3))
+    glUniform3f(location, v0, v1, v2);
+}
+
+void GLState::uniform4f(GLuint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+  GLfloat values[] = { v0, v1, v2, v3 };
+  if(uniformChanged(location, values, 4))
+    glUniform4f(location, v0, v1, v2, v3);
+}
+
+void GLState::uniform1fv(GLuint location, GLsizei count, const GLfloat *values) {
+  if(uniformChanged(location, values, count))
+    glUniform1fv(location, count, values);
+}
+
+int GLState::getStats(int *stats, int count) {
+  const int available = 2 * static_cast<int>(Stat::Count);
+  for(int i = 0; stats != nullptr && i < std::min(count, available); ++i)
+    stats[i] = static_cast<int>(i % 2 == 0 ? issued[i / 2] : suppressed[i / 2]);
+  return available;
+}
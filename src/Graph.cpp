@@ -1,55 +1,115 @@
 #include "Graph.h"
+#include "GLState.h"
 #include "ProgramBuilder.h"
 #include "Settings.h"
+#include "TextureManager.h"
 #include "Utility.h"
 
+#include <algorithm>
+
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/graph.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/graph.frag"
+;
+
+} // namespace
+
 Graph::Graph()
   : programObject(GL_INVALID_VALUE),
     posALoc(GL_INVALID_VALUE),
     posLoc(GL_INVALID_VALUE),
     sizLoc(GL_INVALID_VALUE),
     valLoc(GL_INVALID_VALUE),
+    histLoc(GL_INVALID_VALUE),
+    startLoc(GL_INVALID_VALUE),
     opaLoc(GL_INVALID_VALUE) {
-  initialize();
+  ProgramBuilder::prefetchProgram("graph", vShaderTexStr, fShaderTexStr);
 }
 
 Graph::~Graph() {
   assertCurrentEGLContext();
 
+  for(std::pair<const int, History> &history : histories)
+    TextureManager::instance().release(history.second.textureId);
   if(programObject != GL_INVALID_VALUE)
-    glDeleteProgram(programObject);
+    GLState::instance().deleteProgram(programObject);
 }
 
 void Graph::initialize() {
   assertCurrentEGLContext();
 
-  const GLchar* vShaderTexStr =  
-#include "shaders/graph.vert"
-;
-
-  const GLchar* fShaderTexStr =  
-#include "shaders/graph.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "graph");
 
   posALoc = glGetAttribLocation(programObject, "a_position");
   posLoc = glGetUniformLocation(programObject, "u_position");
   sizLoc = glGetUniformLocation(programObject, "u_size");
-  valLoc = glGetUniformLocation(programObject, "u_value");
+  valLoc = glGetUniformLocation(programObject, "s_values");
+  histLoc = glGetUniformLocation(programObject, "u_history");
+  startLoc = glGetUniformLocation(programObject, "u_start");
   opaLoc = glGetUniformLocation(programObject, "u_opacity");
 }
 
-void Graph::render(const std::vector<float> &values, const std::pair<float, float> &minMax, const Position<int> &position, const Size<int> &size) {
-  assertCurrentEGLContext();
+Graph::History& Graph::getHistory(int traceId, int capacity) {
+  std::map<int, History>::iterator it = histories.find(traceId);
+  if(it != histories.end() && it->second.capacity == capacity)
+    return it->second;
+  if(it != histories.end())
+    TextureManager::instance().release(it->second.textureId);
+
+  History history;
+  history.capacity = capacity;
+  history.textureSize = { std::min(capacity, MAX_ROW_LENGTH), (capacity + MAX_ROW_LENGTH - 1) / MAX_ROW_LENGTH };
+  history.uploaded = 0;
+  history.minMax = { 0.0f, 0.0f };
+  history.textureId = TextureManager::instance().create(TextureManager::Category::Graph, TextureManager::Filter::Nearest, // samples are interpolated in the shader
+                                                        GL_RGBA, history.textureSize, NULL);
+  return histories[traceId] = history;
+}
 
-  GLfloat vs[VALUES] = { 0.0f };
-  for(int i = 0; i < VALUES; ++i) {
-    float v = 0.0f;
-    if(i < static_cast<int>(values.size()))
-      v = clamp((values[i] - minMax.first) / (minMax.second - minMax.first), 0.0f, 1.0f);
-    vs[i] = static_cast<GLfloat>(v);
+void Graph::upload(History &history, const RingBuffer<float> &values, const std::pair<float, float> &minMax) {
+  uint64_t from = std::max(history.uploaded, values.getFirstIndex());
+  if(minMax != history.minMax) { // normalized samples depend on the range
+    from = values.getFirstIndex();
+    history.minMax = minMax;
+  }
+  history.uploaded = values.getPushed();
+  if(from >= values.getPushed())
+    return;
+
+  GLState::instance().bindTexture(0, history.textureId);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  std::vector<unsigned char> texels;
+  while(from < values.getPushed()) { // one glTexSubImage2D per contiguous run within a texture row
+    int slot = static_cast<int>(values.getSlot(from));
+    Position<int> texel = { slot % history.textureSize.width, slot / history.textureSize.width };
+    int run = static_cast<int>(std::min<uint64_t>(values.getPushed() - from, static_cast<uint64_t>(std::min(history.textureSize.width - texel.x, history.capacity - slot))));
+    texels.resize(run * 4);
+    for(int i = 0; i < run; ++i) {
+      float v = clamp((values.at(from + i) - minMax.first) / (minMax.second - minMax.first), 0.0f, 1.0f);
+      unsigned int q = static_cast<unsigned int>(v * 65535.0f + 0.5f);
+      texels[i * 4 + 0] = static_cast<unsigned char>(q >> 8);
+      texels[i * 4 + 1] = static_cast<unsigned char>(q & 0xFF);
+      texels[i * 4 + 2] = 0;
+      texels[i * 4 + 3] = 0;
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, texel.x, texel.y, run, 1, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    from += run;
   }
+}
+
+void Graph::render(int traceId, const RingBuffer<float> &values, const std::pair<float, float> &minMax, const Position<int> &position, const Size<int> &size) {
+  assertCurrentEGLContext();
+
+  if(programObject == GL_INVALID_VALUE)
+    initialize();
+
+  History &history = getHistory(traceId, static_cast<int>(values.capacity()));
+  upload(history, values, minMax);
 
   float down  = static_cast<float>(position.y) / static_cast<float>(Settings::instance().viewport.height) * 2.0f - 1.0f;
   float top   = (static_cast<float>(position.y) + static_cast<float>(size.height)) / static_cast<float>(Settings::instance().viewport.height) * 2.0f - 1.0f;
@@ -62,18 +122,18 @@ void Graph::render(const std::vector<float> &values, const std::pair<float, floa
   };
   GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
 
-  glUseProgram(programObject);
-  glEnableVertexAttribArray(posALoc);
+  GLState::instance().useProgram(programObject);
+  GLState::instance().vertexAttribArrays({posALoc});
   glVertexAttribPointer(posALoc, 3, GL_FLOAT, GL_FALSE, 0, vVertices);
 
-  glUniform2f(posLoc, static_cast<float>(position.x), static_cast<float>(position.y));
-  glUniform2f(sizLoc, static_cast<float>(size.width), static_cast<float>(size.height));
-  glUniform1fv(valLoc, VALUES, static_cast<GLfloat*>(vs));
-  glUniform1f(opaLoc, 1.0f);
+  GLState::instance().bindTexture(0, history.textureId);
+  GLState::instance().uniform1i(valLoc, 0);
+  GLState::instance().uniform2f(posLoc, static_cast<float>(position.x), static_cast<float>(position.y));
+  GLState::instance().uniform2f(sizLoc, static_cast<float>(size.width), static_cast<float>(size.height));
+  GLState::instance().uniform4f(histLoc, static_cast<float>(history.textureSize.width), static_cast<float>(history.textureSize.height),
+                                static_cast<float>(history.capacity), static_cast<float>(values.size()));
+  GLState::instance().uniform1f(startLoc, static_cast<float>(values.getSlot(values.getFirstIndex())));
+  GLState::instance().uniform1f(opaLoc, 1.0f);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(posALoc);
-  glUseProgram(0);
 }
-
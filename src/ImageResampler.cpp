@@ -0,0 +1,201 @@
+#include "ImageResampler.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#endif
+
+namespace {
+
+const int WEIGHT_BITS = 14;
+const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+const int ROUNDING = 1 << (WEIGHT_BITS - 1);
+const int PADDING = 8; // bytes after the intermediate image, SIMD loads may read past its last pixel with a zero weight
+
+// For every destination pixel, a window of taps source pixels starting at first[i], with fixed-point weights summing to WEIGHT_ONE.
+struct Filter {
+  int taps;
+  std::vector<int> first;
+  std::vector<int16_t> weights; // taps per destination pixel
+};
+
+double lanczos2(double x) {
+  x = std::fabs(x);
+  if(x < 1e-9)
+    return 1.0;
+  if(x >= 2.0)
+    return 0.0;
+  const double pi = 3.14159265358979323846;
+  return 2.0 * std::sin(pi * x) * std::sin(pi * x / 2.0) / (pi * pi * x * x);
+}
+
+Filter createFilter(int srcLength, int dstLength) {
+  double scale = static_cast<double>(srcLength) / dstLength;
+  double support = 2.0 * std::max(scale, 1.0);
+  Filter filter;
+  filter.taps = std::min(srcLength, static_cast<int>(std::ceil(support * 2.0)) + 1);
+  filter.first.resize(dstLength);
+  filter.weights.resize(static_cast<size_t>(dstLength) * filter.taps);
+
+  std::vector<double> weights(filter.taps);
+  for(int i = 0; i < dstLength; ++i) {
+    double center = (i + 0.5) * scale - 0.5;
+    int first = std::min(std::max(static_cast<int>(std::floor(center - support)) + 1, 0), srcLength - filter.taps); // window is kept inside the image, weights are renormalized at edges
+    double sum = 0.0;
+    for(int t = 0; t < filter.taps; ++t) {
+      weights[t] = lanczos2((first + t - center) / std::max(scale, 1.0));
+      sum += weights[t];
+    }
+
+    int16_t *fixed = &filter.weights[static_cast<size_t>(i) * filter.taps];
+    int fixedSum = 0;
+    int largest = 0;
+    for(int t = 0; t < filter.taps; ++t) {
+      fixed[t] = static_cast<int16_t>(std::lround(weights[t] / sum * WEIGHT_ONE));
+      fixedSum += fixed[t];
+      if(fixed[t] > fixed[largest])
+        largest = t;
+    }
+    fixed[largest] = static_cast<int16_t>(fixed[largest] + WEIGHT_ONE - fixedSum); // rounding error goes to the center, flat areas stay exact
+    filter.first[i] = first;
+  }
+  return filter;
+}
+
+uint8_t clampToByte(int value) {
+  return static_cast<uint8_t>(std::min(std::max((value + ROUNDING) >> WEIGHT_BITS, 0), 255));
+}
+
+// Destination row from filter.taps source rows, every byte of a row on its own
+void filterRows(const uint8_t * const *rows, const int16_t *weights, int taps, uint8_t *dst, int length) {
+  int x = 0;
+#if defined(RESAMPLER_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i rounding = _mm_set1_epi32(ROUNDING);
+  for(; x + 8 <= length; x += 8) {
+    __m128i sumLow = _mm_setzero_si128();
+    __m128i sumHigh = _mm_setzero_si128();
+    for(int t = 0; t < taps; t += 2) { // rows in pairs, interleaved for _mm_madd_epi16
+      bool pair = t + 1 < taps;
+      __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[t] + x)), zero);
+      __m128i b = pair ? _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[t + 1] + x)), zero) : zero;
+      __m128i weight = _mm_set1_epi32((static_cast<uint16_t>(pair ? weights[t + 1] : 0) << 16) | static_cast<uint16_t>(weights[t]));
+      sumLow = _mm_add_epi32(sumLow, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weight));
+      sumHigh = _mm_add_epi32(sumHigh, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weight));
+    }
+    sumLow = _mm_srai_epi32(_mm_add_epi32(sumLow, rounding), WEIGHT_BITS);
+    sumHigh = _mm_srai_epi32(_mm_add_epi32(sumHigh, rounding), WEIGHT_BITS);
+    __m128i packed = _mm_packs_epi32(sumLow, sumHigh);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(packed, packed));
+  }
+#elif defined(RESAMPLER_NEON)
+  for(; x + 8 <= length; x += 8) {
+    int32x4_t sumLow = vdupq_n_s32(0);
+    int32x4_t sumHigh = vdupq_n_s32(0);
+    for(int t = 0; t < taps; ++t) {
+      int16x8_t values = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[t] + x)));
+      sumLow = vmlal_n_s16(sumLow, vget_low_s16(values), weights[t]);
+      sumHigh = vmlal_n_s16(sumHigh, vget_high_s16(values), weights[t]);
+    }
+    int16x8_t packed = vcombine_s16(vqrshrn_n_s32(sumLow, WEIGHT_BITS), vqrshrn_n_s32(sumHigh, WEIGHT_BITS));
+    vst1_u8(dst + x, vqmovun_s16(packed));
+  }
+#endif
+  for(; x < length; ++x) {
+    int sum = 0;
+    for(int t = 0; t < taps; ++t)
+      sum += rows[t][x] * weights[t];
+    dst[x] = clampToByte(sum);
+  }
+}
+
+// Destination row from a source row, pixels of bpp bytes; src has to be followed by PADDING readable bytes
+void filterColumns(const uint8_t *src, const Filter &filter, uint8_t *dst, int dstWidth, int bpp) {
+  int taps = filter.taps;
+#if defined(RESAMPLER_SSE2)
+  if(bpp == 4) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(ROUNDING);
+    for(int x = 0; x < dstWidth; ++x) {
+      const uint8_t *pixels = src + filter.first[x] * 4;
+      const int16_t *weights = &filter.weights[static_cast<size_t>(x) * taps];
+      __m128i sum = _mm_setzero_si128();
+      for(int t = 0; t < taps; t += 2) { // 2 pixels, channels interleaved for _mm_madd_epi16
+        __m128i both = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + t * 4)), zero);
+        __m128i weight = _mm_set1_epi32((static_cast<uint16_t>(t + 1 < taps ? weights[t + 1] : 0) << 16) | static_cast<uint16_t>(weights[t]));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(both, _mm_srli_si128(both, 8)), weight));
+      }
+      sum = _mm_srai_epi32(_mm_add_epi32(sum, rounding), WEIGHT_BITS);
+      __m128i packed = _mm_packs_epi32(sum, sum);
+      int32_t pixel = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+      std::memcpy(dst + x * 4, &pixel, sizeof(pixel));
+    }
+    return;
+  }
+#elif defined(RESAMPLER_NEON)
+  if(bpp == 4) {
+    for(int x = 0; x < dstWidth; ++x) {
+      const uint8_t *pixels = src + filter.first[x] * 4;
+      const int16_t *weights = &filter.weights[static_cast<size_t>(x) * taps];
+      int32x4_t sum = vdupq_n_s32(0);
+      for(int t = 0; t < taps; ++t)
+        sum = vmlal_n_s16(sum, vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pixels + t * 4)))), weights[t]);
+      int16x4_t packed = vqrshrn_n_s32(sum, WEIGHT_BITS);
+      uint8x8_t bytes = vqmovun_s16(vcombine_s16(packed, packed));
+      vst1_lane_u32(reinterpret_cast<uint32_t*>(dst + x * 4), vreinterpret_u32_u8(bytes), 0);
+    }
+    return;
+  }
+#endif
+  for(int x = 0; x < dstWidth; ++x) {
+    const uint8_t *pixels = src + filter.first[x] * bpp;
+    const int16_t *weights = &filter.weights[static_cast<size_t>(x) * taps];
+    for(int c = 0; c < bpp; ++c) {
+      int sum = 0;
+      for(int t = 0; t < taps; ++t)
+        sum += pixels[t * bpp + c] * weights[t];
+      dst[x * bpp + c] = clampToByte(sum);
+    }
+  }
+}
+
+} // namespace
+
+Size<int> ImageResampler::getIngestSize(Size<int> size, Size<int> maxSize) {
+  return Size<int>(std::min(size.width, std::max(maxSize.width, 1)), std::min(size.height, std::max(maxSize.height, 1)));
+}
+
+std::vector<char> ImageResampler::resize(const char *pixels, Size<int> size, GLenum format, Size<int> targetSize) {
+  if(pixels == nullptr || size.width <= 0 || size.height <= 0)
+    return std::vector<char>();
+  int bpp = static_cast<int>(GLState::getBytesPerPixel(format));
+  size_t srcStride = static_cast<size_t>(size.width) * bpp;
+  targetSize = getIngestSize(size, targetSize);
+
+  // rows first, so columns are filtered in fewer of them
+  const uint8_t *src = reinterpret_cast<const uint8_t*>(pixels);
+  std::vector<uint8_t> rowsFiltered(srcStride * targetSize.height + PADDING);
+  Filter vertical = createFilter(size.height, targetSize.height);
+  std::vector<const uint8_t*> rows(vertical.taps);
+  for(int y = 0; y < targetSize.height; ++y) {
+    for(int t = 0; t < vertical.taps; ++t)
+      rows[t] = src + (vertical.first[y] + t) * srcStride;
+    filterRows(rows.data(), &vertical.weights[static_cast<size_t>(y) * vertical.taps], vertical.taps, &rowsFiltered[y * srcStride], static_cast<int>(srcStride));
+  }
+
+  size_t dstStride = static_cast<size_t>(targetSize.width) * bpp;
+  std::vector<char> result(dstStride * targetSize.height);
+  Filter horizontal = createFilter(size.width, targetSize.width);
+  for(int y = 0; y < targetSize.height; ++y)
+    filterColumns(&rowsFiltered[y * srcStride], horizontal, reinterpret_cast<uint8_t*>(&result[y * dstStride]), targetSize.width, bpp);
+  return result;
+}
@@ -0,0 +1,150 @@
+#include "Layer.h"
+#include "GLState.h"
+#include "ProgramBuilder.h"
+#include "Settings.h"
+#include "LogConsole.h"
+#include "TextureManager.h"
+#include "TextRenderer.h"
+
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/layer.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/layer.frag"
+;
+
+} // namespace
+
+Layer::Layer()
+  : framebuffer(0),
+    textureId(0),
+    size({0, 0}),
+    valid(false) {
+  ProgramBuilder::prefetchProgram("layer", vShaderTexStr, fShaderTexStr);
+}
+
+Layer::~Layer() {
+  assertCurrentEGLContext();
+
+  release();
+  if(programObject != GL_INVALID_VALUE)
+    GLState::instance().deleteProgram(programObject);
+}
+
+void Layer::initialize() {
+  assertCurrentEGLContext();
+
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "layer");
+
+  posLoc = glGetAttribLocation(programObject, "a_position");
+  texLoc = glGetAttribLocation(programObject, "a_texCoord");
+  samplerLoc = glGetUniformLocation(programObject, "s_texture");
+  opacityLoc = glGetUniformLocation(programObject, "u_opacity");
+}
+
+bool Layer::createTarget() {
+  Size<int> viewport = Settings::instance().viewport;
+  if(framebuffer && size.width == viewport.width && size.height == viewport.height)
+    return true;
+  release();
+
+  // layer covers whole viewport, so shaders relying on gl_FragCoord render the same way as on screen
+  size = viewport;
+  textureId = TextureManager::instance().create(TextureManager::Category::Layer, TextureManager::Filter::Nearest, GL_RGBA, size, NULL);
+
+  GLint previousFramebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId, 0);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+  if(status != GL_FRAMEBUFFER_COMPLETE) {
+    LogConsole::instance().log("Layer framebuffer is incomplete: " + std::to_string(status), LogConsole::LogLevel::Error);
+    release();
+    return false;
+  }
+  return true;
+}
+
+void Layer::release() {
+  assertCurrentEGLContext();
+
+  if(framebuffer)
+    glDeleteFramebuffers(1, &framebuffer);
+  if(textureId)
+    TextureManager::instance().release(textureId);
+  framebuffer = 0;
+  textureId = 0;
+  size = {0, 0};
+  valid = false;
+}
+
+void Layer::update(std::function<void()> renderContent) {
+  assertCurrentEGLContext();
+
+  if(valid && size.width == Settings::instance().viewport.width && size.height == Settings::instance().viewport.height)
+    return;
+  if(!createTarget())
+    return;
+
+  GLint previousFramebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  GLState::BlendFunc blendFunc = GLState::instance().getBlendFunc();
+  bool scissorTest = GLState::instance().isEnabled(GL_SCISSOR_TEST); // layer is always rendered as a whole
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  GLState::instance().disable(GL_SCISSOR_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  // color ends up premultiplied by alpha; alpha is accumulated with "over" operator, so layer composites like its content would
+  GLState::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  unsigned int skippedTexts = TextRenderer::instance().getSkippedRenders();
+  renderContent();
+
+  GLState::instance().blendFunc(blendFunc);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+  if(scissorTest)
+    GLState::instance().enable(GL_SCISSOR_TEST);
+  valid = TextRenderer::instance().getSkippedRenders() == skippedTexts; // rendered again once deferred text is ready
+}
+
+void Layer::composite(float opacity) {
+  assertCurrentEGLContext();
+
+  if(!valid || opacity < 0.001f)
+    return;
+  if(programObject == GL_INVALID_VALUE)
+    initialize();
+
+  GLfloat vertices[] = { -1.0f,  1.0f, 0.0f,
+                         -1.0f, -1.0f, 0.0f,
+                          1.0f, -1.0f, 0.0f,
+                          1.0f,  1.0f, 0.0f
+  };
+  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
+  float texCoord[] = { 0.0f, 1.0f,    0.0f, 0.0f,
+                       1.0f, 0.0f,    1.0f, 1.0f };
+
+  GLState::BlendFunc blendFunc = GLState::instance().getBlendFunc();
+  GLState::instance().blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+
+  GLState::instance().useProgram(programObject);
+  GLState::instance().uniform1f(opacityLoc, opacity);
+
+  GLState::instance().bindTexture(0, textureId);
+  GLState::instance().uniform1i(samplerLoc, 0);
+
+  GLState::instance().vertexAttribArrays({posLoc, texLoc});
+  glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
+  glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
+
+  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+
+  GLState::instance().blendFunc(blendFunc);
+}
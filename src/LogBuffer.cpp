@@ -0,0 +1,53 @@
+#include "LogBuffer.h"
+
+#include <cstring>
+#include <algorithm>
+
+LogBuffer::LogBuffer()
+  : slots(new Slot[CAPACITY]),
+    pushed(0) {
+  for(size_t i = 0; i < CAPACITY; ++i) {
+    slots[i].sequence.store(0, std::memory_order_relaxed);
+    slots[i].length = 0;
+  }
+}
+
+void LogBuffer::push(const char *text, size_t length) {
+  uint64_t index = pushed.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = slots[index % CAPACITY];
+
+  uint64_t current = slot.sequence.load(std::memory_order_relaxed);
+  if((current & 1) != 0 || current >= 2 * index + 2 ||
+     !slot.sequence.compare_exchange_strong(current, 2 * index + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    return; // slot is being written by a writer which lapped the ring, this line is lost
+
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if(length > MAX_LINE_BYTES) {
+    length = MAX_LINE_BYTES;
+    while(length > 0 && (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80) // don't cut UTF-8 sequence in half
+      --length;
+  }
+  std::memcpy(slot.text, text, length);
+  slot.length = length;
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+LogBuffer::Read LogBuffer::read(uint64_t index, std::string &line) {
+  Slot &slot = slots[index % CAPACITY];
+  uint64_t before = slot.sequence.load(std::memory_order_acquire);
+  if(before < 2 * index + 2)
+    return Read::Pending;
+  if(before != 2 * index + 2)
+    return Read::Overwritten;
+  line.assign(slot.text, std::min(slot.length, MAX_LINE_BYTES));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(slot.sequence.load(std::memory_order_relaxed) != before)
+    return Read::Overwritten;
+  return Read::Ok;
+}
+
+uint64_t LogBuffer::getFirstIndex() {
+  uint64_t count = getPushed();
+  return count > CAPACITY ? count - CAPACITY : 0;
+}
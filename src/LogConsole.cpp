@@ -1,83 +1,211 @@
 #include "LogConsole.h"
-#include "ProgramBuilder.h"
+#include "RectRenderer.h"
 #include "Settings.h"
 #include "TextRenderer.h"
-#include "log.h"
+#include "LogSink.h"
 #include "Utility.h"
+#include "GLState.h"
+#include "TextureManager.h"
+
+#include <vector>
+#include <algorithm>
 
 LogConsole::LogConsole()
-    : programObject(GL_INVALID_VALUE),
-    posALoc(GL_INVALID_VALUE),
-    posLoc(GL_INVALID_VALUE),
-    sizLoc(GL_INVALID_VALUE),
-    colLoc(GL_INVALID_VALUE),
-    opaLoc(GL_INVALID_VALUE) {
-  initialize();
+    : renderedLogs(0),
+      unfinishedLog(UINT64_MAX),
+      framebuffer(0),
+      textureId(0),
+      textureSize({0, 0}),
+      textureFontId(-1),
+      textureFontSize(0),
+      writeRow(0),
+      contentHeight(0),
+      margin({4, 10}) {
 }
 
 LogConsole::~LogConsole() {
-  assertCurrentEGLContext();
-
-  if(programObject != GL_INVALID_VALUE)
-    glDeleteProgram(programObject);
 }
 
-void LogConsole::initialize() {
+void LogConsole::render(Position<int> position, Size<int> size, int fontId, int fontSize) {
   assertCurrentEGLContext();
 
-  const GLchar* vShaderTexStr =  
-#include "shaders/logConsole.vert"
-;
-
-  const GLchar* fShaderTexStr =  
-#include "shaders/logConsole.frag"
-;
+  updateTexture({size.width - margin.width, size.height}, fontId, fontSize);
+
+  RectRenderer::instance().add(position, size, {0.0f, 0.0f, 0.0f, 0.75f}, 1.0f, {1.0f, 1.0f, 1.0f, 0.75f});
+  if(textureId != 0 && contentHeight > 0) {
+    // visible lines end at writeRow, so they may continue from the top of the texture;
+    // the top margin is included, glyphs may reach above their line
+    int height = contentHeight + margin.height;
+    int top = (writeRow - height + textureSize.height) % textureSize.height;
+    int firstPart = std::min(height, textureSize.height - top);
+    Position<int> textPosition = {position.x + margin.width, position.y + size.height};
+    addRows(textPosition, top, firstPart);
+    if(firstPart < height)
+      addRows({textPosition.x, textPosition.y - firstPart}, 0, height - firstPart);
+  }
+  RectRenderer::instance().flush();
+}
 
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
+void LogConsole::addRows(Position<int> position, int row, int height) {
+  float textureHeight = static_cast<float>(textureSize.height);
+  Position<int> bottomLeft = {position.x, position.y - height};
+  Size<int> size = {textureSize.width, height};
+  // texture rows are counted from the top, texture coordinates from the bottom
+  RectRenderer::instance().add(bottomLeft, size, {1.0f, 1.0f, 1.0f, 1.0f}, 0.0f, {0.0f, 0.0f, 0.0f, 0.0f}, 0.0f, textureId,
+                               {0.0f, (textureHeight - row) / textureHeight, 1.0f, (textureHeight - row - height) / textureHeight});
+}
 
-  posALoc = glGetAttribLocation(programObject, "a_position");
-  posLoc = glGetUniformLocation(programObject, "u_position");
-  sizLoc = glGetUniformLocation(programObject, "u_size");
-  colLoc = glGetUniformLocation(programObject, "u_color");
-  opaLoc = glGetUniformLocation(programObject, "u_opacity");
+bool LogConsole::createTexture(Size<int> size) {
+  if(textureId != 0 && textureSize == size)
+    return true;
+  release();
+
+  textureSize = size;
+  textureId = TextureManager::instance().create(TextureManager::Category::Console, TextureManager::Filter::Nearest, GL_RGBA, size, NULL);
+
+  GLint previousFramebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId, 0);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+  if(status != GL_FRAMEBUFFER_COMPLETE) {
+    release();
+    log("Log console framebuffer is incomplete: " + std::to_string(status), LogLevel::Error);
+    return false;
+  }
+  return true;
 }
 
-void LogConsole::render(Position<int> position, Size<int> size, int fontId, int fontSize) {
+void LogConsole::release() {
   assertCurrentEGLContext();
 
-  float down  = static_cast<float>(position.y) / static_cast<float>(Settings::instance().viewport.height) * 2.0f - 1.0f;
-  float top   = (static_cast<float>(position.y) + static_cast<float>(size.height)) / static_cast<float>(Settings::instance().viewport.height) * 2.0f - 1.0f;
-  float left  = static_cast<float>(position.x) / static_cast<float>(Settings::instance().viewport.width) * 2.0f - 1.0f;
-  float right = (static_cast<float>(position.x) + static_cast<float>(size.width)) / static_cast<float>(Settings::instance().viewport.width) * 2.0f - 1.0f;
-
-  GLfloat vVertices[] = { left,   top,  0.0f,
-                          left,   down, 0.0f,
-                          right,  down, 0.0f,
-                          right,  top,  0.0f
-  };
-  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
-  glUseProgram(programObject);
-  glEnableVertexAttribArray(posALoc);
-  glVertexAttribPointer(posALoc, 3, GL_FLOAT, GL_FALSE, 0, vVertices);
+  if(framebuffer)
+    glDeleteFramebuffers(1, &framebuffer);
+  if(textureId)
+    TextureManager::instance().release(textureId);
+  framebuffer = 0;
+  textureId = 0;
+  textureSize = {0, 0};
+}
 
-  glUniform2f(posLoc, static_cast<float>(position.x), static_cast<float>(position.y));
-  glUniform2f(sizLoc, static_cast<float>(size.width), static_cast<float>(size.height));
-  glUniform3f(colLoc, 1.0f, 1.0f, 1.0f);
-  glUniform1f(opaLoc, 1.0f);
+void LogConsole::clearRows(int row, int height) {
+  int firstPart = std::min(height, textureSize.height - row);
+  glScissor(0, textureSize.height - row - firstPart, textureSize.width, firstPart);
+  glClear(GL_COLOR_BUFFER_BIT);
+  if(firstPart < height) { // rows continue from the top
+    glScissor(0, textureSize.height - (height - firstPart), textureSize.width, height - firstPart);
+    glClear(GL_COLOR_BUFFER_BIT);
+  }
+}
 
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+void LogConsole::updateTexture(Size<int> size, int fontId, int fontSize) {
+  if(size.width < 1 || size.height < 1)
+    return;
+
+  bool rebuild = textureId == 0 || !(textureSize == size) || textureFontId != fontId || textureFontSize != fontSize;
+  if(rebuild) {
+    if(!createTexture(size))
+      return;
+    textureFontId = fontId;
+    textureFontSize = fontSize;
+    writeRow = margin.height;
+    contentHeight = 0;
+    lineHeights.clear();
+    renderedLogs = 0; // lines still kept in the buffer are added again
+  }
+  uint64_t pushed = logs.getPushed();
+  if(!rebuild && pushed == renderedLogs)
+    return;
+
+  std::vector<std::string> arrived;
+  std::string line;
+  uint64_t index = std::max(renderedLogs, logs.getFirstIndex());
+  for(; index < pushed; ++index) {
+    LogBuffer::Read read = logs.read(index, line);
+    if(read == LogBuffer::Read::Pending && index != unfinishedLog) {
+      unfinishedLog = index; // wait for it one frame, its writer may have given up on it
+      break;
+    }
+    if(read == LogBuffer::Read::Ok)
+      arrived.push_back(line);
+  }
+  renderedLogs = index;
+
+  // newest lines which fit; older ones would be scrolled out right away, so they are never rasterized
+  int lineWidth = size.width - margin.width;
+  int capacity = size.height - margin.height;
+  std::vector<std::pair<std::string, int>> added; // text and height including margin, newest first
+  int addedHeight = 0;
+  for(std::vector<std::string>::reverse_iterator it = arrived.rbegin(); it != arrived.rend(); ++it) {
+    int height = getTextHeight(*it, lineWidth, fontSize, fontId) + margin.height;
+    if(addedHeight + height > capacity)
+      break;
+    addedHeight += height;
+    added.push_back({*it, height});
+  }
+  if(added.empty() && !rebuild)
+    return;
 
-  glDisableVertexAttribArray(posALoc);
-  glUseProgram(0);
+  while(!lineHeights.empty() && contentHeight + addedHeight > capacity) { // scroll, rows of oldest lines are reused
+    contentHeight -= lineHeights.front();
+    lineHeights.pop_front();
+  }
 
-  renderText(position, size, fontId, fontSize);
-}
+  GLint previousFramebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  GLint scissorBox[4] = {0, 0, 0, 0};
+  glGetIntegerv(GL_SCISSOR_BOX, scissorBox);
+  bool scissorTest = GLState::instance().isEnabled(GL_SCISSOR_TEST);
+  bool blend = GLState::instance().isEnabled(GL_BLEND);
+  Size<int> viewport = Settings::instance().viewport;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  // text renderer maps pixels through the viewport setting, it has to describe the texture while rendering into it
+  Settings::instance().viewport = textureSize;
+  glViewport(0, 0, textureSize.width, textureSize.height);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  GLState::instance().enable(GL_SCISSOR_TEST);
+  if(rebuild)
+    clearRows(0, textureSize.height);
+
+  for(std::vector<std::pair<std::string, int>>::reverse_iterator it = added.rbegin(); it != added.rend(); ++it) {
+    clearRows(writeRow, it->second);
+    GLState::instance().disable(GL_SCISSOR_TEST);
+    GLState::instance().disable(GL_BLEND); // texture keeps text color and alpha, so it blends onto the screen like directly rendered text
+    TextRenderer::instance().render(it->first,
+                {0, textureSize.height - writeRow - fontSize},
+                {lineWidth, fontSize},
+                fontId,
+                {1.0f, 1.0f, 1.0f, 1.0f});
+    if(writeRow + it->second > textureSize.height) // the rest of the line continues from the top
+      TextRenderer::instance().render(it->first,
+                  {0, 2 * textureSize.height - writeRow - fontSize},
+                  {lineWidth, fontSize},
+                  fontId,
+                  {1.0f, 1.0f, 1.0f, 1.0f});
+    if(writeRow < margin.height) // glyphs reaching above the line continue from the bottom
+      TextRenderer::instance().render(it->first,
+                  {0, -writeRow - fontSize},
+                  {lineWidth, fontSize},
+                  fontId,
+                  {1.0f, 1.0f, 1.0f, 1.0f});
+    GLState::instance().enable(GL_SCISSOR_TEST);
+    writeRow = (writeRow + it->second) % textureSize.height;
+    contentHeight += it->second;
+    lineHeights.push_back(it->second);
+  }
 
-void LogConsole::renderText(Position<int> position, Size<int> size, int fontId, int fontSize) {
-  Size<int> margin = {4, 10};
-  int lineWidth = size.width - 2 * margin.width;
-  renderLogs(position, size, fontId, fontSize, margin, lineWidth);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+  Settings::instance().viewport = viewport;
+  glViewport(0, 0, viewport.width, viewport.height);
+  glScissor(scissorBox[0], scissorBox[1], scissorBox[2], scissorBox[3]);
+  if(!scissorTest)
+    GLState::instance().disable(GL_SCISSOR_TEST);
+  if(blend)
+    GLState::instance().enable(GL_BLEND);
 }
 
 int LogConsole::getTextHeight(std::string s, int lineWidth, int fontHeight, int fontId) {
@@ -86,39 +214,15 @@ int LogConsole::getTextHeight(std::string s, int lineWidth, int fontHeight, int
                           fontId).height);
 }
 
-void LogConsole::renderLogs(Position<int> position, Size<int> size, int fontId, int fontSize, Size<int> margin, int lineWidth) {
-  int i = 0;
-  std::deque<std::string>::iterator deqit = logs.begin();
-  for(int offset = margin.height; deqit != logs.end(); ++deqit, ++i) {
-    int textHeight = getTextHeight(*deqit, lineWidth, fontSize, fontId);
-    if(offset + textHeight + margin.height > size.height)
-      break;
-    TextRenderer::instance().render(*deqit,
-                {position.x + margin.width, position.y + size.height - offset - fontSize},
-                {lineWidth, fontSize},
-                fontId,
-                {1.0f, 1.0f, 1.0f, 1.0f});
-    offset += textHeight + margin.height;
-  }
-  logs.erase(logs.begin(), logs.end() - i);
+bool LogConsole::hasPendingLogs() {
+  return logs.getPushed() != renderedLogs;
 }
 
-void LogConsole::log(std::string log, LogLevel logLevel) {
-  switch(logLevel) {
-    case LogLevel::Error:
-      _ERR("%s", log.c_str());
-      break;
-    case LogLevel::Debug:
-      _DBG("%s", log.c_str());
-      break;
-    case LogLevel::Info:
-      _INFO("%s", log.c_str());
-      break;
-  }
-  pushLog(log);
+void LogConsole::log(std::string log, LogLevel logLevel, const char *file, int line) {
+  LogSink::instance().log(log, logLevel, file, line);
 }
 
-void LogConsole::pushLog(std::string log) {
-  logs.push_back(log);
+void LogConsole::pushLog(const std::string &log) {
+  logs.push(log.data(), log.size());
 }
 
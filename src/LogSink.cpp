@@ -0,0 +1,162 @@
+#include "LogSink.h"
+#include "log.h"
+
+#include <algorithm>
+
+namespace {
+
+const char CONTINUATION[] = "... "; // starts lines continuing a message longer than a LogBuffer slot
+
+} // namespace
+
+LogSink::LogSink()
+  : written(0),
+    checked(0),
+    unfinishedLine(UINT64_MAX),
+    stopRequested(false) {
+  thread = std::thread(&LogSink::run, this);
+}
+
+LogSink::~LogSink() {
+  {
+    std::lock_guard<std::mutex> lock(threadMutex);
+    stopRequested = true;
+  }
+  wakeUp.notify_one();
+  if(thread.joinable())
+    thread.join();
+}
+
+void LogSink::log(const std::string &message, LogConsole::LogLevel level, const char *file, int line) {
+  std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+  std::vector<Message> messages;
+  {
+    std::lock_guard<std::mutex> lock(sitesMutex);
+    std::map<Site, SiteState>::iterator it = sites.find({file, line});
+    if(it == sites.end())
+      it = sites.insert({{file, line}, SiteState { "", level, 0, 0, BURST, now, now }}).first;
+    SiteState &site = it->second;
+
+    if(message == site.lastMessage) {
+      ++site.repeated;
+      if(now - site.lastReport >= std::chrono::milliseconds(REPEAT_REPORT_MS)) {
+        messages.push_back({site.level, repeatedMessage(site.repeated)});
+        site.repeated = 0;
+        site.lastReport = now;
+      }
+    }
+    else {
+      if(site.repeated > 0)
+        messages.push_back({site.level, repeatedMessage(site.repeated)});
+      site.repeated = 0;
+
+      std::chrono::duration<float> elapsed = now - site.lastRefill;
+      site.tokens = std::min(site.tokens + elapsed.count() * RATE, static_cast<float>(BURST));
+      site.lastRefill = now;
+      if(site.tokens < 1.0f) {
+        ++site.suppressed;
+      }
+      else {
+        site.tokens -= 1.0f;
+        std::string text = message;
+        if(site.suppressed > 0)
+          text += " (" + std::to_string(site.suppressed) + " messages suppressed before)";
+        messages.push_back({level, text});
+        site.suppressed = 0;
+        site.lastMessage = message;
+        site.level = level;
+        site.lastReport = now;
+      }
+    }
+  }
+  emit(messages);
+}
+
+std::string LogSink::repeatedMessage(int repeated) {
+  return "last message repeated " + std::to_string(repeated) + (repeated == 1 ? " time" : " times");
+}
+
+void LogSink::emit(const std::vector<Message> &messages) {
+  if(messages.empty())
+    return;
+  for(const Message &message : messages) {
+    LogConsole::instance().pushLog(message.text);
+    // shader info logs and the like don't fit a slot, they are split instead of being cut short
+    const std::string &text = message.text;
+    size_t offset = 0;
+    do {
+      std::string line(1, static_cast<char>('0' + static_cast<int>(message.level)));
+      if(offset > 0)
+        line += CONTINUATION;
+      size_t length = std::min(text.size() - offset, LogBuffer::MAX_LINE_BYTES - line.size());
+      while(offset + length < text.size() && (static_cast<unsigned char>(text[offset + length]) & 0xC0) == 0x80) // don't cut UTF-8 sequence in half
+        --length;
+      line.append(text, offset, length);
+      queue.push(line.data(), line.size());
+      offset += length;
+    } while(offset < text.size());
+  }
+  wakeUp.notify_one();
+}
+
+void LogSink::flushRepeats(std::vector<Message> &messages, std::chrono::time_point<std::chrono::steady_clock> now, bool all) {
+  std::lock_guard<std::mutex> lock(sitesMutex);
+  for(std::pair<const Site, SiteState> &site : sites) {
+    if(site.second.repeated > 0 && (all || now - site.second.lastReport >= std::chrono::milliseconds(REPEAT_REPORT_MS))) {
+      messages.push_back({site.second.level, repeatedMessage(site.second.repeated)});
+      site.second.repeated = 0;
+      site.second.lastReport = now;
+    }
+  }
+}
+
+void LogSink::run() {
+  std::unique_lock<std::mutex> lock(threadMutex);
+  while(!stopRequested) {
+    lock.unlock();
+    std::vector<Message> messages;
+    flushRepeats(messages, std::chrono::steady_clock::now(), false);
+    emit(messages);
+    writeQueued();
+    lock.lock();
+    wakeUp.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] { return stopRequested || queue.getPushed() != checked; });
+  }
+  lock.unlock();
+  std::vector<Message> messages;
+  flushRepeats(messages, std::chrono::steady_clock::now(), true);
+  emit(messages);
+  writeQueued();
+}
+
+void LogSink::writeQueued() {
+  uint64_t pushed = queue.getPushed();
+  uint64_t first = queue.getFirstIndex();
+  checked = pushed;
+  if(written < first) {
+    _ERR("%llu log lines dropped", static_cast<unsigned long long>(first - written));
+    written = first;
+  }
+
+  std::string line;
+  for(; written < pushed; ++written) {
+    LogBuffer::Read read = queue.read(written, line);
+    if(read == LogBuffer::Read::Pending && written != unfinishedLine) {
+      unfinishedLine = written; // try once more on next wake up, its writer may have given up on it
+      return;
+    }
+    if(read != LogBuffer::Read::Ok || line.empty())
+      continue;
+    const char *text = line.c_str() + 1;
+    switch(static_cast<LogConsole::LogLevel>(line[0] - '0')) {
+      case LogConsole::LogLevel::Error:
+        _ERR("%s", text);
+        break;
+      case LogConsole::LogLevel::Debug:
+        _DBG("%s", text);
+        break;
+      case LogConsole::LogLevel::Info:
+        _INFO("%s", text);
+        break;
+    }
+  }
+}
@@ -1,8 +1,20 @@
 #include "GLES.h"
 #include "Menu.h"
+#include "GLState.h"
+#include "LogConsole.h"
+#include "PixelConverter.h"
 #include "Settings.h"
+#include "ProgramBuilder.h"
+#include "StartupReport.h"
+#include "StoryboardCache.h"
 #include "TextRenderer.h"
+#include "TextureCache.h"
+#include "TextureManager.h"
 #include "Utility.h"
+#include "WorkScheduler.h"
+
+#include <algorithm>
+#include <memory>
 
 Menu::Menu()
   : loader(),
@@ -10,33 +22,66 @@ Menu::Menu()
     playback(),
     subtitles(),
     metrics(),
-    options() {
+    options(),
+    backgroundImageBytes(0) {
   initialize();
 }
 
 void Menu::initialize() {
   glViewport(0, 0, Settings::instance().viewport.width, Settings::instance().viewport.height);
 
-  glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
-  glEnable(GL_BLEND);
+  GLState::instance().invalidate(); // context may be new, nothing set before can be trusted
+  PixelConverter::instance().probe();
+  GLState::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+  GLState::instance().enable(GL_BLEND);
 
   glDisable(GL_DEPTH_TEST);
-  glDisable(GL_SCISSOR_TEST);
+  GLState::instance().disable(GL_SCISSOR_TEST);
   glDisable(GL_STENCIL_TEST);
 
-  glActiveTexture(GL_TEXTURE0);
-
   loaderEnabled = true;
   selectedTile = -1;
   firstTile = 0;
+  partialRedraw = false;
+  firstFrameRendered = false;
+  programsReady = false;
+  requestRedraw();
 }
 
 Menu::~Menu() {
+  ProgramBuilder::deletePrefetched(); // programs compiled ahead but never used
+  StoryboardCache::instance().clear();
+  WorkScheduler::instance().clear(); // tasks capture this menu
+  TextureCache::instance().stop();
 }
 
 void Menu::render() {
   assertCurrentEGLContext();
 
+  std::chrono::time_point<std::chrono::steady_clock> frameStart = std::chrono::steady_clock::now();
+  WorkScheduler::instance().beginFrame();
+  collectUploads();
+  if(TextureManager::instance().collectMipmaps() > 0)
+    requestRedraw();
+  collectDamage(damage);
+  if(!partialRedraw)
+    damage.addFull();
+  frameDamage = damage.getRegions();
+  Damage::Region bounds = damage.getBounds(); // we redraw union of damaged regions
+  damage.clear();
+  if(frameDamage.empty()) { // nothing has changed since last frame
+    compileProgramsInBackground();
+    subtitles.prepareCues(true);
+    runDeferredWork();
+    return;
+  }
+
+  bool scissor = bounds.size.width < Settings::instance().viewport.width || bounds.size.height < Settings::instance().viewport.height;
+  if(scissor) {
+    GLState::instance().enable(GL_SCISSOR_TEST);
+    glScissor(bounds.position.x, bounds.position.y, bounds.size.width, bounds.size.height);
+  }
+
   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
   glClear(GL_COLOR_BUFFER_BIT);
 
@@ -83,9 +128,91 @@ void Menu::render() {
   { // render modal window
     modalWindow.render();
   }
+
+  if(scissor)
+    GLState::instance().disable(GL_SCISSOR_TEST);
+
+  if(!firstFrameRendered) {
+    firstFrameRendered = true;
+    StartupReport::instance().addEvent("first frame");
+  }
+  compileProgramsInBackground();
+  if(std::chrono::steady_clock::now() - frameStart < Settings::instance().frameBudget / 2) // there is time left in this frame
+    subtitles.prepareCues(true);
+  runDeferredWork();
+  metrics.frameRendered(getUiState(), needsRedraw());
+}
+
+int Menu::getUiState() {
+  int state = 0;
+  if(loaderEnabled)
+    state |= static_cast<int>(UiState::Loader);
+  else if(background.getOpacity() >= 0.001f)
+    state |= static_cast<int>(UiState::Menu);
+  else {
+    if(playback.getOpacity() > 0.0f)
+      state |= static_cast<int>(UiState::Playback);
+    if(playback.isSeeking())
+      state |= static_cast<int>(UiState::SeekPreview);
+    if(options.isVisible())
+      state |= static_cast<int>(UiState::Options);
+  }
+  if(modalWindow.isVisible())
+    state |= static_cast<int>(UiState::Modal);
+  return state;
+}
+
+void Menu::compileProgramsInBackground() { // widgets build their programs on first render, loader time is used to prepare them
+  if(!loaderEnabled || !ProgramBuilder::isCompilationPending())
+    return;
+  bool ready = ProgramBuilder::compilePrefetched(); // tiles may register their program later on
+  if(ready && !programsReady)
+    StartupReport::instance().addEvent("all programs ready");
+  programsReady = programsReady || ready;
+}
+
+void Menu::collectDamage(Damage &damage) {
+  metrics.collectDamage(damage);
+  if(loaderEnabled) {
+    if(loader.isAnimating())
+      damage.addFull();
+    return;
+  }
+  for(Tile &tile : tiles)
+    if(tile.isAnimationActive() || tile.isPreviewRunning())
+      damage.addFull();
+  if(background.isAnimating())
+    damage.addFull();
+  if(background.getOpacity() < 0.001f) { // controls/playback
+    playback.collectDamage(damage);
+    subtitles.collectDamage(damage);
+  }
+}
+
+bool Menu::needsRedraw() {
+  Damage pending = damage;
+  collectDamage(pending);
+  return !pending.isEmpty() || (loaderEnabled && ProgramBuilder::isCompilationPending()) || subtitles.hasCuesToPrepare() || uploader.hasFinished() || resizer.hasFinished() || TextureManager::instance().hasFinishedMipmaps() || WorkScheduler::instance().hasPending(); // frames drive background work
+}
+
+void Menu::setPartialRedraw(bool enable) {
+  partialRedraw = enable;
+  requestRedraw();
+}
+
+int Menu::getDamageRegion(int *rects, int count) {
+  int n = std::min(count, static_cast<int>(frameDamage.size()));
+  for(int i = 0; i < n; ++i) {
+    rects[i * 4 + 0] = frameDamage[i].position.x;
+    rects[i * 4 + 1] = frameDamage[i].position.y;
+    rects[i * 4 + 2] = frameDamage[i].size.width;
+    rects[i * 4 + 3] = frameDamage[i].size.height;
+  }
+  return n;
 }
 
 void Menu::showMenu(int enable) {
+  requestRedraw();
   for(size_t i = 0; i < tiles.size(); ++i) { // let's make sure position/size parameters aren't going to be animated
     tiles[i].setPosition(getTilePosition(i - firstTile));
     tiles[i].setZoom(static_cast<int>(i) == selectedTile ? Settings::instance().zoom : 1.0);
@@ -160,13 +287,189 @@ int Menu::addTile() {
   return tiles.size() - 1;
 }
 
-void Menu::setTileData(TileData tileData) {
+void Menu::setTileData(TileData tileData, uint64_t cacheKey) {
   if(tileData.tileId >= static_cast<int>(tiles.size()))
     return;
+  requestRedraw();
+  tiles[tileData.tileId].setName(tileData.name);
+  tiles[tileData.tileId].setDescription(tileData.desc);
+  tiles[tileData.tileId].setStoryboardCallback(tileData.getStoryboardData);
+  if(tileData.pixels != nullptr && tileData.format == GL_NONE) { // size of the pixels isn't known
+    LogConsole::instance().log("Tile image of unknown pixel format ignored", LogConsole::LogLevel::Error);
+    return;
+  }
+
+  tiles[tileData.tileId].setCacheKey(cacheKey);
+
+  // host images are often much larger than a tile can ever be on screen, tile keeps its previous image until resized
+  if(tileData.pixels != nullptr && TileImageResizer::needsResize(tileData.size)) {
+    resizedImages[tileData.tileId] = resizer.resize(tileData.tileId, tileData.pixels, tileData.size, tileData.format);
+    return;
+  }
+  resizedImages.erase(tileData.tileId);
+  std::shared_ptr<std::vector<char>> pixels = std::make_shared<std::vector<char>>();
+  if(tileData.pixels != nullptr)
+    pixels->assign(tileData.pixels, tileData.pixels + static_cast<size_t>(tileData.size.width) * tileData.size.height * GLState::getBytesPerPixel(tileData.format));
+  setTileImage(tileData.tileId, pixels, tileData.size, tileData.format, {});
+}
+
+void Menu::setTileImage(int tileId, std::shared_ptr<std::vector<char>> pixels, Size<int> size, GLuint format, Tile::BackgroundImage backgroundImage) {
+  uint64_t cacheKey = tiles[tileId].getCacheKey();
+  if(cacheKey != 0) {
+    TextureCache::instance().store(cacheKey, pixels, size, format);
+    TextureCache::instance().store(cacheKey, backgroundImage.pixels, backgroundImage.size, backgroundImage.format, true);
+  }
+  keepBackgroundImage(tileId, backgroundImage);
+  if(backgroundImage.pixels && background.isShown(&tiles[tileId]))
+    prepareBackground(tileId);
+
+  if(uploader.isRunning()) {
+    uploader.upload(tileId, pixels->empty() ? nullptr : pixels->data(), size, format);
+    return;
+  }
+
+  // tile keeps its previous image (or isn't drawn) until the upload runs at the end of a frame
+  WorkScheduler::instance().schedule(getUploadPriority(tileId), WorkScheduler::Group::TileUpload, static_cast<uint64_t>(tileId), [this, tileId, pixels, size, format] {
+    tiles[tileId].setTexture(pixels->empty() ? nullptr : pixels->data(), size, format);
+    requestRedraw();
+  });
+}
+
+void Menu::keepBackgroundImage(int tileId, Tile::BackgroundImage image) {
+  std::list<int>::iterator kept = std::find(backgroundImageTiles.begin(), backgroundImageTiles.end(), tileId);
+  if(kept != backgroundImageTiles.end()) {
+    backgroundImageBytes -= tiles[tileId].getBackgroundImage().getBytes();
+    backgroundImageTiles.erase(kept);
+  }
+  tiles[tileId].setBackgroundImage(image);
+  if(!image.pixels)
+    return;
+
+  backgroundImageTiles.push_front(tileId);
+  backgroundImageBytes += image.getBytes();
+  while(backgroundImageBytes > Settings::instance().backgroundImageBudgetBytes && backgroundImageTiles.size() > 1) {
+    Tile &dropped = tiles[backgroundImageTiles.back()]; // shows an upscaled tile texture when selected again, unless it's cached
+    backgroundImageBytes -= dropped.getBackgroundImage().getBytes();
+    dropped.dropBackgroundImage();
+    backgroundImageTiles.pop_back();
+  }
+}
+
+void Menu::prepareBackground(int tileId) { // Background shows the tile texture until the upload at the end of a frame
+  Tile &tile = tiles[tileId];
+  if(tile.hasBackgroundTexture())
+    return;
+
+  Tile::BackgroundImage image = tile.getBackgroundImage();
+  if(image.pixels) {
+    backgroundImageTiles.splice(backgroundImageTiles.begin(), backgroundImageTiles, std::find(backgroundImageTiles.begin(), backgroundImageTiles.end(), tileId));
+    if(uploader.isRunning()) {
+      uploader.uploadBackground(tileId, image.pixels, image.size, image.format);
+      return;
+    }
+    WorkScheduler::instance().schedule(WorkScheduler::Priority::High, WorkScheduler::Group::BackgroundUpload, static_cast<uint64_t>(tileId), [this, tileId] {
+      if(background.isShown(&tiles[tileId]) && !tiles[tileId].hasBackgroundTexture())
+        tiles[tileId].uploadBackgroundTexture();
+      requestRedraw();
+    });
+    return;
+  }
+
+  // dropped over the budget, or the tile image came from the cache
+  std::shared_ptr<TextureCache::Image> file = TextureCache::instance().open(tile.getCacheKey(), true);
+  if(!file)
+    return;
+  if(uploader.isRunning()) { // pages of the mapping are faulted in on its thread
+    uploader.uploadBackground(tileId, file);
+    return;
+  }
+  WorkScheduler::instance().schedule(WorkScheduler::Priority::High, WorkScheduler::Group::BackgroundUpload, static_cast<uint64_t>(tileId), [this, tileId, file] { // file stays mapped until then
+    if(!background.isShown(&tiles[tileId]) || tiles[tileId].hasBackgroundTexture())
+      return;
+    GLuint texture = TextureCache::instance().upload(*file);
+    if(texture != 0)
+      tiles[tileId].setUploadedBackgroundTexture(texture, file->size, file->format);
+    requestRedraw();
+  });
+}
+
+bool Menu::setCachedTileData(TileData tileData, uint64_t cacheKey) {
+  if(tileData.tileId < 0 || tileData.tileId >= static_cast<int>(tiles.size()))
+    return false;
+  if(cacheKey == 0) { // files are never written for it, a miss every time would go unnoticed
+    LogConsole::instance().log("Texture cache hash 0 is invalid", LogConsole::LogLevel::Error);
+    return false;
+  }
+  if(tileData.pixels != nullptr) { // decoded by the host after a miss
+    setTileData(tileData, cacheKey);
+    return true;
+  }
+  std::shared_ptr<TextureCache::Image> image = TextureCache::instance().open(cacheKey);
+  if(!image)
+    return false;
+
+  requestRedraw();
   tiles[tileData.tileId].setName(tileData.name);
   tiles[tileData.tileId].setDescription(tileData.desc);
-  tiles[tileData.tileId].setTexture(tileData.pixels, tileData.size, tileData.format);
   tiles[tileData.tileId].setStoryboardCallback(tileData.getStoryboardData);
+  int tileId = tileData.tileId;
+  tiles[tileId].setCacheKey(cacheKey);
+  resizedImages.erase(tileId);
+  keepBackgroundImage(tileId, {}); // opened from the cache when Background shows the tile
+  if(background.isShown(&tiles[tileId]))
+    prepareBackground(tileId);
+  WorkScheduler::instance().schedule(getUploadPriority(tileId), WorkScheduler::Group::TileUpload, static_cast<uint64_t>(tileId), [this, tileId, image] { // file stays mapped until then
+    GLuint texture = TextureCache::instance().upload(*image);
+    if(texture != 0)
+      tiles[tileId].setUploadedTexture(texture, image->size, image->format);
+    requestRedraw();
+  });
+  return true;
+}
+
+WorkScheduler::Priority Menu::getUploadPriority(int tileId) {
+  bool visible = tileId == selectedTile || (tileId >= firstTile && tileId < firstTile + Settings::instance().tilesArrangement.width);
+  return visible ? WorkScheduler::Priority::High : WorkScheduler::Priority::Low;
+}
+
+bool Menu::setBackgroundUploads(bool enable) {
+  if(!enable) {
+    uploader.stop();
+    return false;
+  }
+  return uploader.start();
+}
+
+void Menu::runDeferredWork() {
+  if(WorkScheduler::instance().run() > 0) // deferred content shows up in the next frame
+    requestRedraw();
+}
+
+void Menu::setDeferredWorkBudget(std::chrono::microseconds budget) {
+  WorkScheduler::instance().setBudget(budget);
+}
+
+void Menu::collectUploads() {
+  for(TileImageResizer::Result &result : resizer.collect()) {
+    std::unordered_map<int, uint64_t>::iterator search = resizedImages.find(result.tileId);
+    if(search == resizedImages.end() || search->second != result.sequence)
+      continue; // tile got another image meanwhile
+    resizedImages.erase(search);
+    setTileImage(result.tileId, result.pixels, result.size, result.format, { result.backgroundPixels, result.backgroundSize, result.format });
+  }
+
+  std::vector<TextureUploader::Upload> uploads = uploader.collect();
+  for(TextureUploader::Upload &upload : uploads) {
+    bool valid = upload.tileId >= 0 && upload.tileId < static_cast<int>(tiles.size());
+    if(valid && upload.background && background.isShown(&tiles[upload.tileId]) && !tiles[upload.tileId].hasBackgroundTexture())
+      tiles[upload.tileId].setUploadedBackgroundTexture(upload.texture, upload.size, upload.format);
+    else if(valid && !upload.background)
+      tiles[upload.tileId].setUploadedTexture(upload.texture, upload.size, upload.format);
+    else
+      TextureManager::instance().release(upload.texture); // not adopted, deleted through GLState
+  }
+  if(!uploads.empty())
+    requestRedraw();
 }
 
 void Menu::selectTile(int tileNo, bool runPreview) {
@@ -174,6 +477,8 @@ void Menu::selectTile(int tileNo, bool runPreview) {
   if(tileNo == selectedTile || tileNo < 0 || tileNo >= static_cast<int>(tiles.size()))
     return;
 
+  requestRedraw();
+
   selectedTile = tileNo;
   bool selectedTileVisible = (firstTile <= selectedTile) && (firstTile + Settings::instance().tilesArrangement.width - 1 >= selectedTile);
   if(!selectedTileVisible) {
@@ -197,6 +502,7 @@ void Menu::selectTile(int tileNo, bool runPreview) {
   }
   if(selectedTile >= 0 && selectedTile < static_cast<int>(tiles.size())) {
     background.setSourceTile(&tiles[selectedTile]);
+    prepareBackground(selectedTile);
     tiles[selectedTile].setActive(true);
   }
 }
@@ -207,15 +513,18 @@ int Menu::addFont(char *data, int size) {
 }
 
 void Menu::showLoader(bool enabled, int percent) {
+  requestRedraw();
   loaderEnabled = enabled;
   loader.setValue(percent);
 }
 
 void Menu::setIcon(ImageData imageData) {
+  requestRedraw();
   playback.setIcon(imageData.id, imageData.pixels, imageData.size, imageData.format);
 }
 
 void Menu::setLoaderLogo(ImageData imageData) {
+  requestRedraw();
   loader.setLogo(imageData.id, imageData.pixels, imageData.size, imageData.format);
 }
 
@@ -230,9 +539,11 @@ void Menu::updatePlaybackControls(PlaybackData playbackData) {
                   playbackData.buffering,
                   playbackData.bufferingPercent,
 				  playbackData.seeking);
+  subtitles.updatePlaybackTime(std::chrono::milliseconds(playbackData.currentTime), playback.isPlaying());
 }
 
 void Menu::setFooter(std::string footer) {
+  requestRedraw();
   this->footer = footer;
 }
 
@@ -240,15 +551,34 @@ void Menu::showSubtitle(int duration, std::string text) {
   subtitles.showSubtitle(std::chrono::milliseconds(duration), text);
 }
 
+void Menu::addSubtitleCues(std::vector<Subtitles::Cue> cues) {
+  subtitles.addCues(cues);
+}
+
+int Menu::loadSubtitleTrack(const char *data, size_t length, SubtitleTrack::Format format) {
+  return subtitles.loadTrack(data, length, format);
+}
+
+void Menu::clearSubtitleCues() {
+  subtitles.clearCues();
+}
+
+void Menu::setMediaTime(int time, bool playing) {
+  subtitles.setMediaTime(std::chrono::milliseconds(time), playing);
+}
+
 bool Menu::addOption(int id, std::string name) {
+  requestRedraw();
   return options.addOption(id, name);
 }
 
 bool Menu::addSuboption(int parentId, int id, std::string name) {
+  requestRedraw();
   return options.addSuboption(parentId, id, name);
 }
 
 bool Menu::updateSelection(SelectionData selectionData) {
+  requestRedraw();
   return options.updateSelection(selectionData.show,
                                  selectionData.activeOptionId,
                                  selectionData.activeSubOptionId,
@@ -257,6 +587,7 @@ bool Menu::updateSelection(SelectionData selectionData) {
 }
 
 void Menu::clearOptions() {
+  requestRedraw();
   options.clearOptions();
 }
 
@@ -268,6 +599,7 @@ int Menu::addGraph(GraphData graphData) {
 }
 
 void Menu::setGraphVisibility(int graphId, bool visible) {
+  requestRedraw();
   metrics.setGraphVisibility(graphId, visible);
 }
 
@@ -284,10 +616,12 @@ void Menu::updateGraphRange(int graphId, float minVal, float maxVal) {
 }
 
 void Menu::selectAction(int id) {
+  requestRedraw();
   playback.selectAction(id);
 }
 
 void Menu::setLogConsoleVisibility(bool visible) {
+  requestRedraw();
   metrics.setLogConsoleVisibility(visible);
 }
 
@@ -295,12 +629,18 @@ void Menu::pushLog(std::string log) {
   metrics.pushLog(log);
 }
 
+uint64_t Menu::getDroppedLogs() {
+  return metrics.getDroppedLogs();
+}
+
 
 void Menu::showAlert(AlertData alertData) {
+  requestRedraw();
   modalWindow.show(alertData.title, alertData.body, alertData.button);
 }
 
 void Menu::hideAlert() {
+  requestRedraw();
   modalWindow.hide();
 }
 
@@ -312,3 +652,39 @@ bool Menu::isAlertVisible() {
 void Menu::setSeekPreviewCallback(StoryboardExternData (*getSeekPreviewStoryboardData)()) {
   playback.setStoryboardCallback(getSeekPreviewStoryboardData);
 }
+
+void Menu::setStoryboard(int storyboardId, Storyboard::Layout layout) { // storyboardId is a tile id, or -1 for the seek preview
+  if(storyboardId < -1 || storyboardId >= static_cast<int>(tiles.size()))
+    return;
+  requestRedraw();
+  if(storyboardId == -1)
+    playback.setStoryboard(Storyboard(storyboardId, layout));
+  else
+    tiles[storyboardId].setStoryboard(Storyboard(storyboardId, layout));
+}
+
+void Menu::setStoryboardSheet(int storyboardId, int sheetIndex, ImageData imageData) {
+  if(storyboardId < -1 || storyboardId >= static_cast<int>(tiles.size()))
+    return;
+  requestRedraw();
+  if(storyboardId == -1)
+    playback.setStoryboardSheet(sheetIndex, imageData);
+  else
+    tiles[storyboardId].setStoryboardSheet(sheetIndex, imageData);
+}
+
+void Menu::setJankCallback(void (*jankCallback)(JankInfo)) {
+  metrics.setJankCallback(jankCallback);
+}
+
+FrameStats::Summary Menu::getFrameStats(bool reset) {
+  return metrics.getFrameStats(reset);
+}
+
+int Menu::startProcessSampler(int intervalMs) {
+  return metrics.startProcessSampler(intervalMs);
+}
+
+void Menu::stopProcessSampler() {
+  metrics.stopProcessSampler();
+}
@@ -2,26 +2,40 @@
 #include "Settings.h"
 #include "TextRenderer.h"
 
+#include <algorithm>
+#include <cmath>
+
 Metrics::Metrics()
-  : logConsoleVisible(false) {
+  : logConsoleVisible(false),
+    margin({4, 10}),
+    graphSize({600, 50}),
+    lastFrameContinuous(false),
+    jankCallback(nullptr),
+    processTraceId(-1),
+    processSampleSequence(0) {
     traces.push_back(std::make_unique<Framerate>());
 }
 
+Metrics::~Metrics() {
+  LogConsole::instance().release();
+}
+
 void Metrics::render() {
-  Size<int> margin = {4, 10};
-  Size<int> size = {600, 50};
+  Size<int> size = graphSize;
   int rendered = 0;
 
+  pollProcessSampler();
   for(int i = 0; i < static_cast<int>(traces.size()); ++i) {
     if(Framerate *framerate = dynamic_cast<Framerate*>(traces[i].get()))
       framerate->step();
 
+    traces[i]->changed = false;
     if(!traces[i]->visible)
       continue;
 
-    Position<int> position = {Settings::instance().viewport.width - (size.width + margin.width),
-                              Settings::instance().viewport.height - (size.height + margin.height) * (rendered + 1)};
-    graph.render({traces[i]->values.begin(), traces[i]->values.end()},
+    Position<int> position = getGraphPosition(rendered);
+    graph.render(traces[i]->id,
+                 traces[i]->values,
                  {traces[i]->minValue, traces[i]->maxValue},
                  position,
                  size);
@@ -36,14 +50,37 @@ void Metrics::render() {
     ++rendered;
   }
 
-  if(logConsoleVisible) {
-    int bottomMargin = margin.height * 3;
-    Position<int> position = { Settings::instance().viewport.width - (size.width + margin.width),
-                               bottomMargin };
-    Size<int> size2 = {size.width,
-                                 Settings::instance().viewport.height - margin.height - bottomMargin - (size.height + margin.height) * rendered};
-    LogConsole::instance().render(position, size2, 0, 13);
+  if(logConsoleVisible)
+    LogConsole::instance().render(getLogConsolePosition(), getLogConsoleSize(rendered), 0, 13);
+}
+
+Position<int> Metrics::getGraphPosition(int row) {
+  return { Settings::instance().viewport.width - (graphSize.width + margin.width),
+           Settings::instance().viewport.height - (graphSize.height + margin.height) * (row + 1) };
+}
+
+Position<int> Metrics::getLogConsolePosition() {
+  int bottomMargin = margin.height * 3;
+  return { Settings::instance().viewport.width - (graphSize.width + margin.width), bottomMargin };
+}
+
+Size<int> Metrics::getLogConsoleSize(int rows) {
+  int bottomMargin = margin.height * 3;
+  return { graphSize.width, Settings::instance().viewport.height - margin.height - bottomMargin - (graphSize.height + margin.height) * rows };
+}
+
+void Metrics::collectDamage(Damage &damage) {
+  pollProcessSampler();
+  int rows = 0;
+  for(int i = 0; i < static_cast<int>(traces.size()); ++i) {
+    if(!traces[i]->visible)
+      continue;
+    if(traces[i]->changed || i == framerateId) // framerate changes every frame
+      damage.add(getGraphPosition(rows), graphSize + margin);
+    ++rows;
   }
+  if(logConsoleVisible && LogConsole::instance().hasPendingLogs())
+    damage.add(getLogConsolePosition(), getLogConsoleSize(rows));
 }
 
 int Metrics::addGraph(std::string tag, float minVal, float maxVal, int valuesMaxCount) {
@@ -62,16 +99,17 @@ void Metrics::updateGraphValues(int graphId, std::vector<float> values) {
   if(graphId < 1 || graphId > static_cast<int>(traces.size()))
       return;
   traces[graphId]->values.clear();
-  traces[graphId]->values.insert(traces[graphId]->values.begin(), values.begin(), values.end());
+  for(float value : values) // only the last valueMaxCount values are kept
+    traces[graphId]->values.push(value);
+  traces[graphId]->changed = true;
 }
 
 void Metrics::updateGraphValue(int graphId, float value) {
   if(graphId < 1 || graphId > static_cast<int>(traces.size()))
       return;
-  traces[graphId]->values.push_back(value);
-  while(static_cast<int>(traces[graphId]->values.size()) > traces[graphId]->valueMaxCount)
-    traces[graphId]->values.pop_front();
+  traces[graphId]->values.push(value);
   traces[graphId]->currentValue = value;
+  traces[graphId]->changed = true;
 }
 
 Metrics::Trace::Trace(int id, std::string tag, float minValue, float maxValue, int valueMaxCount)
@@ -80,8 +118,9 @@ Metrics::Trace::Trace(int id, std::string tag, float minValue, float maxValue, i
     currentValue(minValue),
     minValue(minValue),
     maxValue(maxValue),
-    valueMaxCount(valueMaxCount),
-    visible(false) {
+    values(static_cast<size_t>(std::max(valueMaxCount, 2))),
+    visible(false),
+    changed(false) {
 }
 
 Metrics::Framerate::Framerate()
@@ -96,13 +135,11 @@ void Metrics::Framerate::step() {
   std::chrono::duration<float, std::milli> timespan = now - fpsTime;
   fpsTime = now;
   float currentFps = 1000.0f / timespan.count();
-  fpsSum += currentFps;
-  values.push_back(currentFps);
-  while(static_cast<int>(values.size()) > valueMaxCount) {
+  if(values.full())
     fpsSum -= values.front();
-    values.pop_front();
-  }
-  currentValue = fpsSum / (values.size() ? : 1);
+  fpsSum += currentFps;
+  values.push(currentFps);
+  currentValue = fpsSum / values.size();
 }
 
 
@@ -111,12 +148,68 @@ void Metrics::updateGraphRange(int graphId, float minVal, float maxVal) {
       return;
   traces[graphId]->minValue = minVal;
   traces[graphId]->maxValue = maxVal;
+  traces[graphId]->changed = true;
+}
+
+void Metrics::frameRendered(int uiState, bool continuous) {
+  std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+  if(lastFrameContinuous) {
+    float frameMs = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(now - lastFrameTime).count();
+    float budgetMs = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(Settings::instance().frameBudget).count();
+    FrameStats::Jank jank = frameStats.add(frameMs, budgetMs);
+    if(jank != FrameStats::Jank::None && jankCallback != nullptr)
+      jankCallback(JankInfo { frameMs, budgetMs, jank == FrameStats::Jank::Severe ? 1 : 0, uiState });
+  }
+  lastFrameTime = now;
+  lastFrameContinuous = continuous;
+}
+
+FrameStats::Summary Metrics::getFrameStats(bool reset) {
+  FrameStats::Summary summary = frameStats.getSummary();
+  if(reset)
+    frameStats.reset();
+  return summary;
+}
+
+int Metrics::startProcessSampler(int intervalMs) {
+  if(processTraceId < 0) {
+    processTraceId = addGraph("CPU %", 0, 100, 100);
+    addGraph("RSS MB", 0, 64, 100);
+    addGraph("Threads", 0, 16, 100);
+    addGraph("GPU MB", 0, 16, 100);
+  }
+  processSampler.start(intervalMs);
+  return processTraceId;
+}
+
+void Metrics::stopProcessSampler() {
+  processSampler.stop();
+}
+
+void Metrics::pollProcessSampler() {
+  ProcessSampler::Sample sample;
+  if(processTraceId < 0 || !processSampler.getSample(processSampleSequence, sample))
+    return;
+  pushProcessValue(processTraceId, sample.cpuPercent, 0.0f);
+  pushProcessValue(processTraceId + 1, sample.rssMB, 64.0f);
+  pushProcessValue(processTraceId + 2, sample.threads, 16.0f);
+  pushProcessValue(processTraceId + 3, sample.gpuMB, 16.0f);
+}
+
+void Metrics::pushProcessValue(int traceId, float value, float rangeStep) {
+  updateGraphValue(traceId, value);
+  if(rangeStep > 0.0f && value > traces[traceId]->maxValue) // grows in steps, so the graph texture is rarely rebuilt
+    traces[traceId]->maxValue = std::ceil(value * 1.25f / rangeStep) * rangeStep;
 }
 
 void Metrics::setLogConsoleVisibility(bool visible) {
   logConsoleVisible = visible;
 }
 
+uint64_t Metrics::getDroppedLogs() {
+  return LogConsole::instance().getDroppedLogs();
+}
+
 void Metrics::pushLog(std::string log) {
   LogConsole::instance().pushLog(log);
 }
@@ -0,0 +1,252 @@
+#include "MipmapGenerator.h"
+#include "GLState.h"
+#include "PixelConverter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIPMAP_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPMAP_SSE2
+#endif
+
+namespace {
+
+// Averages 2x2 blocks of rows row0 and row1 into dst, from pixel x on. Like the last row of an odd height,
+// the last column of an odd width is dropped; a single row or column is averaged with itself.
+void downsampleRow(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int x, int srcWidth, int dstWidth, int bpp) {
+  for(; x < dstWidth; ++x) {
+    int left = 2 * x * bpp;
+    int right = std::min(2 * x + 1, srcWidth - 1) * bpp;
+    for(int c = 0; c < bpp; ++c)
+      dst[x * bpp + c] = static_cast<uint8_t>((row0[left + c] + row0[right + c] + row1[left + c] + row1[right + c] + 2) >> 2);
+  }
+}
+
+#if defined(MIPMAP_SSE2)
+int downsampleRowRGBA(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int dstWidth) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  int x = 0;
+  for(; x + 4 <= dstWidth; x += 4) { // 8 source pixels of both rows into 4
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+    __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+    __m128i p01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero)); // columns 0 and 1, 16 bits per channel
+    __m128i p23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+    __m128i p45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+    __m128i p67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+    __m128i s01 = _mm_unpacklo_epi64(_mm_add_epi16(p01, _mm_srli_si128(p01, 8)), _mm_add_epi16(p23, _mm_srli_si128(p23, 8)));
+    __m128i s23 = _mm_unpacklo_epi64(_mm_add_epi16(p45, _mm_srli_si128(p45, 8)), _mm_add_epi16(p67, _mm_srli_si128(p67, 8)));
+    s01 = _mm_srli_epi16(_mm_add_epi16(s01, two), 2);
+    s23 = _mm_srli_epi16(_mm_add_epi16(s23, two), 2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(s01, s23));
+  }
+  return x;
+}
+#elif defined(MIPMAP_NEON)
+int downsampleRowRGBA(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int dstWidth) {
+  int x = 0;
+  for(; x + 2 <= dstWidth; x += 2) { // 4 source pixels of both rows into 2
+    uint8x16_t a = vld1q_u8(row0 + x * 8);
+    uint8x16_t b = vld1q_u8(row1 + x * 8);
+    uint16x8_t p01 = vaddl_u8(vget_low_u8(a), vget_low_u8(b)); // columns 0 and 1, 16 bits per channel
+    uint16x8_t p23 = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+    uint16x8_t sum = vcombine_u16(vadd_u16(vget_low_u16(p01), vget_high_u16(p01)), vadd_u16(vget_low_u16(p23), vget_high_u16(p23)));
+    vst1_u8(dst + x * 4, vrshrn_n_u16(sum, 2)); // (sum + 2) >> 2
+  }
+  return x;
+}
+#endif
+
+void downsample(const char *pixels, Size<int> srcSize, MipmapGenerator::Level &dst, int bpp, bool simd) {
+  const uint8_t *srcPixels = reinterpret_cast<const uint8_t*>(pixels);
+  uint8_t *dstPixels = reinterpret_cast<uint8_t*>(dst.pixels.data());
+  size_t srcStride = static_cast<size_t>(srcSize.width) * bpp;
+  size_t dstStride = static_cast<size_t>(dst.size.width) * bpp;
+  for(int y = 0; y < dst.size.height; ++y) {
+    const uint8_t *row0 = srcPixels + 2 * y * srcStride;
+    const uint8_t *row1 = srcPixels + std::min(2 * y + 1, srcSize.height - 1) * srcStride;
+    uint8_t *row = dstPixels + y * dstStride;
+    int x = 0;
+#if defined(MIPMAP_SSE2) || defined(MIPMAP_NEON)
+    if(simd && bpp == 4 && srcSize.width >= 2)
+      x = downsampleRowRGBA(row0, row1, row, dst.size.width);
+#else
+    (void) simd;
+#endif
+    downsampleRow(row0, row1, row, x, srcSize.width, dst.size.width, bpp);
+  }
+}
+
+} // namespace
+
+MipmapGenerator::MipmapGenerator()
+  : stopRequested(false) {
+}
+
+MipmapGenerator::~MipmapGenerator() {
+  stop();
+}
+
+void MipmapGenerator::generate(GLuint texture, uint64_t generation, GLenum format, Size<int> size, const void *pixels) {
+  if(pixels == nullptr || size.width <= 0 || size.height <= 0)
+    return;
+  const char *begin = static_cast<const char*>(pixels);
+  size_t bytes = static_cast<size_t>(size.width) * size.height * GLState::getBytesPerPixel(format);
+  queue({ texture, generation, format, size, std::vector<char>(begin, begin + bytes), GL_NONE, 0, true });
+}
+
+void MipmapGenerator::compress(GLuint texture, uint64_t generation, GLenum compressedFormat, int quality, bool mipmaps, GLenum format, Size<int> size, const void *pixels) {
+  if(pixels == nullptr || size.width <= 0 || size.height <= 0)
+    return;
+  const char *begin = static_cast<const char*>(pixels);
+  size_t bytes = static_cast<size_t>(size.width) * size.height * GLState::getBytesPerPixel(format);
+  queue({ texture, generation, format, size, std::vector<char>(begin, begin + bytes), compressedFormat, quality, mipmaps });
+}
+
+void MipmapGenerator::queue(Job job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool compressed = job.compressedFormat != GL_NONE;
+    std::deque<Job>::iterator queued = std::find_if(jobs.begin(), jobs.end(), [&job, compressed](const Job &other) {
+      return other.texture == job.texture && (other.compressedFormat != GL_NONE) == compressed;
+    });
+    if(queued != jobs.end()) // content replaced before it was processed, order of mip chain and compression is kept
+      *queued = std::move(job);
+    else
+      jobs.push_back(std::move(job));
+    if(!thread.joinable()) {
+      stopRequested = false;
+      thread = std::thread(&MipmapGenerator::run, this);
+    }
+  }
+  wakeUp.notify_all();
+}
+
+void MipmapGenerator::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    wakeUp.wait(lock, [this] { return stopRequested || !jobs.empty(); });
+    if(stopRequested)
+      break;
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    lock.unlock();
+    Chain chain { job.texture, job.generation, job.format, {}, {} };
+    if(job.compressedFormat == GL_NONE)
+      chain.levels = buildChain(job.pixels.data(), job.size, job.format);
+    else {
+      chain.format = job.compressedFormat;
+      chain.compressed = EtcEncoder::encodeChain(job.pixels.data(), job.size, job.format, static_cast<EtcEncoder::Quality>(job.quality), job.mipmaps);
+    }
+    lock.lock();
+    finished.push_back(std::move(chain));
+  }
+}
+
+std::vector<MipmapGenerator::Chain> MipmapGenerator::collect() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<Chain> chains(std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.end()));
+  finished.clear();
+  return chains;
+}
+
+bool MipmapGenerator::hasFinished() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !finished.empty();
+}
+
+void MipmapGenerator::stop() {
+  if(!thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  wakeUp.notify_all();
+  thread.join();
+  jobs.clear();
+  finished.clear();
+}
+
+std::vector<MipmapGenerator::Level> MipmapGenerator::buildChain(const char *pixels, Size<int> size, GLenum format, bool simd) {
+  std::vector<Level> levels;
+  int bpp = static_cast<int>(GLState::getBytesPerPixel(format));
+  int count = 0;
+  for(int largest = std::max(size.width, size.height); largest > 1; largest /= 2)
+    ++count;
+  levels.reserve(count); // previous level is read while the next one is added
+
+  const char *src = pixels;
+  Size<int> srcSize = size;
+  for(int i = 0; i < count; ++i) {
+    Size<int> levelSize(std::max(srcSize.width / 2, 1), std::max(srcSize.height / 2, 1));
+    levels.push_back({ levelSize, std::vector<char>(static_cast<size_t>(levelSize.width) * levelSize.height * bpp) });
+    downsample(src, srcSize, levels.back(), bpp, simd);
+    src = levels.back().pixels.data();
+    srcSize = levelSize;
+  }
+  return levels;
+}
+
+void MipmapGenerator::uploadChain(const std::vector<Level> &levels, GLenum format) {
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for(size_t i = 0; i < levels.size(); ++i)
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), format, levels[i].size.width, levels[i].size.height, 0, format, GL_UNSIGNED_BYTE, levels[i].pixels.data());
+}
+
+int MipmapGenerator::benchmark(Size<int> size, GLenum format, int iterations, int *results, int count) {
+  assertCurrentEGLContext();
+
+  const int available = 4;
+  if(size.width <= 0 || size.height <= 0 || iterations <= 0 || format == GL_NONE)
+    return available;
+  format = PixelConverter::instance().getUploadFormat(format);
+
+  std::vector<char> pixels(static_cast<size_t>(size.width) * size.height * GLState::getBytesPerPixel(format));
+  uint32_t seed = 12345;
+  for(char &value : pixels) { // noise, so no driver can take shortcuts for uniform content
+    seed = seed * 1664525u + 1013904223u;
+    value = static_cast<char>(seed >> 24);
+  }
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  GLState::instance().bindTexture(0, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, size.width, size.height, 0, format, GL_UNSIGNED_BYTE, pixels.data());
+  glFinish();
+
+  typedef std::chrono::steady_clock Clock;
+  long long elapsed[available] = { 0, 0, 0, 0 }; // microseconds
+  std::vector<Level> levels;
+  for(int i = 0; i < iterations; ++i) {
+    Clock::time_point start = Clock::now();
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish();
+    Clock::time_point driver = Clock::now();
+    levels = buildChain(pixels.data(), size, format, false);
+    Clock::time_point scalar = Clock::now();
+    levels = buildChain(pixels.data(), size, format, true);
+    Clock::time_point simd = Clock::now();
+    uploadChain(levels, format);
+    glFinish();
+    Clock::time_point upload = Clock::now();
+
+    elapsed[0] += std::chrono::duration_cast<std::chrono::microseconds>(driver - start).count();
+    elapsed[1] += std::chrono::duration_cast<std::chrono::microseconds>(scalar - driver).count();
+    elapsed[2] += std::chrono::duration_cast<std::chrono::microseconds>(simd - scalar).count();
+    elapsed[3] += std::chrono::duration_cast<std::chrono::microseconds>(upload - simd).count();
+  }
+  GLState::instance().deleteTexture(texture);
+
+  for(int i = 0; results != nullptr && i < std::min(count, available); ++i)
+    results[i] = static_cast<int>(elapsed[i] / iterations);
+  return available;
+}
@@ -1,46 +1,12 @@
 #include "ModalWindow.h"
-#include "ProgramBuilder.h"
+#include "RectRenderer.h"
 #include "Settings.h"
 #include "TextRenderer.h"
 #include "Utility.h"
 
 ModalWindow::ModalWindow()
-    : programObject(GL_INVALID_VALUE),
-    posALoc(GL_INVALID_VALUE),
-    posLoc(GL_INVALID_VALUE),
-    sizLoc(GL_INVALID_VALUE),
-    colLoc(GL_INVALID_VALUE),
-    opaLoc(GL_INVALID_VALUE),
-    visible(false),
+    : visible(false),
     paramsNeedRecalculation(false) {
-  initialize();
-}
-
-ModalWindow::~ModalWindow() {
-  assertCurrentEGLContext();
-
-  if(programObject != GL_INVALID_VALUE)
-    glDeleteProgram(programObject);
-}
-
-void ModalWindow::initialize() {
-  assertCurrentEGLContext();
-
-  const GLchar* vShaderTexStr =  
-#include "shaders/modalWindow.vert"
-;
-
-  const GLchar* fShaderTexStr = 
-#include "shaders/modalWindow.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
-
-  posALoc = glGetAttribLocation(programObject, "a_position");
-  posLoc = glGetUniformLocation(programObject, "u_position");
-  sizLoc = glGetUniformLocation(programObject, "u_size");
-  colLoc = glGetUniformLocation(programObject, "u_color");
-  opaLoc = glGetUniformLocation(programObject, "u_opacity");
 }
 
 void ModalWindow::render() {
@@ -53,6 +19,8 @@ void ModalWindow::render() {
     calculateParams();
 
   renderRectangle(position, size);
+  renderRectangle(params.buttonWindow.position, params.buttonWindow.size);
+  RectRenderer::instance().flush(); // window and button in one draw call
   renderContent();
 }
 
@@ -110,32 +78,7 @@ void ModalWindow::calculateParams() {
 }
 
 void ModalWindow::renderRectangle(Position<int> position, Size<int> size) {
-  assertCurrentEGLContext();
-
-  float down  = static_cast<float>(position.y) / static_cast<float>(Settings::instance().viewport.height) * 2.0f - 1.0f;
-  float top   = (static_cast<float>(position.y) + static_cast<float>(size.height)) / static_cast<float>(Settings::instance().viewport.height) * 2.0f - 1.0f;
-  float left  = static_cast<float>(position.x) / static_cast<float>(Settings::instance().viewport.width) * 2.0f - 1.0f;
-  float right = (static_cast<float>(position.x) + static_cast<float>(size.width)) / static_cast<float>(Settings::instance().viewport.width) * 2.0f - 1.0f;
-  GLfloat vVertices[] = { left,   top,  0.0f,
-                          left,   down, 0.0f,
-                          right,  down, 0.0f,
-                          right,  top,  0.0f
-  };
-  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
-  glUseProgram(programObject);
-  glEnableVertexAttribArray(posALoc);
-  glVertexAttribPointer(posALoc, 3, GL_FLOAT, GL_FALSE, 0, vVertices);
-
-  glUniform2f(posLoc, static_cast<float>(position.x), static_cast<float>(position.y));
-  glUniform2f(sizLoc, static_cast<float>(size.width), static_cast<float>(size.height));
-  glUniform3f(colLoc, 1.0f, 1.0f, 1.0f);
-  glUniform1f(opaLoc, 1.0f);
-
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(posALoc);
-  glUseProgram(0);
+  RectRenderer::instance().add(position, size, {0.0f, 0.0f, 0.0f, 0.75f}, 1.0f, {1.0f, 1.0f, 1.0f, 0.75f});
 }
 
 void ModalWindow::renderContent() {
@@ -186,8 +129,6 @@ void ModalWindow::renderBody() {
 }
 
 void ModalWindow::renderButton() {
-  renderRectangle(params.buttonWindow.position,
-                  params.buttonWindow.size);
   TextRenderer::instance().render(params.buttonText.text,
                      params.buttonText.position,
                      {params.lineWidth, params.buttonText.fontSize},
@@ -1,5 +1,5 @@
 #include "Options.h"
-#include "ProgramBuilder.h"
+#include "RectRenderer.h"
 #include "Settings.h"
 #include "TextRenderer.h"
 #include "Utility.h"
@@ -24,29 +24,6 @@ Options::Options()
     selectedSuboptionId(-1),
     opacity(0.0f),
     show(false) {
-    initialize();
-}
-
-void Options::initialize() {
-  assertCurrentEGLContext();
-
-  const GLchar* vShaderTexStr = 
-#include "shaders/options.vert"
-;
-
-  const GLchar* fShaderTexStr = 
-#include "shaders/options.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
-
-  positionALoc       = glGetAttribLocation(programObject, "a_position");
-  positionLoc        = glGetUniformLocation(programObject, "u_position");
-  sizeLoc            = glGetUniformLocation(programObject, "u_size");
-  colorLoc           = glGetUniformLocation(programObject, "u_color");
-  opacityLoc         = glGetUniformLocation(programObject, "u_opacity");
-  frameWidthLoc      = glGetUniformLocation(programObject, "u_frameWidth");
-  frameColorLoc      = glGetUniformLocation(programObject, "u_frameColor");
 }
 
 bool Options::addOption(int id, std::string name) {
@@ -54,6 +31,7 @@ bool Options::addOption(int id, std::string name) {
   opt.id = id;
   opt.name = name.substr(0, maxTextLength);
   options.insert({id, opt});
+  layer.invalidate();
   return true;
 }
 
@@ -65,6 +43,7 @@ bool Options::addSuboption(int parentId, int id, std::string name) {
   subopt.parentId = parentId;
   subopt.name = name.substr(0, maxTextLength);
   options.at(parentId).subopt.insert({id, subopt});
+  layer.invalidate();
   return true;
 }
 
@@ -74,11 +53,13 @@ bool Options::updateSelection(bool show, int activeOptionId, int activeSuboption
   this->activeSuboptionId = activeSuboptionId;
   this->selectedOptionId = selectedOptionId;
   this->selectedSuboptionId = selectedSuboptionId;
+  layer.invalidate();
   return true;
 }
 
 void Options::clearOptions() {
   options.clear();
+  layer.invalidate();
 }
 
 void Options::renderIcon() {
@@ -91,19 +72,27 @@ void Options::renderIcon() {
                   "Options",
                   !show ? frameWidth : 0,
                   frameColor);
+  renderLabels();
 }
 
 void Options::render() {
   assertCurrentEGLContext();
 
-  if(!show || opacity <= 0.0f)
+  if(!show || opacity <= 0.0f) {
+    layer.release();
     return;
+  }
+  layer.update(std::bind(&Options::renderOptions, this));
+  layer.composite(opacity);
+}
+
+void Options::renderOptions() {
   Position<int> optionPosition { this->position.x + margin.width, this->position.y + static_cast<int>(options.empty() ? 0 : options.size() - 1) * (optionRectangleSize.height + margin.height) };
   for(const std::pair<int, Option>& option : options) {
     renderRectangle(optionPosition,
                     optionRectangleSize,
                     option.first == activeOptionId ? activeOptionColor : option.first == selectedOptionId ? selectedOptionColor : optionColor,
-                    opacity,
+                    1.0f, // opacity is applied to the whole layer
                     option.second.name,
                     option.first == selectedOptionId && selectedSuboptionId == -1 ? frameWidth : 0,
                     frameColor,
@@ -114,7 +103,7 @@ void Options::render() {
         renderRectangle(suboptionPosition,
                         suboptionRectangleSize,
                         suboption.first == activeSuboptionId ? activeSuboptionColor : suboption.first == selectedSuboptionId ? selectedSuboptionColor : suboptionColor,
-                        opacity,
+                        1.0f,
                         suboption.second.name,
                         suboption.first == selectedSuboptionId ? frameWidth : 0,
                         frameColor,
@@ -124,45 +113,30 @@ void Options::render() {
     }
     optionPosition.y -= optionRectangleSize.height + margin.height;
   }
+  renderLabels();
 }
 
 void Options::renderRectangle(Position<int> position, Size<int> size, std::vector<float> color, float opacity, std::string name, int frameWidth, std::vector<float> frameColor, bool submenuSelected) {
-  assertCurrentEGLContext();
-
-  float down = static_cast<float>(position.y) / Settings::instance().viewport.height * 2.0f - 1.0f;
-  float top = static_cast<float>(position.y + size.height) / Settings::instance().viewport.height * 2.0f - 1.0f;
-  float left = static_cast<float>(position.x) / Settings::instance().viewport.width * 2.0f - 1.0f;
-  float right = static_cast<float>(position.x + size.width) / Settings::instance().viewport.width * 2.0f - 1.0f;
-  GLfloat vertices[] = { left,   top,  0.0f,
-                          left,   down, 0.0f,
-                          right,  down, 0.0f,
-                          right,  top,  0.0f
-  };
-  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
-  glUseProgram(programObject);
-  glEnableVertexAttribArray(positionALoc);
-  glVertexAttribPointer(positionALoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
-
-  glUniform2f(positionLoc, position.x, position.y);
-  glUniform2f(sizeLoc, size.width, size.height);
-  glUniform3f(colorLoc, color[0], color[1], color[2]);
-  glUniform1f(opacityLoc, opacity);
-
-  glUniform1f(frameWidthLoc, frameWidth);
-  glUniform3f(frameColorLoc, frameColor[0], frameColor[1], frameColor[2]);
-
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(positionALoc);
-  glUseProgram(0);
+  RectRenderer::instance().add(position,
+                               size,
+                               {color[0], color[1], color[2], 0.75f * opacity},
+                               static_cast<float>(frameWidth),
+                               {frameColor[0], frameColor[1], frameColor[2], 0.75f * opacity});
 
   int fontHeight = size.height / 2;
   int margin = (size.height - fontHeight) / 2;
-  TextRenderer::instance().render(name,
-              {position.x + margin, position.y + margin},
-              {0, fontHeight},
-              0,
-              {1.0, 1.0, 1.0, opacity});
+  labels.push_back({name, {position.x + margin, position.y + margin}, fontHeight, opacity});
 }
 
+void Options::renderLabels() {
+  assertCurrentEGLContext();
+
+  RectRenderer::instance().flush(); // all rectangles go in one draw call, labels are drawn on top of them
+  for(const Label &label : labels)
+    TextRenderer::instance().render(label.text,
+                label.position,
+                {0, label.fontHeight},
+                0,
+                {1.0, 1.0, 1.0, label.opacity});
+  labels.clear();
+}
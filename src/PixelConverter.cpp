@@ -0,0 +1,126 @@
+#include "PixelConverter.h"
+#include "EtcEncoder.h"
+#include "LogConsole.h"
+#include "Settings.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CONVERTER_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CONVERTER_SSE2
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define CONVERTER_SSSE3
+#endif
+#endif
+
+PixelConverter::PixelConverter()
+  : bgraSupported(false), // converted until probed
+    expandRgb(Settings::instance().expandRgbUploads),
+    etcFormat(GL_NONE) {
+}
+
+void PixelConverter::probe() {
+  bgraSupported = Utility::hasGLExtension("GL_EXT_texture_format_BGRA8888") || Utility::hasGLExtension("GL_IMG_texture_format_BGRA8888");
+  LogConsole::instance().log(std::string("BGRA uploads ") + (bgraSupported ? "supported" : "converted to RGBA"), LogConsole::LogLevel::Debug);
+
+  const char *version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  int major = 0;
+  if(version != nullptr && std::sscanf(version, "OpenGL ES %d", &major) != 1)
+    major = 0;
+  if(major >= 3) // ETC2 is core
+    etcFormat = GL_COMPRESSED_RGB8_ETC2;
+  else if(Utility::hasGLExtension("GL_OES_compressed_ETC1_RGB8_texture"))
+    etcFormat = GL_ETC1_RGB8_OES;
+  else
+    etcFormat = GL_NONE;
+}
+
+GLenum PixelConverter::getUploadFormat(GLenum format) {
+  if((format == GL_BGRA_EXT && !bgraSupported) || (format == GL_RGB && expandRgb))
+    return GL_RGBA;
+  return format;
+}
+
+const void* PixelConverter::convert(GLenum format, Size<int> size, const void *pixels, std::vector<char> &buffer) {
+  if(pixels == nullptr || getUploadFormat(format) == format || size.width <= 0 || size.height <= 0)
+    return pixels;
+
+  size_t count = static_cast<size_t>(size.width) * size.height;
+  buffer.resize(count * 4);
+  const uint8_t *src = static_cast<const uint8_t*>(pixels);
+  uint8_t *dst = reinterpret_cast<uint8_t*>(buffer.data());
+  if(format == GL_BGRA_EXT)
+    bgraToRgba(src, dst, count);
+  else
+    rgbToRgba(src, dst, count);
+  return buffer.data();
+}
+
+void PixelConverter::bgraToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+#if defined(CONVERTER_NEON)
+  for(; i + 16 <= count; i += 16) {
+    uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+    uint8x16_t blue = pixels.val[0];
+    pixels.val[0] = pixels.val[2];
+    pixels.val[2] = blue;
+    vst4q_u8(dst + i * 4, pixels);
+  }
+#elif defined(CONVERTER_SSE2)
+  const __m128i keep = _mm_set1_epi32(0xFF00FF00); // green and alpha
+  const __m128i low = _mm_set1_epi32(0x000000FF);
+  for(; i + 4 <= count; i += 4) {
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    __m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16), low);
+    __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, low), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_and_si128(pixels, keep), _mm_or_si128(red, blue)));
+  }
+#endif
+  for(; i < count; ++i) {
+    uint8_t blue = src[i * 4];
+    dst[i * 4] = src[i * 4 + 2];
+    dst[i * 4 + 1] = src[i * 4 + 1];
+    dst[i * 4 + 2] = blue;
+    dst[i * 4 + 3] = src[i * 4 + 3];
+  }
+}
+
+void PixelConverter::rgbToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+#if defined(CONVERTER_NEON)
+  for(; i + 16 <= count; i += 16) {
+    uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+    uint8x16x4_t rgba = {{ rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(255) }};
+    vst4q_u8(dst + i * 4, rgba);
+  }
+#elif defined(CONVERTER_SSSE3)
+  const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  for(; i + 6 <= count; i += 4) { // 16 bytes are read for 4 pixels, 2 more pixels have to follow
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, spread), alpha));
+  }
+#elif defined(CONVERTER_SSE2)
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  for(; i + 6 <= count; i += 4) { // every pixel is read as 4 bytes, the last one needs a following pixel
+    int32_t pixel[4];
+    std::memcpy(pixel, src + i * 3, 4);
+    std::memcpy(pixel + 1, src + i * 3 + 3, 4);
+    std::memcpy(pixel + 2, src + i * 3 + 6, 4);
+    std::memcpy(pixel + 3, src + i * 3 + 9, 4);
+    __m128i pixels = _mm_setr_epi32(pixel[0], pixel[1], pixel[2], pixel[3]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(pixels, alpha)); // little endian, 4th byte is alpha
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i * 4] = src[i * 3];
+    dst[i * 4 + 1] = src[i * 3 + 1];
+    dst[i * 4 + 2] = src[i * 3 + 2];
+    dst[i * 4 + 3] = 255;
+  }
+}
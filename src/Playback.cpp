@@ -1,9 +1,48 @@
 #include "Playback.h"
+#include "GLState.h"
 #include "ProgramBuilder.h"
 #include "Settings.h"
 #include "TextRenderer.h"
 #include "Utility.h"
 #include "LogConsole.h"
+#include "StoryboardCache.h"
+#include "TextureManager.h"
+
+namespace {
+
+const GLchar* barVShaderTexStr =
+#include "shaders/playbackBar.vert"
+;
+
+const GLchar* barFShaderTexStr =
+#include "shaders/playbackBar.frag"
+;
+
+const GLchar* iconVShaderTexStr =
+#include "shaders/playbackIcon.vert"
+;
+
+const GLchar* iconFShaderTexStr =
+#include "shaders/playbackIcon.frag"
+;
+
+const GLchar* loaderVShaderTexStr =
+#include "shaders/playbackLoader.vert"
+;
+
+const GLchar* loaderFShaderTexStr =
+#include "shaders/playbackLoader.frag"
+;
+
+const GLchar* seekVShaderTexStr =
+#include "shaders/framedImage.vert"
+;
+
+const GLchar* seekFShaderTexStr =
+#include "shaders/framedImage.frag"
+;
+
+} // namespace
 
 Playback::Playback()
   : barProgramObject(GL_INVALID_VALUE),
@@ -21,6 +60,8 @@ Playback::Playback()
     bufferingPercent(0.0f),
     seeking(false),
     lastUpdate(std::chrono::steady_clock::now()),
+    overlayChanged(false),
+    controlsChanged(false),
     progressUiLineLevel(100),
     progressBarSizePx({1400, 20}),
     progressBarSize({
@@ -31,43 +72,35 @@ Playback::Playback()
     iconSize({64, 64}),
     storyboardBitmapHash(0),
     getStoryboardDataCallback(nullptr),
+    seekStoryboardFrame(0),
     displaySeekPreview(false),
     seekPreviewReady(false) {
-  initialize();
+  ProgramBuilder::prefetchProgram("playbackBar", barVShaderTexStr, barFShaderTexStr);
+  ProgramBuilder::prefetchProgram("playbackIcon", iconVShaderTexStr, iconFShaderTexStr);
+  ProgramBuilder::prefetchProgram("playbackLoader", loaderVShaderTexStr, loaderFShaderTexStr);
+  ProgramBuilder::prefetchProgram("framedImage", seekVShaderTexStr, seekFShaderTexStr);
 }
 
 Playback::~Playback() {
   assertCurrentEGLContext();
 
   if(barProgramObject != GL_INVALID_VALUE)
-    glDeleteProgram(barProgramObject);
+    GLState::instance().deleteProgram(barProgramObject);
   if(iconProgramObject != GL_INVALID_VALUE)
-    glDeleteProgram(iconProgramObject);
+    GLState::instance().deleteProgram(iconProgramObject);
   for(size_t i = 0; i < icons.size(); ++i)
     if(icons[i] > 0) {
-      glDeleteTextures(1, &icons[i]);
+      TextureManager::instance().release(icons[i]);
       icons[i] = 0;
     }
   if(seekProgramObject != GL_INVALID_VALUE)
-    glDeleteProgram(seekProgramObject);
-  if(seekTextureId != 0) {
-    glDeleteTextures(1, &seekTextureId);
-    seekTextureId = 0;
-  }
+    GLState::instance().deleteProgram(seekProgramObject);
 }
 
 void Playback::initialize() {
   assertCurrentEGLContext();
 
-  const GLchar* barVShaderTexStr = 
-#include "shaders/playbackBar.vert"
-;
-
-  const GLchar* barFShaderTexStr =  
-#include "shaders/playbackBar.frag"
-;
-
-  barProgramObject = ProgramBuilder::buildProgram(barVShaderTexStr, barFShaderTexStr);
+  barProgramObject = ProgramBuilder::buildProgram(barVShaderTexStr, barFShaderTexStr, "playbackBar");
 
   posBarLoc = glGetAttribLocation(barProgramObject, "a_position");
   paramBarLoc = glGetUniformLocation(barProgramObject, "u_param");
@@ -77,15 +110,7 @@ void Playback::initialize() {
   marginBarLoc = glGetUniformLocation(barProgramObject, "u_margin");
   dotScaleBarLoc = glGetUniformLocation(barProgramObject, "u_dot_scale");
 
-  const GLchar* iconVShaderTexStr =
-#include "shaders/playbackIcon.vert"
-;
-
-  const GLchar* iconFShaderTexStr =
-#include "shaders/playbackIcon.frag"
-;
-
-  iconProgramObject = ProgramBuilder::buildProgram(iconVShaderTexStr, iconFShaderTexStr);
+  iconProgramObject = ProgramBuilder::buildProgram(iconVShaderTexStr, iconFShaderTexStr, "playbackIcon");
 
   samplerIconLoc = glGetUniformLocation(iconProgramObject, "s_texture");
   texCoordIconLoc = glGetAttribLocation(iconProgramObject, "a_texCoord");
@@ -98,15 +123,7 @@ void Playback::initialize() {
   opaBloomIconLoc = glGetUniformLocation(iconProgramObject, "u_bloomOpacity");
   rectBloomIconLoc = glGetUniformLocation(iconProgramObject, "u_bloomRect");
 
-  const GLchar* loaderVShaderTexStr =
-#include "shaders/playbackLoader.vert"
-;
-
-  const GLchar* loaderFShaderTexStr =
-#include "shaders/playbackLoader.frag"
-;
-
-  loaderProgramObject = ProgramBuilder::buildProgram(loaderVShaderTexStr, loaderFShaderTexStr);
+  loaderProgramObject = ProgramBuilder::buildProgram(loaderVShaderTexStr, loaderFShaderTexStr, "playbackLoader");
 
   posLoaderLoc = glGetAttribLocation(loaderProgramObject, "a_position");
   paramLoaderLoc = glGetUniformLocation(loaderProgramObject, "u_param");
@@ -114,15 +131,7 @@ void Playback::initialize() {
   viewportLoaderLoc = glGetUniformLocation(loaderProgramObject, "u_viewport");
   sizeLoaderLoc = glGetUniformLocation(loaderProgramObject, "u_size");
 
-  const GLchar* seekVShaderTexStr =
-#include "shaders/framedImage.vert"
-;
-
-  const GLchar* seekFShaderTexStr =
-#include "shaders/framedImage.frag"
-;
-
-  seekProgramObject = ProgramBuilder::buildProgram(seekVShaderTexStr, seekFShaderTexStr);
+  seekProgramObject = ProgramBuilder::buildProgram(seekVShaderTexStr, seekFShaderTexStr, "framedImage");
 
   positionSeekLoc = glGetAttribLocation(seekProgramObject, "a_position");
   texCoordSeekLoc = glGetAttribLocation(seekProgramObject, "a_texCoord");
@@ -149,6 +158,9 @@ void Playback::updateProgress() {
 }
 
 void Playback::render() {
+  if(barProgramObject == GL_INVALID_VALUE)
+    initialize();
+
   std::vector<double> updated = opacityAnimation.update();
   if(!updated.empty())
     opacity = static_cast<float>(updated[0]);
@@ -165,6 +177,35 @@ void Playback::render() {
     renderLoader(opacity);
   else if((state == State::Paused && buffering) || seeking)
     renderLoader(1.0);
+
+  overlayChanged = false;
+  controlsChanged = false;
+}
+
+bool Playback::isLoaderVisible() {
+  return (state == State::Idle && opacity > 0.0) || (state == State::Paused && buffering) || seeking;
+}
+
+int Playback::getControlsHeight() { // icons, progress bar, remaining time and seek preview
+  int height = progressUiLineLevel + iconSize.height;
+  if(seeking || seekPreviewReady) {
+    Size<int> size = getSeekPreviewTileSize();
+    height = max<int>(height, getSeekPreviewPosition(size).y + size.height);
+  }
+  return height + progressBarSize.height;
+}
+
+void Playback::collectDamage(Damage &damage) {
+  if(overlayChanged || opacityAnimation.isActive()) {
+    damage.addFull();
+    return;
+  }
+  if(opacity > 0.0 && (controlsChanged || progressAnimation.isActive() || seeking))
+    damage.add({ 0, 0 }, { Settings::instance().viewport.width, getControlsHeight() });
+  if(controlsChanged || isLoaderVisible()) { // loader is spinning or has just disappeared
+    int squareWidth = 200;
+    damage.add({ (Settings::instance().viewport.width - squareWidth) / 2, (Settings::instance().viewport.height - squareWidth) / 2 }, { squareWidth, squareWidth });
+  }
 }
 
 void Playback::renderIcons() {
@@ -211,42 +252,35 @@ void Playback::renderIcon(Icon icon, Position<int> position, Size<int> size, std
   };
   GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
 
-  glUseProgram(iconProgramObject);
+  GLState::instance().useProgram(iconProgramObject);
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, icons[static_cast<int>(icon)]);
-  glUniform1i(samplerIconLoc, 0);
+  GLState::instance().bindTexture(0, icons[static_cast<int>(icon)]);
+  GLState::instance().uniform1i(samplerIconLoc, 0);
 
   float tex[] = { 0.0f, 0.0f,    0.0f, 1.0f,
                   1.0f, 1.0f,    1.0f, 0.0f };
                        
-  glEnableVertexAttribArray(texCoordIconLoc);
+  GLState::instance().vertexAttribArrays({texCoordIconLoc, posIconLoc});
   glVertexAttribPointer(texCoordIconLoc, 2, GL_FLOAT, GL_FALSE, 0, tex);
 
-  glEnableVertexAttribArray(posIconLoc);
   glVertexAttribPointer(posIconLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
 
   if(color.size() >= 3)
-    glUniform3f(colIconLoc, color[0], color[1], color[2]);
+    GLState::instance().uniform3f(colIconLoc, color[0], color[1], color[2]);
   else
-    glUniform3f(colIconLoc, 1.0f, 1.0f, 1.0f);
-  glUniform1f(opacityIconLoc, static_cast<GLfloat>(opacity));
-  glUniform3f(shadowColIconLoc, 0.0f, 0.0f, 0.0f);
-  glUniform2f(shadowOffIconLoc, -1.0f / size.width, -1.0f / size.height);
+    GLState::instance().uniform3f(colIconLoc, 1.0f, 1.0f, 1.0f);
+  GLState::instance().uniform1f(opacityIconLoc, static_cast<GLfloat>(opacity));
+  GLState::instance().uniform3f(shadowColIconLoc, 0.0f, 0.0f, 0.0f);
+  GLState::instance().uniform2f(shadowOffIconLoc, -1.0f / size.width, -1.0f / size.height);
 
   if(color.size() >= 3)
-    glUniform3f(colBloomIconLoc, color[0], color[1], color[2]);
+    GLState::instance().uniform3f(colBloomIconLoc, color[0], color[1], color[2]);
   else
-    glUniform3f(colBloomIconLoc, 1.0f, 1.0f, 1.0f);
-  glUniform1f(opaBloomIconLoc, bloom ? opacity : 0.0f);
-  glUniform4f(rectBloomIconLoc, position.x, position.y, size.width, size.height);
+    GLState::instance().uniform3f(colBloomIconLoc, 1.0f, 1.0f, 1.0f);
+  GLState::instance().uniform1f(opaBloomIconLoc, bloom ? opacity : 0.0f);
+  GLState::instance().uniform4f(rectBloomIconLoc, position.x, position.y, size.width, size.height);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(texCoordIconLoc);
-  glDisableVertexAttribArray(posIconLoc);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glUseProgram(0);
 }
 
 void Playback::renderText() {
@@ -286,29 +320,18 @@ void Playback::renderProgressBar() {
   };
   GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
 
-  glUseProgram(barProgramObject);
-  glEnableVertexAttribArray(posBarLoc);
+  GLState::instance().useProgram(barProgramObject);
+  GLState::instance().vertexAttribArrays({posBarLoc});
   glVertexAttribPointer(posBarLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
 
-  glUniform1f(paramBarLoc, clamp<float>(progress, 0.0, 1.0));
-  glUniform1f(opacityBarLoc, opacity);
-  glUniform2f(viewportBarLoc, Settings::instance().viewport.width, Settings::instance().viewport.height);
-  glUniform2f(sizeBarLoc, progressBarSize.width, progressBarSize.height);
-  glUniform1f(marginBarLoc, progressBarMarginBottom);
-  glUniform1f(dotScaleBarLoc, dotScale);
+  GLState::instance().uniform1f(paramBarLoc, clamp<float>(progress, 0.0, 1.0));
+  GLState::instance().uniform1f(opacityBarLoc, opacity);
+  GLState::instance().uniform2f(viewportBarLoc, Settings::instance().viewport.width, Settings::instance().viewport.height);
+  GLState::instance().uniform2f(sizeBarLoc, progressBarSize.width, progressBarSize.height);
+  GLState::instance().uniform1f(marginBarLoc, progressBarMarginBottom);
+  GLState::instance().uniform1f(dotScaleBarLoc, dotScale);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(posBarLoc);
-  glUseProgram(0);
-}
-
-void Playback::initTexture(int id) {
-  assertCurrentEGLContext();
-
-  if(id >= static_cast<int>(icons.size()))
-    return;
-  glGenTextures(1, &icons[id]);
 }
 
 void Playback::setIcon(int id, char* pixels, Size<int> size, GLuint format) {
@@ -317,20 +340,9 @@ void Playback::setIcon(int id, char* pixels, Size<int> size, GLuint format) {
   if(id >= static_cast<int>(icons.size()))
    return; 
   if(icons[id] == 0)
-    initTexture(id);
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, icons[id]);
-
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glTexImage2D(GL_TEXTURE_2D, 0, format, size.width, size.height, 0, format, GL_UNSIGNED_BYTE, pixels);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
+    icons[id] = TextureManager::instance().create(TextureManager::Category::Icon, TextureManager::Filter::Mipmap, format, size, pixels);
+  else
+    TextureManager::instance().upload(icons[id], format, size, pixels);
 }
 
 void Playback::update(int show, int state, int currentTime, int totalTime, std::string text, std::chrono::milliseconds animationDuration, std::chrono::milliseconds animationDelay, bool buffering, float bufferingPercent, bool seeking) {
@@ -338,6 +350,7 @@ void Playback::update(int show, int state, int currentTime, int totalTime, std::
   std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
   std::chrono::milliseconds fromLastUpdate = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastUpdate);
   if(static_cast<bool>(show) != enabled) {
+    overlayChanged = true;
     enabled = static_cast<bool>(show);
     opacityAnimation = Animation(animationDuration,
                           animationDelay,
@@ -355,6 +368,11 @@ void Playback::update(int show, int state, int currentTime, int totalTime, std::
                           Animation::Easing::Linear);
   }
 
+  if(text != displayText)
+    overlayChanged = true;
+  if(static_cast<State>(state) != this->state || currentTime != this->currentTime || totalTime != this->totalTime || buffering != this->buffering || seeking != this->seeking)
+    controlsChanged = true;
+
   this->state = static_cast<State>(state);
   this->totalTime = max<int>(0, totalTime);
   this->currentTime = clamp<int>(currentTime, 0, totalTime);
@@ -395,19 +413,16 @@ void Playback::renderLoader(float opacity) {
   };
   GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
 
-  glUseProgram(loaderProgramObject);
-  glEnableVertexAttribArray(posLoaderLoc);
+  GLState::instance().useProgram(loaderProgramObject);
+  GLState::instance().vertexAttribArrays({posLoaderLoc});
   glVertexAttribPointer(posLoaderLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
 
-  glUniform1f(paramLoaderLoc, fmod(static_cast<double>(std::clock()) / CLOCKS_PER_SEC, 1.0));
-  glUniform1f(opacityLoaderLoc, opacity);
-  glUniform2f(viewportLoaderLoc, Settings::instance().viewport.width, Settings::instance().viewport.height);
-  glUniform2f(sizeLoaderLoc, squareWidth, squareWidth);
+  GLState::instance().uniform1f(paramLoaderLoc, fmod(static_cast<double>(std::clock()) / CLOCKS_PER_SEC, 1.0));
+  GLState::instance().uniform1f(opacityLoaderLoc, opacity);
+  GLState::instance().uniform2f(viewportLoaderLoc, Settings::instance().viewport.width, Settings::instance().viewport.height);
+  GLState::instance().uniform2f(sizeLoaderLoc, squareWidth, squareWidth);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(posLoaderLoc);
-  glUseProgram(0);
 }
 
 void Playback::selectAction(int id) {
@@ -417,17 +432,24 @@ void Playback::selectAction(int id) {
 void Playback::updateSeekPreviewTexture() {
   assertCurrentEGLContext();
 
+  if(seekStoryboard.isValid()) {
+    updateSeekPreviewStoryboard();
+    return;
+  }
+
   StoryboardExternData storyboardData = getStoryboardData();
   displaySeekPreview = storyboardData.isStoryboardValid;
 
-  if(!storyboardData.isStoryboardValid || !storyboardData.isFrameReady)
+  if(!storyboardData.isStoryboardValid || !storyboardData.isFrameReady) { // keep showing last frame, if its sheet is still cached
+    seekTextureId = seekPreviewReady ? StoryboardCache::instance().findTexture(storyboardBitmapHash) : 0;
     return;
-
-  if(storyboardData.frame.bitmapHash != storyboardBitmapHash) { // new storyboard
-    storyboardBitmap = storyboardData.frame;
-    setPreviewTexture(storyboardData.frame);
-    storyboardBitmapHash = storyboardData.frame.bitmapHash;
   }
+
+  seekTextureId = StoryboardCache::instance().getTexture(storyboardData.frame);
+  if(seekTextureId == 0)
+    return;
+  storyboardBitmap = storyboardData.frame;
+  storyboardBitmapHash = storyboardData.frame.bitmapHash;
   storytileRect = Rect { // update frame rectangle metadata
     .left = storyboardData.frame.rectLeft,
     .right = storyboardData.frame.rectRight,
@@ -437,6 +459,25 @@ void Playback::updateSeekPreviewTexture() {
   seekPreviewReady = true;
 }
 
+void Playback::updateSeekPreviewStoryboard() {
+  displaySeekPreview = true;
+
+  int frame = seekStoryboard.getFrameAt(std::chrono::milliseconds(currentTime));
+  Storyboard::Frame shown;
+  if(seekStoryboard.getFrame(frame, shown))
+    seekStoryboardFrame = frame;
+  else if(!seekPreviewReady || !seekStoryboard.getFrame(seekStoryboardFrame, shown, false)) { // sheet is requested, keep last frame meanwhile
+    seekTextureId = 0;
+    return;
+  }
+
+  seekTextureId = shown.textureId;
+  storyboardBitmap.bitmapWidth = shown.sheetSize.width;
+  storyboardBitmap.bitmapHeight = shown.sheetSize.height;
+  storytileRect = shown.rect;
+  seekPreviewReady = true;
+}
+
 Position<int> Playback::getSeekPreviewPosition(Size<int> size) {
   int dotCenterRange = progressBarSize.width - progressBarSize.height * dotScale; // substract radius of dot on both ends
   int leftOffset = (Settings::instance().viewport.width - dotCenterRange) / 2;
@@ -494,55 +535,27 @@ void Playback::renderSeekPreview() {
   float texCoord[] = { 0.0f, 0.0f,    0.0f, 1.0f,
                        1.0f, 1.0f,    1.0f, 0.0f };
 
-  glUseProgram(seekProgramObject);
+  GLState::instance().useProgram(seekProgramObject);
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, seekTextureId);
-  glUniform1i(samplerSeekLoc, 0);
+  GLState::instance().bindTexture(0, seekTextureId);
+  GLState::instance().uniform1i(samplerSeekLoc, 0);
 
-  glEnableVertexAttribArray(positionSeekLoc);
+  GLState::instance().vertexAttribArrays({positionSeekLoc, texCoordSeekLoc});
   glVertexAttribPointer(positionSeekLoc, 3, GL_FLOAT, GL_FALSE, 0, vVertices);
-  glEnableVertexAttribArray(texCoordSeekLoc);
   glVertexAttribPointer(texCoordSeekLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
 
-  glUniform2f(imagePositionSeekLoc, static_cast<float>(position.x), static_cast<float>(position.y));
-  glUniform2f(imageSizeSeekLoc, static_cast<float>(size.width), static_cast<float>(size.height));
-  glUniform2f(viewportSeekLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
-  glUniform1f(opacitySeekLoc, static_cast<GLfloat>(opacity));
-  glUniform1f(scaleSeekLoc, 1.0f);
+  GLState::instance().uniform2f(imagePositionSeekLoc, static_cast<float>(position.x), static_cast<float>(position.y));
+  GLState::instance().uniform2f(imageSizeSeekLoc, static_cast<float>(size.width), static_cast<float>(size.height));
+  GLState::instance().uniform2f(viewportSeekLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
+  GLState::instance().uniform1f(opacitySeekLoc, static_cast<GLfloat>(opacity));
+  GLState::instance().uniform1f(scaleSeekLoc, 1.0f);
 
   if(storytileRect.width() != 0 && storytileRect.height() != 0)
-    glUniform4f(storytileRectSeekLoc, storytileRect.left / storyboardBitmap.bitmapWidth, storytileRect.top / storyboardBitmap.bitmapHeight, storytileRect.width() / storyboardBitmap.bitmapWidth, storytileRect.height() / storyboardBitmap.bitmapHeight);
+    GLState::instance().uniform4f(storytileRectSeekLoc, storytileRect.left / storyboardBitmap.bitmapWidth, storytileRect.top / storyboardBitmap.bitmapHeight, storytileRect.width() / storyboardBitmap.bitmapWidth, storytileRect.height() / storyboardBitmap.bitmapHeight);
   else
-    glUniform4f(storytileRectSeekLoc, 0.0f, 0.0f, 1.0f, 1.0f);
+    GLState::instance().uniform4f(storytileRectSeekLoc, 0.0f, 0.0f, 1.0f, 1.0f);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-  glDisableVertexAttribArray(positionSeekLoc);
-  glDisableVertexAttribArray(texCoordSeekLoc);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glUseProgram(0);
-}
-
-void Playback::setPreviewTexture(SubBitmapExtern frame) {
-  assertCurrentEGLContext();
-
-  if(seekTextureId == 0)
-    initTextures();
-
-  GLuint textureFormat = ConvertFormat(frame.bitmapInfoColorType);
-
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, seekTextureId);
-  glTexImage2D(GL_TEXTURE_2D, 0, textureFormat, frame.bitmapWidth, frame.bitmapHeight, 0, textureFormat, GL_UNSIGNED_BYTE, frame.bitmapBytes);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 StoryboardExternData Playback::getStoryboardData() {
@@ -555,10 +568,11 @@ void Playback::setStoryboardCallback(StoryboardExternData (*getSeekPreviewStoryb
   this->getStoryboardDataCallback = getSeekPreviewStoryboardDataCallback;
 }
 
-void Playback::initTextures() {
-  if(seekTextureId == 0)
-    glGenTextures(1, &seekTextureId);
-  if(seekTextureId == 0)
-    throw("-----===== INVALID VALUES FOR TILE TEXTURES! =====-----");
+void Playback::setStoryboard(Storyboard storyboard) {
+  seekStoryboard.releaseSheets();
+  seekStoryboard = storyboard;
+  seekStoryboardFrame = 0;
+  seekPreviewReady = false;
+  seekTextureId = 0;
 }
 
@@ -0,0 +1,166 @@
+#include "ProcessSampler.h"
+#include "GLState.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+
+ProcessSampler::ProcessSampler()
+  : stopRequested(false),
+    intervalMs(1000),
+    sequence(0),
+    cpuPercent(0.0f),
+    rssMB(0.0f),
+    threads(0.0f),
+    gpuMB(0.0f),
+    lastProcessTicks(0),
+    lastTotalTicks(0),
+    pageSize(sysconf(_SC_PAGESIZE)) {
+}
+
+ProcessSampler::~ProcessSampler() {
+  stop();
+}
+
+void ProcessSampler::start(int intervalMs) {
+  this->intervalMs.store(std::max(intervalMs, MIN_INTERVAL_MS));
+  if(thread.joinable()) {
+    wakeUp.notify_one();
+    return;
+  }
+  stopRequested = false;
+  lastProcessTicks = 0;
+  lastTotalTicks = 0;
+  thread = std::thread(&ProcessSampler::run, this);
+}
+
+void ProcessSampler::stop() {
+  if(!thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  wakeUp.notify_one();
+  thread.join();
+}
+
+void ProcessSampler::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(!stopRequested) {
+    lock.unlock();
+    sample();
+    lock.lock();
+    wakeUp.wait_for(lock, std::chrono::milliseconds(intervalMs.load()), [this] { return stopRequested; });
+  }
+}
+
+void ProcessSampler::sample() {
+  unsigned long long processTicks = 0;
+  unsigned long long totalTicks = 0;
+  int threadCount = 0;
+  long residentPages = 0;
+  bool cpuValid = readProcessStat(processTicks, threadCount) && readTotalTicks(totalTicks);
+  bool rssValid = readResidentPages(residentPages);
+
+  float cpu = cpuPercent.load(std::memory_order_relaxed);
+  if(cpuValid && lastTotalTicks != 0 && totalTicks > lastTotalTicks)
+    cpu = 100.0f * static_cast<float>(processTicks - lastProcessTicks) / static_cast<float>(totalTicks - lastTotalTicks);
+  if(cpuValid) {
+    lastProcessTicks = processTicks;
+    lastTotalTicks = totalTicks;
+  }
+
+  unsigned int current = sequence.load(std::memory_order_relaxed);
+  sequence.store(current + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  cpuPercent.store(cpu, std::memory_order_relaxed);
+  if(rssValid)
+    rssMB.store(static_cast<float>(residentPages) * pageSize / (1024.0f * 1024.0f), std::memory_order_relaxed);
+  if(cpuValid)
+    threads.store(static_cast<float>(threadCount), std::memory_order_relaxed);
+  gpuMB.store(static_cast<float>(GLState::instance().getTextureBytes()) / (1024.0f * 1024.0f), std::memory_order_relaxed);
+  sequence.store(current + 2, std::memory_order_release);
+}
+
+bool ProcessSampler::getSample(unsigned int &lastSequence, Sample &sample) {
+  unsigned int before = sequence.load(std::memory_order_acquire);
+  if(before == lastSequence || (before & 1) != 0)
+    return false;
+  sample = { cpuPercent.load(std::memory_order_relaxed),
+             rssMB.load(std::memory_order_relaxed),
+             threads.load(std::memory_order_relaxed),
+             gpuMB.load(std::memory_order_relaxed) };
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(sequence.load(std::memory_order_relaxed) != before)
+    return false; // sample was overwritten while reading, next call will get the new one
+  lastSequence = before;
+  return true;
+}
+
+bool ProcessSampler::readProcessStat(unsigned long long &ticks, int &threadCount) {
+  std::ifstream file("/proc/self/stat");
+  std::string line;
+  if(!std::getline(file, line))
+    return false;
+  // process name in parentheses may contain spaces, fields are counted from the last ')'
+  size_t nameEnd = line.rfind(')');
+  if(nameEnd == std::string::npos)
+    return false;
+  std::istringstream fields(line.substr(nameEnd + 1));
+  std::vector<std::string> values;
+  std::string value;
+  while(fields >> value && values.size() < 18)
+    values.push_back(value);
+  if(values.size() < 18)
+    return false;
+  // fields 14 (utime), 15 (stime) and 20 (num_threads) of proc(5), first one after name is field 3
+  unsigned long long utime = 0, stime = 0;
+  long threads = 0;
+  if(!parseNumber(values[11], utime) || !parseNumber(values[12], stime) || !parseNumber(values[17], threads))
+    return false; // std::stoull would throw on the sampler thread, sample is skipped instead
+  ticks = utime + stime;
+  threadCount = static_cast<int>(threads);
+  return true;
+}
+
+bool ProcessSampler::parseNumber(const std::string &text, unsigned long long &value) {
+  char *end = nullptr;
+  errno = 0;
+  value = std::strtoull(text.c_str(), &end, 10);
+  return errno == 0 && end != text.c_str() && *end == '\0';
+}
+
+bool ProcessSampler::parseNumber(const std::string &text, long &value) {
+  char *end = nullptr;
+  errno = 0;
+  value = std::strtol(text.c_str(), &end, 10);
+  return errno == 0 && end != text.c_str() && *end == '\0';
+}
+
+bool ProcessSampler::readTotalTicks(unsigned long long &ticks) {
+  std::ifstream file("/proc/stat");
+  std::string cpu;
+  if(!(file >> cpu) || cpu != "cpu")
+    return false;
+  // user, nice, system, idle, iowait, irq, softirq, steal; guest time is already included in user
+  ticks = 0;
+  for(int i = 0; i < 8; ++i) {
+    unsigned long long value = 0;
+    if(!(file >> value))
+      break;
+    ticks += value;
+  }
+  return ticks > 0;
+}
+
+bool ProcessSampler::readResidentPages(long &pages) {
+  std::ifstream file("/proc/self/statm");
+  long size = 0;
+  return static_cast<bool>(file >> size >> pages);
+}
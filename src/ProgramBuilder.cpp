@@ -1,14 +1,69 @@
 #include "ProgramBuilder.h"
+#include "ProgramCache.h"
+#include "StartupReport.h"
 #include "LogConsole.h"
 #include "Utility.h"
 
 #include <vector>
 #include <string>
+#include <algorithm>
 
-GLuint ProgramBuilder::buildProgram(const GLchar* vshader, const GLchar* fshader) {
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+std::vector<ProgramBuilder::PrefetchedProgram> ProgramBuilder::prefetched;
+int ProgramBuilder::parallelCompile = -1;
+
+GLuint ProgramBuilder::buildProgram(const GLchar* vshader, const GLchar* fshader, const std::string &name) {
   assertCurrentEGLContext();
 
+  std::vector<PrefetchedProgram>::iterator it = std::find_if(prefetched.begin(), prefetched.end(), [&](const PrefetchedProgram &p) {
+    return p.vshader == vshader && p.fshader == fshader;
+  });
+  if(it == prefetched.end() || it->program == GL_INVALID_VALUE) {
+    if(it != prefetched.end())
+      prefetched.erase(it);
+    return build(vshader, fshader, name);
+  }
+
+  PrefetchedProgram prefetchedProgram = *it;
+  prefetched.erase(it);
+  std::chrono::time_point<std::chrono::steady_clock> waitStart = std::chrono::steady_clock::now();
+  bool linked = checkProgram(prefetchedProgram.program); // waits for background compilation if it's still running
+  if(!prefetchedProgram.ready)
+    StartupReport::instance().addProgram(prefetchedProgram.name, "parallel",
+                                         StartupReport::instance().getElapsedMs(waitStart),
+                                         StartupReport::instance().getElapsedMs(prefetchedProgram.start));
+  if(!linked) {
+    if(prefetchedProgram.vertexShader)
+      checkShader(prefetchedProgram.vertexShader);
+    if(prefetchedProgram.fragmentShader)
+      checkShader(prefetchedProgram.fragmentShader);
+  }
+  if(prefetchedProgram.vertexShader)
+    glDeleteShader(prefetchedProgram.vertexShader);
+  if(prefetchedProgram.fragmentShader)
+    glDeleteShader(prefetchedProgram.fragmentShader);
+  if(!linked) {
+    glDeleteProgram(prefetchedProgram.program);
+    return GL_INVALID_VALUE;
+  }
+  if(!prefetchedProgram.cached)
+    ProgramCache::instance().store(prefetchedProgram.program, vshader, fshader);
+  return prefetchedProgram.program;
+}
+
+GLuint ProgramBuilder::build(const GLchar* vshader, const GLchar* fshader, const std::string &name) {
+  std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+  GLuint cachedProgram = ProgramCache::instance().load(vshader, fshader);
+  if(cachedProgram != GL_INVALID_VALUE) {
+    StartupReport::instance().addProgram(name, "cache", 0.0, StartupReport::instance().getElapsedMs(start));
+    return cachedProgram;
+  }
+
   // compile shaders
+  start = std::chrono::steady_clock::now();
   GLuint vertexShader = loadShader(GL_VERTEX_SHADER, vshader);
   GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, fshader);
   if(fragmentShader == GL_INVALID_VALUE || vertexShader == GL_INVALID_VALUE) {
@@ -18,51 +73,162 @@ GLuint ProgramBuilder::buildProgram(const GLchar* vshader, const GLchar* fshader
       glDeleteShader(vertexShader);
     return GL_INVALID_VALUE;
   }
+  double compileMs = StartupReport::instance().getElapsedMs(start);
 
   // link program
+  start = std::chrono::steady_clock::now();
   GLuint program = glCreateProgram();
   glAttachShader(program, vertexShader);
   glAttachShader(program, fragmentShader);
   glLinkProgram(program);
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
+  if(!checkProgram(program)) {
+    glDeleteProgram(program);
+    return GL_INVALID_VALUE;
+  }
+  StartupReport::instance().addProgram(name, "compiled", compileMs, StartupReport::instance().getElapsedMs(start));
+  ProgramCache::instance().store(program, vshader, fshader);
+  return program;
+}
+
+void ProgramBuilder::prefetchProgram(const std::string &name, const GLchar* vshader, const GLchar* fshader) {
+  for(const PrefetchedProgram &p : prefetched)
+    if(p.vshader == vshader && p.fshader == fshader)
+      return;
+  prefetched.push_back({name, vshader, fshader, GL_INVALID_VALUE, 0, 0, false, false, false, std::chrono::steady_clock::now()});
+}
+
+bool ProgramBuilder::compilePrefetched() {
+  assertCurrentEGLContext();
+
+  if(!isParallelCompileSupported()) { // compile one program per call, so loader frames are still coming
+    for(PrefetchedProgram &p : prefetched) {
+      if(p.started)
+        continue;
+      p.started = true;
+      p.program = build(p.vshader, p.fshader, p.name);
+      p.cached = true;
+      p.ready = true;
+      break;
+    }
+    return std::all_of(prefetched.begin(), prefetched.end(), [](const PrefetchedProgram &p) { return p.started; });
+  }
+
+  bool allReady = true;
+  for(PrefetchedProgram &p : prefetched) {
+    if(!p.started)
+      startCompilation(p);
+    if(!p.ready) {
+      GLint completed = GL_FALSE;
+      glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &completed);
+      if(completed == GL_TRUE) {
+        p.ready = true;
+        StartupReport::instance().addProgram(p.name, "parallel", 0.0, StartupReport::instance().getElapsedMs(p.start));
+      }
+    }
+    allReady = allReady && p.ready;
+  }
+  return allReady;
+}
+
+bool ProgramBuilder::isCompilationPending() {
+  return std::any_of(prefetched.begin(), prefetched.end(), [](const PrefetchedProgram &p) { return !p.started || !p.ready; });
+}
+
+void ProgramBuilder::startCompilation(PrefetchedProgram &p) {
+  p.started = true;
+  p.start = std::chrono::steady_clock::now();
+  p.program = ProgramCache::instance().load(p.vshader, p.fshader);
+  if(p.program != GL_INVALID_VALUE) {
+    p.cached = true;
+    p.ready = true;
+    StartupReport::instance().addProgram(p.name, "cache", 0.0, StartupReport::instance().getElapsedMs(p.start));
+    return;
+  }
+
+  // none of these calls waits for the compiler, results are checked when the program is needed
+  p.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(p.vertexShader, 1, &p.vshader, NULL);
+  glCompileShader(p.vertexShader);
+  p.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(p.fragmentShader, 1, &p.fshader, NULL);
+  glCompileShader(p.fragmentShader);
+  p.program = glCreateProgram();
+  glAttachShader(p.program, p.vertexShader);
+  glAttachShader(p.program, p.fragmentShader);
+  glLinkProgram(p.program);
+}
+
+void ProgramBuilder::deletePrefetched() {
+  assertCurrentEGLContext();
+
+  for(PrefetchedProgram &p : prefetched) {
+    if(p.program != GL_INVALID_VALUE)
+      glDeleteProgram(p.program);
+    if(p.vertexShader)
+      glDeleteShader(p.vertexShader);
+    if(p.fragmentShader)
+      glDeleteShader(p.fragmentShader);
+  }
+  prefetched.clear();
+  parallelCompile = -1;
+}
+
+bool ProgramBuilder::isParallelCompileSupported() {
+  if(parallelCompile < 0) {
+    parallelCompile = Utility::hasGLExtension("GL_KHR_parallel_shader_compile") ? 1 : 0;
+    void (*glMaxShaderCompilerThreadsKHRFunc)(GLuint) = nullptr;
+    if(parallelCompile)
+      *(void **) (&glMaxShaderCompilerThreadsKHRFunc) = Utility::getProcAddress("glMaxShaderCompilerThreadsKHR");
+    if(glMaxShaderCompilerThreadsKHRFunc != nullptr)
+      glMaxShaderCompilerThreadsKHRFunc(0xFFFFFFFF); // let the driver decide
+  }
+  return parallelCompile == 1;
+}
+
+bool ProgramBuilder::checkProgram(GLuint program) {
   GLint isLinked = 0;
   glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
   if(isLinked == GL_FALSE) {
     GLint maxLength = 0;
     glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
 
-    std::vector<GLchar> infoLog(maxLength);
+    std::vector<GLchar> infoLog(maxLength + 1);
     glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
-    glDeleteProgram(program);
 
-    LogConsole::instance().log(std::string(infoLog.begin(), infoLog.end()).c_str(), LogConsole::LogLevel::Error);
-    return GL_INVALID_VALUE;
+    LogConsole::instance().log(std::string(infoLog.begin(), infoLog.begin() + maxLength).c_str(), LogConsole::LogLevel::Error);
+    return false;
   }
-  return program;
+  return true;
 }
 
-GLuint ProgramBuilder::loadShader(const GLenum type, const GLchar* source) {
-  assertCurrentEGLContext();
-
-  GLuint shader = glCreateShader(type);
-  glShaderSource(shader, 1, &source, NULL);
-  glCompileShader(shader);
-
+bool ProgramBuilder::checkShader(GLuint shader) {
   GLint isCompiled = 0;
   glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
   if(isCompiled == GL_FALSE) {
     GLint maxLength = 0;
     glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
 
-    std::vector<GLchar> infoLog(maxLength);
+    std::vector<GLchar> infoLog(maxLength + 1);
     glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
-    glDeleteShader(shader);
 
-    LogConsole::instance().log(std::string(infoLog.begin(), infoLog.end()).c_str(), LogConsole::LogLevel::Error);
-    return GL_INVALID_VALUE;
+    LogConsole::instance().log(std::string(infoLog.begin(), infoLog.begin() + maxLength).c_str(), LogConsole::LogLevel::Error);
+    return false;
   }
-  return shader;
+  return true;
 }
 
+GLuint ProgramBuilder::loadShader(const GLenum type, const GLchar* source) {
+  assertCurrentEGLContext();
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
 
+  if(!checkShader(shader)) {
+    glDeleteShader(shader);
+    return GL_INVALID_VALUE;
+  }
+  return shader;
+}
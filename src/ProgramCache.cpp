@@ -0,0 +1,137 @@
+#include "ProgramCache.h"
+#include "LogConsole.h"
+#include "Utility.h"
+
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x42504c47; // "GLPB"
+const uint32_t CACHE_VERSION = 1;
+
+uint64_t hashString(uint64_t hash, const char *text) { // includes terminating '\0' as a separator
+  return Utility::fnv1a(hash, text, std::strlen(text) + 1);
+}
+
+} // namespace
+
+ProgramCache::ProgramCache()
+  : initialized(false),
+    supported(false),
+    glGetProgramBinaryOESFunc(nullptr),
+    glProgramBinaryOESFunc(nullptr),
+    hits(0),
+    misses(0) {
+}
+
+void ProgramCache::setDirectory(const std::string &directory) {
+  this->directory = directory;
+  initialized = false;
+}
+
+void ProgramCache::initialize() {
+  assertCurrentEGLContext();
+
+  initialized = true;
+  supported = false;
+  if(directory.empty() || !Utility::hasGLExtension("GL_OES_get_program_binary"))
+    return;
+
+  GLint formatsCount = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formatsCount);
+  *(void **) (&glGetProgramBinaryOESFunc) = Utility::getProcAddress("glGetProgramBinaryOES");
+  *(void **) (&glProgramBinaryOESFunc) = Utility::getProcAddress("glProgramBinaryOES");
+  if(formatsCount <= 0 || glGetProgramBinaryOESFunc == nullptr || glProgramBinaryOESFunc == nullptr)
+    return;
+
+  const char *renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  const char *version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  driverId = std::string(renderer ? renderer : "") + "|" + (version ? version : "");
+  supported = true;
+}
+
+uint64_t ProgramCache::getKey(const GLchar* vshader, const GLchar* fshader) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hash = hashString(hash, vshader);
+  hash = hashString(hash, fshader);
+  return hashString(hash, driverId.c_str());
+}
+
+std::string ProgramCache::getPath(uint64_t key) {
+  std::ostringstream oss;
+  oss << directory << "/program_" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+  return oss.str();
+}
+
+GLuint ProgramCache::load(const GLchar* vshader, const GLchar* fshader) {
+  if(!initialized)
+    initialize();
+  if(!supported)
+    return GL_INVALID_VALUE;
+
+  uint64_t key = getKey(vshader, fshader);
+  std::string path = getPath(key);
+  std::ifstream file(path, std::ios::binary);
+  Header header;
+  if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key || header.length == 0) {
+    ++misses;
+    return GL_INVALID_VALUE;
+  }
+  std::vector<char> binary(header.length);
+  if(!file.read(binary.data(), binary.size())) {
+    ++misses;
+    return GL_INVALID_VALUE;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinaryOESFunc(program, header.binaryFormat, binary.data(), header.length);
+  GLint isLinked = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+  if(isLinked == GL_FALSE) { // rejected by driver (e.g. after driver update), program will be compiled and stored again
+    glDeleteProgram(program);
+    std::remove(path.c_str());
+    ++misses;
+    return GL_INVALID_VALUE;
+  }
+  ++hits;
+  return program;
+}
+
+void ProgramCache::store(GLuint program, const GLchar* vshader, const GLchar* fshader) {
+  if(!initialized)
+    initialize();
+  if(!supported || program == GL_INVALID_VALUE)
+    return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+  if(length <= 0)
+    return;
+  std::vector<char> binary(length);
+  GLenum binaryFormat = 0;
+  glGetProgramBinaryOESFunc(program, length, &length, &binaryFormat, binary.data());
+  if(length <= 0)
+    return;
+
+  uint64_t key = getKey(vshader, fshader);
+  Header header = { CACHE_MAGIC, CACHE_VERSION, key, binaryFormat, static_cast<uint32_t>(length) };
+  std::string path = getPath(key);
+  std::string tmpPath = path + ".tmp"; // written aside and renamed, so a crash never leaves truncated binary
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if(!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), length)) {
+      LogConsole::instance().log("Cannot write program binary to " + tmpPath, LogConsole::LogLevel::Error);
+      file.close();
+      std::remove(tmpPath.c_str());
+      return;
+    }
+  }
+  if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    std::remove(tmpPath.c_str());
+}
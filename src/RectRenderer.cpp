@@ -0,0 +1,117 @@
+#include "RectRenderer.h"
+#include "GLState.h"
+#include "ProgramBuilder.h"
+#include "Settings.h"
+#include "LogConsole.h"
+#include "Utility.h"
+
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/rect.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/rect.frag"
+;
+
+} // namespace
+
+RectRenderer::RectRenderer()
+    : batchTextureId(0) {
+  ProgramBuilder::prefetchProgram("rect", vShaderTexStr, fShaderTexStr);
+  vertices.reserve(16 * 4 * VERTEX_SIZE);
+  indices.reserve(16 * 6);
+}
+
+RectRenderer::~RectRenderer() {
+  assertCurrentEGLContext();
+
+  if(programObject != GL_INVALID_VALUE)
+    GLState::instance().deleteProgram(programObject);
+}
+
+void RectRenderer::initialize() {
+  assertCurrentEGLContext();
+
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "rect");
+
+  posLoc        = glGetAttribLocation(programObject, "a_position");
+  rectLoc       = glGetAttribLocation(programObject, "a_rect");
+  fillColorLoc  = glGetAttribLocation(programObject, "a_fillColor");
+  frameColorLoc = glGetAttribLocation(programObject, "a_frameColor");
+  styleLoc      = glGetAttribLocation(programObject, "a_style");
+  texLoc        = glGetAttribLocation(programObject, "a_texCoord");
+  samplerLoc    = glGetUniformLocation(programObject, "s_texture");
+  viewportLoc   = glGetUniformLocation(programObject, "u_viewport");
+}
+
+void RectRenderer::add(Position<float> position, Size<float> size, const std::vector<float> &fillColor,
+                       float frameWidth, const std::vector<float> &frameColor, float radius, GLuint textureId,
+                       const std::vector<float> &textureRect) {
+  if(fillColor.size() < 4 || frameColor.size() < 4 || textureRect.size() < 4) {
+    LogConsole::instance().log("RectRenderer: colors and texture rectangle must have 4 components", LogConsole::LogLevel::Error);
+    return;
+  }
+  if(fillColor[3] < 0.001f && (frameWidth <= 0.0f || frameColor[3] < 0.001f)) // nothing visible to draw
+    return;
+
+  // one batch samples one texture, untextured rectangles can join any batch
+  if(textureId != 0 && batchTextureId != 0 && textureId != batchTextureId)
+    flush();
+  if(indices.size() / 6 >= MAX_RECTS)
+    flush();
+  if(textureId != 0)
+    batchTextureId = textureId;
+
+  float left = position.x;
+  float right = position.x + size.width;
+  float down = position.y;
+  float top = position.y + size.height;
+  const GLfloat corners[4][4] = { { left,  top,  textureRect[0], textureRect[1] },
+                                  { left,  down, textureRect[0], textureRect[3] },
+                                  { right, down, textureRect[2], textureRect[3] },
+                                  { right, top,  textureRect[2], textureRect[1] } };
+
+  GLushort base = static_cast<GLushort>(vertices.size() / VERTEX_SIZE);
+  for(const auto &corner : corners) {
+    vertices.insert(vertices.end(), { corner[0], corner[1],
+                                      position.x, position.y, size.width, size.height,
+                                      fillColor[0], fillColor[1], fillColor[2], fillColor[3],
+                                      frameColor[0], frameColor[1], frameColor[2], frameColor[3],
+                                      frameWidth, radius, textureId != 0 ? 1.0f : 0.0f, 0.0f,
+                                      corner[2], corner[3] });
+  }
+  indices.insert(indices.end(), { base, static_cast<GLushort>(base + 1), static_cast<GLushort>(base + 2),
+                                  base, static_cast<GLushort>(base + 2), static_cast<GLushort>(base + 3) });
+}
+
+void RectRenderer::flush() {
+  assertCurrentEGLContext();
+
+  if(indices.empty())
+    return;
+  if(programObject == GL_INVALID_VALUE)
+    initialize();
+
+  const GLsizei stride = VERTEX_SIZE * sizeof(GLfloat);
+  GLState::instance().useProgram(programObject);
+
+  GLState::instance().bindTexture(0, batchTextureId);
+  GLState::instance().uniform1i(samplerLoc, 0);
+  GLState::instance().uniform2f(viewportLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
+
+  GLState::instance().vertexAttribArrays({posLoc, rectLoc, fillColorLoc, frameColorLoc, styleLoc, texLoc});
+  glVertexAttribPointer(posLoc, 2, GL_FLOAT, GL_FALSE, stride, vertices.data());
+  glVertexAttribPointer(rectLoc, 4, GL_FLOAT, GL_FALSE, stride, vertices.data() + 2);
+  glVertexAttribPointer(fillColorLoc, 4, GL_FLOAT, GL_FALSE, stride, vertices.data() + 6);
+  glVertexAttribPointer(frameColorLoc, 4, GL_FLOAT, GL_FALSE, stride, vertices.data() + 10);
+  glVertexAttribPointer(styleLoc, 4, GL_FLOAT, GL_FALSE, stride, vertices.data() + 14);
+  glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, stride, vertices.data() + 18);
+
+  glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT, indices.data());
+
+  vertices.clear();
+  indices.clear();
+  batchTextureId = 0;
+}
@@ -1,5 +1,7 @@
 #include "Settings.h"
 
+#include <cmath>
+
 Settings::Settings()
   : viewport (Size<int>( 1920, 1080 )),
     tileSize (Size<int>( 400, 400 * viewport.height / viewport.width )),
@@ -19,5 +21,18 @@ Settings::Settings()
     tilePreviewTimeScale (10.0f / 3.0f),
     loaderUpdateAnimationDuration (std::chrono::milliseconds(500)),
     loaderUpdateAnimationDelay (std::chrono::duration_values<std::chrono::milliseconds>::zero()),
-    seekPreviewTileWidth(300) {
+    seekPreviewTileWidth(300),
+    frameBudget(std::chrono::microseconds(16667)),
+    storyboardCacheBytes(64 * 1024 * 1024),
+    textureBudgetBytes(192 * 1024 * 1024),
+    texturePoolSize(8),
+    cpuMipmaps(true),
+    expandRgbUploads(false),
+    textureCompression(-1),
+    tileImageMaxSize(Size<int>(static_cast<int>(std::ceil(tileSize.width * zoom)), static_cast<int>(std::ceil(tileSize.height * zoom)))),
+    backgroundImageMaxSize(viewport),
+    backgroundImageBudgetBytes(32 * 1024 * 1024),
+    textureCacheBytes(64 * 1024 * 1024),
+    deferredWorkBudget(std::chrono::microseconds(10000)),
+    deferredWorkMaxDelay(std::chrono::milliseconds(100)) {
 }
@@ -0,0 +1,51 @@
+#include "StartupReport.h"
+
+#include <sstream>
+#include <iomanip>
+
+StartupReport::StartupReport()
+  : startTime(std::chrono::steady_clock::now()) {
+}
+
+void StartupReport::start() {
+  startTime = std::chrono::steady_clock::now();
+  events.clear();
+  programs.clear();
+}
+
+double StartupReport::getElapsedMs(std::chrono::time_point<std::chrono::steady_clock> since) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::steady_clock::now() - since).count();
+}
+
+void StartupReport::addEvent(const std::string &name) {
+  events.push_back({name, getElapsedMs(startTime)});
+}
+
+void StartupReport::addProgram(const std::string &name, const std::string &origin, double compileMs, double linkMs) {
+  programs.push_back({name.empty() ? "unnamed" : name, origin, getElapsedMs(startTime), compileMs, linkMs});
+}
+
+std::string StartupReport::toString() {
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1);
+  for(const Event &event : events)
+    oss << event.name << ": " << event.time << " ms\n";
+  double blocking = 0.0;
+  for(const ProgramBuild &program : programs) {
+    oss << "program " << program.name << " (" << program.origin << "): ready at " << program.time << " ms";
+    if(program.origin == "parallel") {
+      oss << ", " << program.linkMs << " ms after start of compilation, waited " << program.compileMs << " ms\n";
+      blocking += program.compileMs;
+    }
+    else if(program.origin == "cache") {
+      oss << ", loaded in " << program.linkMs << " ms\n";
+      blocking += program.linkMs;
+    }
+    else {
+      oss << ", compile " << program.compileMs << " ms, link " << program.linkMs << " ms\n";
+      blocking += program.compileMs + program.linkMs;
+    }
+  }
+  oss << "programs: " << programs.size() << ", blocking " << blocking << " ms\n";
+  return oss.str();
+}
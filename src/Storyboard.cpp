@@ -0,0 +1,99 @@
+#include "Storyboard.h"
+#include "ImageResampler.h"
+#include "LogConsole.h"
+#include "Settings.h"
+#include "WorkScheduler.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+StoryboardCache::Key Storyboard::nextKey = static_cast<StoryboardCache::Key>(1) << 32; // above any bitmapHash
+
+Storyboard::Storyboard()
+  : id(-1),
+    layout({0, 1, 1, 0, std::chrono::milliseconds(0), std::chrono::milliseconds(0), nullptr}),
+    firstKey(0) {
+}
+
+Storyboard::Storyboard(int id, Layout layout)
+  : id(id),
+    layout(layout),
+    firstKey(nextKey),
+    sheetSizes(std::max(layout.sheetCount, 0), Size<int>{0, 0}),
+    requested(std::max(layout.sheetCount, 0), false) {
+  if(layout.sheetCount <= 0 || layout.columns <= 0 || layout.rows <= 0 || layout.frameCount <= 0 ||
+     layout.frameCount > layout.sheetCount * layout.columns * layout.rows) {
+    if(layout.sheetCount > 0)
+      LogConsole::instance().log("Invalid storyboard layout for " + std::to_string(id), LogConsole::LogLevel::Error);
+    this->layout.frameCount = 0; // not valid
+    return;
+  }
+  nextKey += layout.sheetCount;
+}
+
+int Storyboard::getFrameAt(std::chrono::milliseconds position) {
+  if(layout.frameInterval <= std::chrono::milliseconds(0))
+    return 0;
+  return std::min(std::max(0, static_cast<int>(position / layout.frameInterval)), layout.frameCount - 1);
+}
+
+int Storyboard::getPreviewFrameAt(std::chrono::milliseconds elapsed) {
+  if(layout.previewFrameDuration <= std::chrono::milliseconds(0))
+    return layout.frameCount;
+  return std::max(0, static_cast<int>(elapsed / layout.previewFrameDuration));
+}
+
+void Storyboard::setSheet(int sheetIndex, const ImageData &image) {
+  if(!isValid() || sheetIndex < 0 || sheetIndex >= layout.sheetCount)
+    return;
+
+  // frames are shown at most at zoomed tile size, the seek preview is smaller
+  Size<int> maxFrameSize = Settings::instance().tileImageMaxSize;
+  Size<int> size = ImageResampler::getIngestSize(image.size, Size<int>(maxFrameSize.width * layout.columns, maxFrameSize.height * layout.rows));
+  std::vector<char> resized;
+  if(image.pixels != nullptr && !(size == image.size))
+    resized = ImageResampler::resize(image.pixels, image.size, image.format, size);
+  const char *pixels = resized.empty() ? image.pixels : resized.data();
+  if(StoryboardCache::instance().getTexture(firstKey + sheetIndex, pixels, size, image.format) == 0)
+    return;
+  sheetSizes[sheetIndex] = size;
+  requested[sheetIndex] = false;
+}
+
+void Storyboard::releaseSheets() {
+  if(!isValid())
+    return;
+  StoryboardCache::Key first = firstKey;
+  StoryboardCache::Key last = firstKey + layout.sheetCount;
+  WorkScheduler::instance().schedule(WorkScheduler::Priority::Low, WorkScheduler::Group::None, 0, [first, last] { // layouts may be set without a current context
+    StoryboardCache::instance().remove(first, last);
+  });
+}
+
+bool Storyboard::getFrame(int frame, Frame &result, bool requestMissing) {
+  if(!isValid() || frame < 0 || frame >= layout.frameCount)
+    return false;
+
+  int framesPerSheet = layout.columns * layout.rows;
+  int sheet = frame / framesPerSheet;
+  GLuint textureId = StoryboardCache::instance().findTexture(firstKey + sheet);
+  if(textureId == 0) { // not pushed yet, or evicted from the cache since
+    if(requestMissing && !requested[sheet] && layout.requestSheet) {
+      requested[sheet] = true;
+      layout.requestSheet(id, sheet); // host may push the sheet right away
+      textureId = StoryboardCache::instance().findTexture(firstKey + sheet);
+    }
+    if(textureId == 0)
+      return false;
+  }
+
+  Size<int> size = sheetSizes[sheet];
+  int cell = frame % framesPerSheet;
+  float width = static_cast<float>(size.width) / layout.columns;
+  float height = static_cast<float>(size.height) / layout.rows;
+  float left = (cell % layout.columns) * width;
+  float top = (cell / layout.columns) * height;
+  result = Frame { textureId, Rect { left, left + width, top, top + height }, size };
+  return true;
+}
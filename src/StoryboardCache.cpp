@@ -0,0 +1,106 @@
+#include "StoryboardCache.h"
+#include "GLState.h"
+#include "Settings.h"
+#include "TextureManager.h"
+#include "Utility.h"
+
+#include <algorithm>
+
+StoryboardCache::StoryboardCache()
+  : bytes(0),
+    hits(0),
+    misses(0),
+    evictions(0) {
+  TextureManager::instance().setEvictionCallback(TextureManager::Category::Storyboard, [](size_t bytes) {
+    StoryboardCache::instance().trim(bytes);
+  });
+}
+
+GLuint StoryboardCache::getTexture(const SubBitmapExtern &frame) {
+  if(frame.bitmapBytes == nullptr)
+    return findTexture(frame.bitmapHash);
+  return getTexture(frame.bitmapHash, frame.bitmapBytes, {frame.bitmapWidth, frame.bitmapHeight}, ConvertFormat(frame.bitmapInfoColorType));
+}
+
+GLuint StoryboardCache::getTexture(Key key, const char *pixels, Size<int> size, GLuint format) {
+  GLuint textureId = findTexture(key);
+  if(textureId != 0) {
+    ++hits;
+    return textureId;
+  }
+
+  ++misses;
+  textureId = upload(pixels, size, format);
+  if(textureId == 0)
+    return 0;
+
+  size_t sheetBytes = GLState::instance().getTextureBytes(textureId);
+  evict(Settings::instance().storyboardCacheBytes > sheetBytes ? Settings::instance().storyboardCacheBytes - sheetBytes : 0);
+  sheets.push_front({key, textureId, sheetBytes});
+  sheetsByKey[key] = sheets.begin();
+  bytes += sheetBytes;
+  return textureId;
+}
+
+GLuint StoryboardCache::findTexture(Key key) {
+  std::unordered_map<Key, std::list<Sheet>::iterator>::iterator search = sheetsByKey.find(key);
+  if(search == sheetsByKey.end())
+    return 0;
+  sheets.splice(sheets.begin(), sheets, search->second); // iterators stay valid
+  return search->second->textureId;
+}
+
+GLuint StoryboardCache::upload(const char *pixels, Size<int> size, GLuint format) {
+  assertCurrentEGLContext();
+
+  if(pixels == nullptr || size.width <= 0 || size.height <= 0)
+    return 0;
+  return TextureManager::instance().create(TextureManager::Category::Storyboard, TextureManager::Filter::Mipmap, format, size, pixels); // sheets are usually equally sized, pooled ones get reused
+}
+
+void StoryboardCache::evict(size_t budget) {
+  while(!sheets.empty() && bytes > budget) {
+    Sheet &sheet = sheets.back();
+    TextureManager::instance().release(sheet.textureId);
+    bytes -= sheet.bytes;
+    sheetsByKey.erase(sheet.key);
+    sheets.pop_back();
+    ++evictions;
+  }
+}
+
+void StoryboardCache::trim(size_t bytes) {
+  evict(this->bytes > bytes ? this->bytes - bytes : 0);
+}
+
+void StoryboardCache::remove(Key first, Key last) {
+  assertCurrentEGLContext();
+
+  for(Key key = first; key < last; ++key) {
+    std::unordered_map<Key, std::list<Sheet>::iterator>::iterator search = sheetsByKey.find(key);
+    if(search == sheetsByKey.end())
+      continue;
+    TextureManager::instance().release(search->second->textureId);
+    bytes -= search->second->bytes;
+    sheets.erase(search->second);
+    sheetsByKey.erase(search);
+  }
+}
+
+void StoryboardCache::clear() {
+  assertCurrentEGLContext();
+
+  for(Sheet &sheet : sheets)
+    TextureManager::instance().release(sheet.textureId);
+  sheets.clear();
+  sheetsByKey.clear();
+  bytes = 0;
+}
+
+int StoryboardCache::getStats(int *stats, int count) {
+  const int available = static_cast<int>(Stat::Count);
+  const int values[] = { static_cast<int>(hits), static_cast<int>(misses), static_cast<int>(evictions), static_cast<int>(sheets.size()), static_cast<int>(bytes / 1024) };
+  for(int i = 0; stats != nullptr && i < std::min(count, available); ++i)
+    stats[i] = values[i];
+  return available;
+}
@@ -0,0 +1,227 @@
+#include "SubtitleTrack.h"
+
+#include <algorithm>
+#include <cstring>
+
+SubtitleTrack::SubtitleTrack()
+  : leafCount(1),
+    indexed(false),
+    parsedCue({std::chrono::milliseconds(0), std::chrono::milliseconds(0), 0, 0}) {
+}
+
+void SubtitleTrack::add(std::chrono::milliseconds start, std::chrono::milliseconds end, const std::string &text) {
+  if(end <= start || text.empty())
+    return;
+  cues.push_back({start, end, static_cast<uint32_t>(texts.size()), static_cast<uint32_t>(text.size())});
+  texts += text;
+  indexed = false;
+}
+
+void SubtitleTrack::clear() {
+  cues.clear();
+  texts.clear();
+  latestEnds.clear();
+  leafCount = 1;
+  indexed = false;
+}
+
+int SubtitleTrack::load(const char *data, size_t length, Format format) {
+  if(format == Format::Unknown)
+    return 0;
+
+  size_t cuesBefore = cues.size();
+  texts.reserve(texts.size() + length); // texts are never longer than the data they come from
+  Block block = format == Format::WebVtt ? Block::Header : Block::None;
+
+  size_t lineStart = 0;
+  if(length >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) // UTF-8 BOM
+    lineStart = 3;
+  for(size_t i = lineStart; i < length; ++i) {
+    if(data[i] != '\n' && data[i] != '\r')
+      continue;
+    parseLine(data + lineStart, i - lineStart, format, block);
+    if(data[i] == '\r' && i + 1 < length && data[i + 1] == '\n')
+      ++i;
+    lineStart = i + 1;
+  }
+  if(lineStart < length)
+    parseLine(data + lineStart, length - lineStart, format, block);
+  parseLine(data, 0, format, block); // data may not end with a blank line
+
+  indexed = false;
+  return static_cast<int>(cues.size() - cuesBefore);
+}
+
+void SubtitleTrack::parseLine(const char *line, size_t length, Format format, Block &block) {
+  if(length == 0) {
+    if(block == Block::Text)
+      finishCue();
+    block = Block::None;
+    return;
+  }
+
+  if(block == Block::Header)
+    return;
+  if(block == Block::Text) {
+    appendText(line, length, format);
+    return;
+  }
+  if(block == Block::None && format == Format::WebVtt) {
+    std::string keyword(line, std::min<size_t>(length, 6));
+    keyword = keyword.substr(0, keyword.find_first_of(" \t"));
+    if(keyword == "NOTE" || keyword == "STYLE" || keyword == "REGION") {
+      block = Block::Header;
+      return;
+    }
+  }
+
+  std::chrono::milliseconds start, end;
+  if(parseTiming(line, length, start, end)) { // cue identifier is optional in WebVTT
+    parsedCue = {start, end, static_cast<uint32_t>(texts.size()), 0};
+    block = Block::Text;
+  }
+  else // identifier (SRT counter), or a malformed timing line whose block is skipped
+    block = block == Block::None ? Block::Timing : Block::Header;
+}
+
+bool SubtitleTrack::parseTiming(const char *line, size_t length, std::chrono::milliseconds &start, std::chrono::milliseconds &end) {
+  const char *position = line;
+  const char *lineEnd = line + length;
+  while(position < lineEnd && (*position == ' ' || *position == '\t'))
+    ++position;
+  if(!parseTimestamp(position, lineEnd, start))
+    return false;
+  while(position < lineEnd && (*position == ' ' || *position == '\t'))
+    ++position;
+  if(lineEnd - position < 3 || std::strncmp(position, "-->", 3) != 0)
+    return false;
+  position += 3;
+  while(position < lineEnd && (*position == ' ' || *position == '\t'))
+    ++position;
+  return parseTimestamp(position, lineEnd, end); // WebVTT cue settings may follow
+}
+
+bool SubtitleTrack::parseTimestamp(const char *&position, const char *end, std::chrono::milliseconds &time) { // [hh:]mm:ss[,.]mmm
+  long long parts[3] = {0, 0, 0};
+  int count = 0;
+  while(count < 3) {
+    if(position >= end || *position < '0' || *position > '9')
+      return false;
+    long long value = 0;
+    while(position < end && *position >= '0' && *position <= '9')
+      value = value * 10 + (*position++ - '0');
+    parts[count++] = value;
+    if(position >= end || *position != ':')
+      break;
+    ++position;
+  }
+  if(count < 2)
+    return false;
+
+  long long milliseconds = 0;
+  if(position < end && (*position == ',' || *position == '.')) {
+    ++position;
+    long long scale = 100;
+    while(position < end && *position >= '0' && *position <= '9') {
+      milliseconds += (*position++ - '0') * scale;
+      scale /= 10;
+    }
+  }
+  long long hours = count == 3 ? parts[0] : 0;
+  time = std::chrono::milliseconds(((hours * 60 + parts[count - 2]) * 60 + parts[count - 1]) * 1000 + milliseconds);
+  return true;
+}
+
+void SubtitleTrack::appendText(const char *line, size_t length, Format format) { // tags and styling are dropped, renderer draws plain text
+  size_t lineOffset = texts.size();
+  if(lineOffset > parsedCue.textOffset)
+    texts += '\n';
+  size_t textOffset = texts.size();
+
+  for(size_t i = 0; i < length; ++i) {
+    if(line[i] == '<') { // <i>, <b>, <font ...>, <c.class>, <v Speaker>, <00:00:01.000>
+      const char *close = static_cast<const char*>(std::memchr(line + i, '>', length - i));
+      if(close) {
+        i = close - line;
+        continue;
+      }
+    }
+    else if(line[i] == '{' && format == Format::Srt && i + 1 < length && line[i + 1] == '\\') { // {\an8} and other ASS overrides
+      const char *close = static_cast<const char*>(std::memchr(line + i, '}', length - i));
+      if(close) {
+        i = close - line;
+        continue;
+      }
+    }
+    else if(line[i] == '&' && format == Format::WebVtt) {
+      static const struct { const char *name; const char *text; } entities[] = {
+        {"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"}, {"&nbsp;", " "}, {"&lrm;", ""}, {"&rlm;", ""}
+      };
+      bool decoded = false;
+      for(const auto &entity : entities) {
+        size_t nameLength = std::strlen(entity.name);
+        if(length - i >= nameLength && std::strncmp(line + i, entity.name, nameLength) == 0) {
+          texts += entity.text;
+          i += nameLength - 1;
+          decoded = true;
+          break;
+        }
+      }
+      if(decoded)
+        continue;
+    }
+    texts += line[i];
+  }
+
+  if(texts.size() == textOffset) // line had only tags
+    texts.resize(lineOffset);
+}
+
+void SubtitleTrack::finishCue() {
+  parsedCue.textLength = static_cast<uint32_t>(texts.size() - parsedCue.textOffset);
+  if(parsedCue.textLength == 0 || parsedCue.end <= parsedCue.start) {
+    texts.resize(parsedCue.textOffset);
+    return;
+  }
+  cues.push_back(parsedCue);
+}
+
+void SubtitleTrack::buildIndex() {
+  std::stable_sort(cues.begin(), cues.end(), [](const Cue &a, const Cue &b) { return a.start < b.start; });
+  leafCount = 1;
+  while(leafCount < cues.size())
+    leafCount *= 2;
+  latestEnds.assign(2 * leafCount, std::chrono::milliseconds::min());
+  for(size_t i = 0; i < cues.size(); ++i)
+    latestEnds[leafCount + i] = cues[i].end;
+  for(size_t node = leafCount - 1; node >= 1; --node)
+    latestEnds[node] = std::max(latestEnds[2 * node], latestEnds[2 * node + 1]);
+  indexed = true;
+}
+
+void SubtitleTrack::findEndingAfter(size_t node, size_t nodeBegin, size_t nodeEnd, size_t last, std::chrono::milliseconds time, std::vector<size_t> &found) {
+  if(nodeBegin > last || latestEnds[node] <= time) // no cue of this range is still shown
+    return;
+  if(nodeEnd - nodeBegin == 1) {
+    found.push_back(nodeBegin);
+    return;
+  }
+  size_t middle = (nodeBegin + nodeEnd) / 2;
+  findEndingAfter(2 * node, nodeBegin, middle, last, time, found);
+  findEndingAfter(2 * node + 1, middle, nodeEnd, last, time, found);
+}
+
+size_t SubtitleTrack::findNext(std::chrono::milliseconds time) {
+  if(!indexed)
+    buildIndex();
+  return std::upper_bound(cues.begin(), cues.end(), time,
+                          [](std::chrono::milliseconds time, const Cue &cue) { return time < cue.start; }) - cues.begin();
+}
+
+std::vector<size_t> SubtitleTrack::find(std::chrono::milliseconds time) {
+  std::vector<size_t> found;
+  size_t next = findNext(time); // cues before it have already started
+  if(next > 0)
+    findEndingAfter(1, 0, leafCount, next - 1, time, found);
+  return found;
+}
@@ -2,44 +2,177 @@
 #include "Settings.h"
 #include "TextRenderer.h"
 
+#include <algorithm>
+
 Subtitles::Subtitles()
     : active(false),
-      showForOneFrame(false) {
+      showForOneFrame(false),
+      changed(false),
+      mediaTime(0),
+      mediaTimeSet(std::chrono::steady_clock::now()),
+      mediaPlaying(false),
+      playbackTime(-1),
+      preparedWidth(0),
+      fontHeight(26),
+      maxLines(6),
+      margin({100, 150}),
+      cuesAhead(3) {
 }
 
 void Subtitles::render() {
-  if(!active)
-    return;
+  changed = false;
+  shownCues = track.find(getMediaTime());
+  prepareCues(false);
 
-  if(std::chrono::steady_clock::now() > start + duration) {
+  bool showSubtitle = active;
+  if(active && std::chrono::steady_clock::now() > start + duration) {
     active = false;
-    if(showForOneFrame == false)
-      return;
+    showSubtitle = showForOneFrame;
     showForOneFrame = false;
   }
 
-  int fontHeight = 26;
-  Size<int> margin = {100, 150};
-  int textWidth = Settings::instance().viewport.width - 2 * margin.width;
+  if(showSubtitle) {
+    renderText(subtitle, 0);
+    return;
+  }
+  // overlapping cues are stacked, the latest started one at the bottom; earliest ones are left out above maxLines
+  int raise = 0;
+  for(std::vector<size_t>::reverse_iterator cue = shownCues.rbegin(); cue != shownCues.rend(); ++cue) {
+    std::string text = track.getText(*cue);
+    int height = static_cast<int>(getTextSize(text).height);
+    if(raise > 0 && raise + height > fontHeight * maxLines)
+      break;
+    renderText(text, raise);
+    raise += height;
+  }
+}
 
-  Size<GLuint> textSize = TextRenderer::instance().getTextSize(subtitle,
+Size<GLuint> Subtitles::getTextSize(const std::string &text) {
+  int textWidth = Settings::instance().viewport.width - 2 * margin.width;
+  return TextRenderer::instance().getTextSize(text,
     { static_cast<GLuint>(textWidth), static_cast<GLuint>(fontHeight) },
     0);
+}
+
+void Subtitles::keepText(const std::string &text, std::chrono::time_point<std::chrono::steady_clock> until) {
+  int textWidth = Settings::instance().viewport.width - 2 * margin.width;
+  TextRenderer::instance().keepText(text, { static_cast<GLuint>(textWidth), static_cast<GLuint>(fontHeight) }, 0, until);
+}
+
+void Subtitles::renderText(const std::string &text, int raise) {
+  int textWidth = Settings::instance().viewport.width - 2 * margin.width;
+
+  Size<GLuint> textSize = getTextSize(text);
 
-    TextRenderer::instance().render(subtitle, {
+    TextRenderer::instance().render(text, {
       static_cast<int>((Settings::instance().viewport.width - textSize.width) / 2),
-      static_cast<int>(margin.height + textSize.height - fontHeight)
+      static_cast<int>(margin.height + raise + textSize.height - fontHeight)
     },
     {textWidth, fontHeight},
     0,
     {1.0, 1.0, 1.0, 1.0});
 }
 
+void Subtitles::collectDamage(Damage &damage) {
+  bool expired = active && (showForOneFrame || std::chrono::steady_clock::now() > start + duration); // subtitle has to be hidden after its duration has passed
+  bool cueChanged = track.find(getMediaTime()) != shownCues;
+  if(changed || expired || cueChanged)
+    damage.add({ margin.width, margin.height - fontHeight }, { Settings::instance().viewport.width - 2 * margin.width, fontHeight * (maxLines + 1) });
+}
+
 void Subtitles::showSubtitle(const std::chrono::milliseconds duration, const std::string subtitle) {
   this->subtitle = subtitle;
   this->duration = duration;
   this->start = std::chrono::steady_clock::now();
   this->active = true;
+  this->changed = true;
   if(duration == std::chrono::milliseconds(0))
     showForOneFrame = true;
 }
+
+void Subtitles::addCues(std::vector<Cue> cues) {
+  for(const Cue &cue : cues)
+    track.add(cue.start, cue.end, cue.text);
+  preparedCues.clear(); // indices have changed, textures are still cached and will be found again
+  shownCues.clear();
+  changed = true;
+}
+
+int Subtitles::loadTrack(const char *data, size_t length, SubtitleTrack::Format format) {
+  int added = track.load(data, length, format);
+  preparedCues.clear();
+  shownCues.clear();
+  changed = true;
+  return added;
+}
+
+void Subtitles::clearCues() {
+  track.clear();
+  preparedCues.clear();
+  shownCues.clear();
+  changed = true;
+}
+
+void Subtitles::setMediaTime(std::chrono::milliseconds time, bool playing) {
+  mediaTime = time;
+  mediaTimeSet = std::chrono::steady_clock::now();
+  mediaPlaying = playing;
+}
+
+void Subtitles::updatePlaybackTime(std::chrono::milliseconds time, bool playing) {
+  if(time == playbackTime && playing == mediaPlaying)
+    return;
+  playbackTime = time;
+  setMediaTime(time, playing);
+}
+
+std::chrono::milliseconds Subtitles::getMediaTime() {
+  if(!mediaPlaying)
+    return mediaTime;
+  return mediaTime + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mediaTimeSet);
+}
+
+std::vector<size_t> Subtitles::getCuesToPrepare() {
+  std::chrono::milliseconds time = getMediaTime();
+  std::vector<size_t> current = track.find(time);
+  size_t first = !current.empty() ? current.front() : track.findNext(time);
+  std::vector<size_t> indices;
+  for(size_t i = first; i < track.size() && indices.size() < cuesAhead; ++i)
+    if(time < track.getEnd(i))
+      indices.push_back(i);
+  return indices;
+}
+
+void Subtitles::prepareCues(bool rasterize) {
+  if(preparedWidth != Settings::instance().viewport.width) { // textures were made for other text width
+    preparedCues.clear();
+    preparedWidth = Settings::instance().viewport.width;
+  }
+
+  std::chrono::milliseconds time = getMediaTime();
+  std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+  std::vector<size_t> prepared;
+  for(size_t i : getCuesToPrepare()) {
+    bool wasPrepared = std::find(preparedCues.begin(), preparedCues.end(), i) != preparedCues.end();
+    if(!wasPrepared && !rasterize)
+      continue;
+    getTextSize(track.getText(i)); // rasterizes text on first call
+    // kept until the cue ends, frames may not be drawn for longer than the texture collection timeout before it is due
+    keepText(track.getText(i), now + std::max(track.getEnd(i) - time, std::chrono::milliseconds(0)));
+    prepared.push_back(i);
+    if(!wasPrepared)
+      rasterize = false;
+  }
+  preparedCues.swap(prepared); // cues left behind aren't kept alive anymore
+}
+
+bool Subtitles::hasCuesToPrepare() {
+  if(track.size() == 0)
+    return false;
+  if(preparedWidth != Settings::instance().viewport.width)
+    return true;
+  for(size_t i : getCuesToPrepare())
+    if(std::find(preparedCues.begin(), preparedCues.end(), i) == preparedCues.end())
+      return true;
+  return false;
+}
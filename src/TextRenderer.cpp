@@ -1,33 +1,49 @@
 #include "TextRenderer.h"
+#include "GLState.h"
 #include "TextTextureGenerator.h"
 #include "ProgramBuilder.h"
 #include "Settings.h"
 #include "LogConsole.h"
+#include "WorkScheduler.h"
 #include "Utility.h"
 
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/textRenderer.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/textRenderer.frag"
+;
+
+const std::size_t MAX_FAILED_TEXTS = 256;
+
+// 64 bits on every platform, std::hash is only 32 bits wide on 32-bit ARM
+uint64_t getTaskKey(const TextTextureGenerator::TextureKey &key) {
+  uint64_t hash = Utility::fnv1a(0xcbf29ce484222325ull, key.text.data(), key.text.size());
+  hash = Utility::fnv1a(hash, &key.size.width, sizeof(key.size.width));
+  hash = Utility::fnv1a(hash, &key.size.height, sizeof(key.size.height));
+  return Utility::fnv1a(hash, &key.fontId, sizeof(key.fontId));
+}
+
+} // namespace
+
 TextRenderer::TextRenderer() {
-  prepareShaders();
+  ProgramBuilder::prefetchProgram("textRenderer", vShaderTexStr, fShaderTexStr);
 }
 
 TextRenderer::~TextRenderer() {
   assertCurrentEGLContext();
 
   if(programObject != GL_INVALID_VALUE)
-    glDeleteProgram(programObject);
+    GLState::instance().deleteProgram(programObject);
 }
 
 void TextRenderer::prepareShaders() {
   assertCurrentEGLContext();
 
-  const GLchar* vShaderTexStr =
-#include "shaders/textRenderer.vert"
-;
-
-  const GLchar* fShaderTexStr =
-#include "shaders/textRenderer.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "textRenderer");
 
   posLoc = glGetAttribLocation(programObject, "a_position");
   texLoc = glGetAttribLocation(programObject, "a_texCoord");
@@ -39,6 +55,7 @@ void TextRenderer::prepareShaders() {
 }
 
 int TextRenderer::addFont(char *data, int size) {
+  failedTexts.clear(); // may rasterize with the new font
   return TextTextureGenerator::instance().addFont(data, size);
 }
 
@@ -61,6 +78,39 @@ Size<GLuint> TextRenderer::getTextSize(const std::string text, Size<GLuint> size
   return { 0, 0 };
 }
 
+void TextRenderer::keepText(const std::string &text, Size<GLuint> size, int fontId, std::chrono::time_point<std::chrono::steady_clock> until) {
+  TextTextureGenerator::instance().pinTexture(TextTextureGenerator::TextureKey { text, size, fontId }, until);
+}
+
+// New text is rasterized right away only if its font face exists and the frame is within its budget,
+// otherwise at the end of a frame by WorkScheduler; nothing is drawn in its place until then.
+bool TextRenderer::isTextReady(const std::string &text, Size<int> size, int fontId) {
+  TextTextureGenerator &generator = TextTextureGenerator::instance();
+  TextTextureGenerator::TextureKey textureKey = {
+    .text = text,
+    .size = size,
+    .fontId = fontId,
+  };
+  if(!generator.isFontValid(fontId) || generator.isTextureGenerated(textureKey))
+    return true;
+  uint64_t key = getTaskKey(textureKey);
+  if(failedTexts.count(key) != 0)
+    return true;
+  if(generator.isFontFaceGenerated(fontId, size.height) && WorkScheduler::instance().isWithinBudget())
+    return true;
+
+  WorkScheduler::instance().schedule(WorkScheduler::Priority::Normal, WorkScheduler::Group::Text, key, [this, textureKey, key] {
+    try {
+      TextTextureGenerator::instance().getTexture(textureKey);
+    } catch(...) {
+      if(failedTexts.size() >= MAX_FAILED_TEXTS) // forgotten ones are deferred once more before they fail inline again
+        failedTexts.clear();
+      failedTexts.insert(key);
+    }
+  });
+  return false;
+}
+
 void TextRenderer::render(std::string text, Position<int> position, Size<int> size, int fontId, std::vector<float> color) {
   assertCurrentEGLContext();
 
@@ -70,6 +120,10 @@ void TextRenderer::render(std::string text, Position<int> position, Size<int> si
   try {
     if(color.size() >= 4 && color[3] < 0.001f) // if the text is fully transparent, we don't have to render it
       return;
+    if(!isTextReady(text, size, fontId)) {
+      ++skippedRenders;
+      return;
+    }
 
     TextTextureGenerator::TextureInfo textureInfo = TextTextureGenerator::instance().getTexture(TextTextureGenerator::TextureKey {
       .text = text,
@@ -81,6 +135,8 @@ void TextRenderer::render(std::string text, Position<int> position, Size<int> si
       LogConsole::instance().log("textureInfo.size invalid!", LogConsole::LogLevel::Error);
       return;
     }
+    if(programObject == GL_INVALID_VALUE)
+      prepareShaders();
 
     float left = static_cast<float>(position.x) / static_cast<float>(Settings::instance().viewport.width) * 2.0f - 1.0f;
     float right = left + static_cast<float>(textureInfo.getSize().width) / static_cast<float>(Settings::instance().viewport.width) * 2.0f;
@@ -96,25 +152,19 @@ void TextRenderer::render(std::string text, Position<int> position, Size<int> si
     float texCoord[] = { 0.0f, 0.0f,    0.0f, 1.0f,
                          1.0f, 1.0f,    1.0f, 0.0f };
 
-    glUseProgram(programObject);
+    GLState::instance().useProgram(programObject);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureInfo.getTextureId());
-    glUniform1i(samplerLoc, 0);
-    glUniform3f(colLoc, color[0], color[1], color[2]);
-    glUniform3f(shaColLoc, 0.0f, 0.0f, 0.0f);
-    glUniform1f(opaLoc, color[3]);
-    glUniform2f(shaOffLoc, -1.0f / textureInfo.getSize().width, -1.0f / textureInfo.getSize().height);
-    glEnableVertexAttribArray(posLoc);
+    GLState::instance().bindTexture(0, textureInfo.getTextureId());
+    GLState::instance().uniform1i(samplerLoc, 0);
+    GLState::instance().uniform3f(colLoc, color[0], color[1], color[2]);
+    GLState::instance().uniform3f(shaColLoc, 0.0f, 0.0f, 0.0f);
+    GLState::instance().uniform1f(opaLoc, color[3]);
+    GLState::instance().uniform2f(shaOffLoc, -1.0f / textureInfo.getSize().width, -1.0f / textureInfo.getSize().height);
+    GLState::instance().vertexAttribArrays({posLoc, texLoc});
     glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
-    glEnableVertexAttribArray(texLoc);
     glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
 
-    glDisableVertexAttribArray(posLoc);
-    glDisableVertexAttribArray(texLoc);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glUseProgram(0);
   } catch(const std::exception &e) {
     LogConsole::instance().log(std::string("Text rendering failed: ") + std::string(e.what()), LogConsole::LogLevel::Error);
   } catch(...) {
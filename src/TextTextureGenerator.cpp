@@ -1,7 +1,9 @@
 #include "TextTextureGenerator.h"
+#include "GLState.h"
 #include "ProgramBuilder.h"
 #include "Settings.h"
 #include "LogConsole.h"
+#include "TextureManager.h"
 #include "log.h"
 #include "Utility.h"
 
@@ -10,14 +12,28 @@
 #include <sstream>
 #include <string>
 
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/textTextureGenerator.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/textTextureGenerator.frag"
+;
+
+} // namespace
+
 TextTextureGenerator::TextTextureGenerator()
   : textureGCTimeout(1000) {
   assertCurrentEGLContext();
 
+  TextureManager::instance(); // constructed first, so it outlives this singleton
+
   FT_Error error = FT_Init_FreeType(&ftLibrary);
   if(error != FT_Err_Ok)
     throw std::runtime_error(getErrorMessage(error));
-  prepareShaders();
+  ProgramBuilder::prefetchProgram("textTextureGenerator", vShaderTexStr, fShaderTexStr);
 
   glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize.width);
   maxTextureSize.height = maxTextureSize.width;
@@ -27,10 +43,10 @@ TextTextureGenerator::~TextTextureGenerator() {
   assertCurrentEGLContext();
 
   if(programObject != GL_INVALID_VALUE)
-    glDeleteProgram(programObject);
+    GLState::instance().deleteProgram(programObject);
   for(auto& texture : generatedTextures) {
     GLuint id = texture.second.getTextureId();
-    glDeleteTextures(1, &id);
+    TextureManager::instance().release(id);
   }
   for(FT_Face& face : faces)
     FT_Done_Face(face);
@@ -40,15 +56,7 @@ TextTextureGenerator::~TextTextureGenerator() {
 void TextTextureGenerator::prepareShaders() {
   assertCurrentEGLContext();
 
-  const GLchar* vShaderTexStr =
-#include "shaders/textTextureGenerator.vert"
-;
-
-  const GLchar* fShaderTexStr =
-#include "shaders/textTextureGenerator.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "textTextureGenerator");
 
   samplerLoc = glGetUniformLocation(programObject, "s_texture");
   colLoc = glGetUniformLocation(programObject, "u_color");
@@ -109,27 +117,14 @@ TextTextureGenerator::FontFace TextTextureGenerator::generateFontFace(FontFaceKe
     if(FT_Load_Char(ftFace, c, FT_LOAD_RENDER)) {
       continue;
     }
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
+    GLuint texture = TextureManager::instance().create(
+        TextureManager::Category::Glyph,
+        TextureManager::Filter::Linear,
         GL_LUMINANCE,
-        ftFace->glyph->bitmap.width,
-        ftFace->glyph->bitmap.rows,
-        0,
-        GL_LUMINANCE,
-        GL_UNSIGNED_BYTE,
+        {static_cast<int>(ftFace->glyph->bitmap.width), static_cast<int>(ftFace->glyph->bitmap.rows)},
         ftFace->glyph->bitmap.buffer
     );
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
     Character character = {
       texture,
       glm::ivec2(ftFace->glyph->bitmap.width, ftFace->glyph->bitmap.rows),
@@ -161,8 +156,11 @@ TextTextureGenerator::TextureInfo TextTextureGenerator::getTexture(TextTextureGe
   if(!TextTextureGenerator::instance().isFontValid(textureKey.fontId))
     throw std::out_of_range("no such fontId");
 
-  if(generatedTextures.count(textureKey))
-    return generatedTextures.at(textureKey);
+  auto search = generatedTextures.find(textureKey);
+  if(search != generatedTextures.end()) {
+    search->second.getTextureId(); // mark the cached texture as used, the returned copy doesn't update it
+    return search->second;
+  }
 
   gcTextures();
   gcBrokenTextSizes();
@@ -189,44 +187,39 @@ TextTextureGenerator::TextureInfo TextTextureGenerator::generateTexture(TextText
 
   GLuint framebuffer;
   GLuint depthRenderbuffer;
-  GLuint texture;
 
   glGenFramebuffers(1, &framebuffer);
   glGenRenderbuffers(1, &depthRenderbuffer);
-  glGenTextures(1, &texture);
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexImage2D(
-      GL_TEXTURE_2D,
-      0,
+  GLuint texture = TextureManager::instance().create( // same sized text reuses a pooled texture
+      TextureManager::Category::Text,
+      TextureManager::Filter::Linear,
       GL_RGBA,
-      texSize.width,
-      texSize.height,
-      0,
-      GL_RGBA,
-      GL_UNSIGNED_BYTE,
+      {static_cast<int>(texSize.width), static_cast<int>(texSize.height)},
       NULL
   );
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
   glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, texSize.width, texSize.height);
 
+  GLint previousFramebuffer = 0; // text may be rasterized while rendering into a layer
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  GLState::BlendFunc blendFunc = GLState::instance().getBlendFunc();
+
   glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
 
   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
 
+  bool scissorTest = GLState::instance().isEnabled(GL_SCISSOR_TEST); // partial redraw of the screen mustn't clip text rasterization
+  GLState::instance().disable(GL_SCISSOR_TEST);
+
   GLuint status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
   if(status == GL_FRAMEBUFFER_COMPLETE) {
+    if(programObject == GL_INVALID_VALUE)
+      prepareShaders();
 
-    glEnable(GL_BLEND);
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+    GLState::instance().enable(GL_BLEND);
+    GLState::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -234,7 +227,7 @@ TextTextureGenerator::TextureInfo TextTextureGenerator::generateTexture(TextText
     Position<float> startingPos = { static_cast<float>(font.max_bearingx),
                                    -static_cast<float>(font.max_descend) };
 
-    glUseProgram(programObject);
+    GLState::instance().useProgram(programObject);
     glViewport(0, 0, texSize.width, texSize.height);
 
     Position<float> pos{ 0.0f, 0.0f };
@@ -268,21 +261,17 @@ TextTextureGenerator::TextureInfo TextTextureGenerator::generateTexture(TextText
         GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
         float texCoord[] = { 0.0f, 0.0f,    0.0f, 1.0f,
                              1.0f, 1.0f,    1.0f, 0.0f };
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        glUniform1i(samplerLoc, 0);
-        glEnableVertexAttribArray(texLoc);
+        GLState::instance().bindTexture(0, ch.TextureID);
+        GLState::instance().uniform1i(samplerLoc, 0);
+        GLState::instance().vertexAttribArrays({texLoc, posLoc});
         glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
 
-        glUniform3f(colLoc, 1.0f, 1.0f, 1.0f);
-        glEnableVertexAttribArray(posLoc);
+        GLState::instance().uniform3f(colLoc, 1.0f, 1.0f, 1.0f);
         glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 0, vVertices);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
       }
       advance(pos, *c, font, true);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glUseProgram(0);
   }
   else {
     printFramebufferError(status);
@@ -294,8 +283,11 @@ TextTextureGenerator::TextureInfo TextTextureGenerator::generateTexture(TextText
 
   glDeleteRenderbuffers(1, &depthRenderbuffer);
   glDeleteFramebuffers(1, &framebuffer);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+  GLState::instance().blendFunc(blendFunc);
   glViewport(0, 0, Settings::instance().viewport.width, Settings::instance().viewport.height); // restore previous viewport
+  if(scissorTest)
+    GLState::instance().enable(GL_SCISSOR_TEST);
 
   return TextureInfo(texture, texSize, textureKey.fontId, font);
 }
@@ -403,14 +395,21 @@ Size<GLuint> TextTextureGenerator::getBrokenTextSize(const std::string text, int
   return { static_cast<GLuint>(position.x), static_cast<GLuint>(position.y) };
 }
 
+void TextTextureGenerator::pinTexture(const TextureKey &textureKey, std::chrono::time_point<std::chrono::steady_clock> until) {
+  auto search = generatedTextures.find(textureKey);
+  if(search != generatedTextures.end())
+    search->second.pin(until);
+}
+
 void TextTextureGenerator::gcTextures() {
   assertCurrentEGLContext();
 
   auto it = generatedTextures.begin();
   while(it != generatedTextures.end()) {
-    if(std::chrono::steady_clock::now() - it->second.getLastTimeAccessed() >= textureGCTimeout) {
+    std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+    if(now - it->second.getLastTimeAccessed() >= textureGCTimeout && now >= it->second.getPinnedUntil()) {
       GLuint id = it->second.getTextureId();
-      glDeleteTextures(1, &id);
+      TextureManager::instance().release(id);
       it = generatedTextures.erase(it);
     }
     else
@@ -0,0 +1,409 @@
+#include "TextureCache.h"
+#include "EtcEncoder.h"
+#include "GLState.h"
+#include "MipmapGenerator.h"
+#include "PixelConverter.h"
+#include "Settings.h"
+#include "TextureManager.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+const char VARIANT_KEY[] = "tilecache"; // key/value entry, terminating '\0' included
+
+struct KtxHeader {
+  unsigned char identifier[12];
+  uint32_t endianness;
+  uint32_t glType; // 0 for compressed formats
+  uint32_t glTypeSize;
+  uint32_t glFormat; // 0 for compressed formats
+  uint32_t glInternalFormat;
+  uint32_t glBaseInternalFormat;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t numberOfArrayElements;
+  uint32_t numberOfFaces;
+  uint32_t numberOfMipmapLevels;
+  uint32_t bytesOfKeyValueData;
+};
+
+size_t padded(size_t bytes) { // KTX aligns rows, key/value entries and levels to 4 bytes
+  return (bytes + 3) & ~static_cast<size_t>(3);
+}
+
+size_t getLevelBytes(GLenum format, bool compressed, Size<int> size) {
+  if(compressed)
+    return EtcEncoder::getEncodedSize(size);
+  return padded(static_cast<size_t>(size.width) * GLState::getBytesPerPixel(format)) * size.height;
+}
+
+int getLevelCount(Size<int> size) { // down to 1x1
+  int count = 1;
+  for(int largest = std::max(size.width, size.height); largest > 1; largest /= 2)
+    ++count;
+  return count;
+}
+
+} // namespace
+
+TextureCache::Image::~Image() {
+  munmap(mapping, length);
+}
+
+TextureCache::TextureCache()
+  : stopRequested(false) {
+  std::fill(std::begin(stats), std::end(stats), 0);
+}
+
+TextureCache::~TextureCache() {
+  stop();
+}
+
+void TextureCache::setDirectory(const std::string &directory) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->directory = directory;
+}
+
+std::string TextureCache::getDirectory() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return directory;
+}
+
+void TextureCache::increment(Stat stat) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ++stats[static_cast<int>(stat)];
+}
+
+int TextureCache::getQuality(bool background) {
+  int quality = TextureManager::instance().getCompressionQuality();
+  if(!background)
+    return quality;
+  // 8 MB of RGBA at 1080p otherwise, page faulted in during the upload
+  return PixelConverter::instance().getEtcFormat() != GL_NONE ? std::max(quality, static_cast<int>(EtcEncoder::Quality::Fast)) : -1;
+}
+
+TextureCache::Variant TextureCache::getVariant(uint64_t key, int quality, bool background) {
+  Size<int> maxSize = background ? Settings::instance().backgroundImageMaxSize : Settings::instance().tileImageMaxSize;
+  Variant variant;
+  std::memset(&variant, 0, sizeof(variant)); // written to files as it is, padding included
+  variant.key = key;
+  variant.maxWidth = maxSize.width;
+  variant.maxHeight = maxSize.height;
+  variant.quality = quality;
+  return variant;
+}
+
+std::string TextureCache::getPath(const std::string &directory, uint64_t key, bool background) {
+  std::ostringstream oss;
+  oss << directory << "/texture_" << std::hex << std::setw(16) << std::setfill('0') << key << (background ? "_background.ktx" : ".ktx");
+  return oss.str();
+}
+
+std::shared_ptr<TextureCache::Image> TextureCache::open(uint64_t key, bool background) {
+  std::string directory = getDirectory();
+  if(directory.empty() || key == 0)
+    return nullptr;
+
+  std::string path = getPath(directory, key, background);
+  int file = ::open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if(file < 0 || fstat(file, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(KtxHeader)) {
+    if(file >= 0)
+      close(file);
+    if(!background)
+      increment(Stat::Misses);
+    return nullptr;
+  }
+  size_t length = static_cast<size_t>(status.st_size);
+  void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file); // mapping stays valid
+  if(mapping == MAP_FAILED) {
+    if(!background)
+      increment(Stat::Misses);
+    return nullptr;
+  }
+  madvise(mapping, length, MADV_WILLNEED); // read ahead by the kernel while the upload is pending
+  std::shared_ptr<Image> image = std::make_shared<Image>(mapping, length);
+
+  const char *data = static_cast<const char*>(mapping);
+  KtxHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  size_t offset = sizeof(header);
+  bool valid = std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0 && header.endianness == KTX_ENDIANNESS
+               && header.pixelDepth == 0 && header.numberOfArrayElements == 0 && header.numberOfFaces == 1
+               && header.pixelWidth > 0 && header.pixelHeight > 0 && header.pixelWidth <= 16384 && header.pixelHeight <= 16384
+               && header.bytesOfKeyValueData <= length - offset;
+
+  // settings the file was made with
+  Variant expected = getVariant(key, getQuality(background), background);
+  bool matching = false;
+  for(size_t entry = offset; valid && entry + 4 <= offset + header.bytesOfKeyValueData; ) {
+    uint32_t entryBytes = 0;
+    std::memcpy(&entryBytes, data + entry, 4);
+    if(entryBytes > offset + header.bytesOfKeyValueData - entry - 4)
+      break;
+    if(entryBytes == sizeof(VARIANT_KEY) + sizeof(Variant) && std::memcmp(data + entry + 4, VARIANT_KEY, sizeof(VARIANT_KEY)) == 0)
+      matching = std::memcmp(data + entry + 4 + sizeof(VARIANT_KEY), &expected, sizeof(Variant)) == 0;
+    entry += 4 + padded(entryBytes);
+  }
+  valid = valid && matching;
+  offset += header.bytesOfKeyValueData;
+
+  // format this context samples, ETC1 data is uploaded as ETC2 on GLES3
+  image->compressed = header.glType == 0;
+  if(image->compressed)
+    image->format = header.glInternalFormat == GL_ETC1_RGB8_OES ? PixelConverter::instance().getEtcFormat() : GL_NONE;
+  else if(header.glType == GL_UNSIGNED_BYTE && header.glFormat == header.glInternalFormat
+          && (header.glFormat == GL_RGBA || header.glFormat == GL_RGB || header.glFormat == GL_BGRA_EXT))
+    image->format = PixelConverter::instance().getUploadFormat(header.glFormat) == header.glFormat ? header.glFormat : GL_NONE;
+  else
+    image->format = GL_NONE;
+  image->size = Size<int>(static_cast<int>(header.pixelWidth), static_cast<int>(header.pixelHeight));
+  int levelCount = background ? 1 : getLevelCount(image->size);
+  valid = valid && image->format != GL_NONE && (!background || image->compressed || header.glFormat == GL_RGBA) && static_cast<int>(header.numberOfMipmapLevels) == levelCount;
+
+  for(int i = 0; valid && i < static_cast<int>(header.numberOfMipmapLevels); ++i) {
+    Size<int> levelSize(std::max(image->size.width >> i, 1), std::max(image->size.height >> i, 1));
+    uint32_t imageSize = 0;
+    if(length - offset < 4)
+      break;
+    std::memcpy(&imageSize, data + offset, 4);
+    offset += 4;
+    if(imageSize != getLevelBytes(image->format, image->compressed, levelSize) || padded(imageSize) > length - offset)
+      break;
+    image->levels.push_back({ levelSize, data + offset, imageSize });
+    offset += padded(imageSize);
+  }
+  if(!valid || static_cast<int>(image->levels.size()) != levelCount) {
+    if(!background)
+      increment(Stat::Misses);
+    return nullptr;
+  }
+  utimensat(AT_FDCWD, path.c_str(), nullptr, 0); // most recently used, see trim()
+  if(!background)
+    increment(Stat::Hits);
+  return image;
+}
+
+GLuint TextureCache::upload(const Image &image) {
+  assertCurrentEGLContext();
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  if(texture == 0)
+    return 0;
+  GLState::instance().bindTexture(0, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  uploadLevels(image);
+  return texture;
+}
+
+void TextureCache::uploadLevels(const Image &image) {
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // rows are padded in the file
+  for(size_t i = 0; i < image.levels.size(); ++i) {
+    const Level &level = image.levels[i];
+    if(image.compressed)
+      glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), image.format, level.size.width, level.size.height, 0, static_cast<GLsizei>(level.bytes), level.data);
+    else
+      glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), image.format, level.size.width, level.size.height, 0, image.format, GL_UNSIGNED_BYTE, level.data);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+}
+
+void TextureCache::store(uint64_t key, std::shared_ptr<const std::vector<char>> pixels, Size<int> size, GLenum format, bool background) {
+  std::string directory = getDirectory();
+  if(directory.empty() || key == 0 || !pixels || pixels->empty() || size.width <= 0 || size.height <= 0 || format == GL_NONE)
+    return;
+  if(background && format != GL_RGBA && format != GL_RGB && format != GL_BGRA_EXT)
+    return;
+  // backgrounds are checked for alpha on the worker thread, a full screen image takes a while
+  int quality = getQuality(background);
+  GLenum compressedFormat = background ? (quality >= 0 ? GL_ETC1_RGB8_OES : GL_NONE) : TextureManager::instance().getCompressedFormat(TextureManager::Category::Tile, format, size, pixels->data());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({ key, pixels, size, format, compressedFormat, quality, background, getPath(directory, key, background) });
+    if(!thread.joinable()) {
+      stopRequested = false;
+      thread = std::thread(&TextureCache::run, this);
+    }
+  }
+  wakeUp.notify_all();
+}
+
+void TextureCache::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    wakeUp.wait(lock, [this] { return stopRequested || !jobs.empty(); });
+    if(stopRequested)
+      break;
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    lock.unlock();
+    write(job);
+    lock.lock();
+    if(jobs.empty()) { // a burst of writes is trimmed once
+      lock.unlock();
+      trim(job.path.substr(0, job.path.rfind('/')));
+      lock.lock();
+    }
+  }
+}
+
+void TextureCache::write(const Job &job) {
+  // level 0 in the format it is uploaded in, then the chain built from it
+  std::vector<char> converted;
+  std::vector<MipmapGenerator::Level> levels; // pixels hold ETC blocks when compressed
+  bool compressed = job.compressedFormat != GL_NONE && (!job.background || EtcEncoder::isOpaque(job.pixels->data(), job.size, job.format));
+  GLenum format = compressed ? GL_ETC1_RGB8_OES : job.background ? GL_RGBA : PixelConverter::instance().getUploadFormat(job.format);
+  if(compressed) { // a background is never minified, it gets level 0 only
+    for(EtcEncoder::Level &level : EtcEncoder::encodeChain(job.pixels->data(), job.size, job.format, static_cast<EtcEncoder::Quality>(job.quality), !job.background))
+      levels.push_back({ level.size, std::move(level.data) });
+  }
+  else if(job.background) { // RGBA, translucent or in a context without ETC
+    size_t count = static_cast<size_t>(job.size.width) * job.size.height;
+    const uint8_t *src = reinterpret_cast<const uint8_t*>(job.pixels->data());
+    levels.push_back({ job.size, std::vector<char>(count * 4) });
+    uint8_t *dst = reinterpret_cast<uint8_t*>(levels.back().pixels.data());
+    if(job.format == GL_RGB)
+      PixelConverter::rgbToRgba(src, dst, count);
+    else if(job.format == GL_BGRA_EXT)
+      PixelConverter::bgraToRgba(src, dst, count);
+    else
+      std::memcpy(dst, src, count * 4);
+  }
+  else {
+    const char *pixels = static_cast<const char*>(PixelConverter::instance().convert(job.format, job.size, job.pixels->data(), converted));
+    levels.push_back({ job.size, std::vector<char>(pixels, pixels + static_cast<size_t>(job.size.width) * job.size.height * GLState::getBytesPerPixel(format)) });
+    std::vector<MipmapGenerator::Level> chain = MipmapGenerator::buildChain(pixels, job.size, format);
+    levels.insert(levels.end(), std::make_move_iterator(chain.begin()), std::make_move_iterator(chain.end()));
+  }
+
+  KtxHeader header;
+  std::memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+  header.endianness = KTX_ENDIANNESS;
+  header.glType = compressed ? 0 : GL_UNSIGNED_BYTE;
+  header.glTypeSize = 1;
+  header.glFormat = compressed ? 0 : format;
+  header.glInternalFormat = format;
+  header.glBaseInternalFormat = compressed ? GL_RGB : format;
+  header.pixelWidth = static_cast<uint32_t>(job.size.width);
+  header.pixelHeight = static_cast<uint32_t>(job.size.height);
+  header.pixelDepth = 0;
+  header.numberOfArrayElements = 0;
+  header.numberOfFaces = 1;
+  header.numberOfMipmapLevels = static_cast<uint32_t>(levels.size());
+  uint32_t entryBytes = sizeof(VARIANT_KEY) + sizeof(Variant);
+  header.bytesOfKeyValueData = static_cast<uint32_t>(4 + padded(entryBytes));
+  Variant variant = getVariant(job.key, job.quality, job.background);
+  const char padding[4] = { 0, 0, 0, 0 };
+
+  const std::string &path = job.path;
+  std::string tmpPath = path + ".tmp"; // written aside and renamed, like program binaries
+  std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(&entryBytes), 4);
+  file.write(VARIANT_KEY, sizeof(VARIANT_KEY));
+  file.write(reinterpret_cast<const char*>(&variant), sizeof(variant));
+  file.write(padding, padded(entryBytes) - entryBytes);
+  for(const MipmapGenerator::Level &level : levels) {
+    uint32_t imageSize = static_cast<uint32_t>(getLevelBytes(format, compressed, level.size));
+    file.write(reinterpret_cast<const char*>(&imageSize), 4);
+    if(compressed) {
+      file.write(level.pixels.data(), level.pixels.size());
+    }
+    else { // rows padded to 4 bytes
+      size_t rowBytes = static_cast<size_t>(level.size.width) * GLState::getBytesPerPixel(format);
+      for(int y = 0; y < level.size.height; ++y) {
+        file.write(&level.pixels[y * rowBytes], rowBytes);
+        file.write(padding, padded(rowBytes) - rowBytes);
+      }
+    }
+    file.write(padding, padded(imageSize) - imageSize);
+  }
+  file.close();
+  if(!file || std::rename(tmpPath.c_str(), path.c_str()) != 0) { // not logged, LogConsole belongs to the render thread
+    std::remove(tmpPath.c_str());
+    return;
+  }
+  if(!job.background)
+    increment(Stat::Writes);
+}
+
+void TextureCache::trim(const std::string &directory) {
+  struct File {
+    std::string path;
+    size_t bytes;
+    struct timespec used; // mtime, set by open() on every hit
+  };
+  std::vector<File> files;
+  size_t total = 0;
+  DIR *dir = opendir(directory.c_str());
+  if(dir == nullptr)
+    return;
+  for(struct dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if(name.compare(0, 8, "texture_") != 0 || name.size() < 12 || name.compare(name.size() - 4, 4, ".ktx") != 0)
+      continue; // host may keep other files there, .tmp ones are being written
+    std::string path = directory + "/" + name;
+    struct stat status;
+    if(stat(path.c_str(), &status) != 0 || !S_ISREG(status.st_mode))
+      continue;
+    files.push_back({ path, static_cast<size_t>(status.st_size), status.st_mtim });
+    total += static_cast<size_t>(status.st_size);
+  }
+  closedir(dir);
+
+  size_t budget = Settings::instance().textureCacheBytes;
+  if(total <= budget)
+    return;
+  std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+    return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+  });
+  for(const File &file : files) {
+    if(total <= budget)
+      break;
+    if(unlink(file.path.c_str()) != 0) // a background may still be mapped, its pages stay valid
+      continue;
+    total -= file.bytes;
+    increment(Stat::Evictions);
+  }
+}
+
+void TextureCache::stop() {
+  if(!thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  wakeUp.notify_all();
+  thread.join();
+  jobs.clear();
+}
+
+int TextureCache::getStats(int *stats, int count) {
+  const int available = static_cast<int>(Stat::Count);
+  std::lock_guard<std::mutex> lock(mutex);
+  for(int i = 0; stats != nullptr && i < std::min(count, available); ++i)
+    stats[i] = this->stats[i];
+  return available;
+}
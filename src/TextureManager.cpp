@@ -0,0 +1,279 @@
+#include "TextureManager.h"
+#include "EtcEncoder.h"
+#include "GLState.h"
+#include "LogConsole.h"
+#include "PixelConverter.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+TextureManager::TextureManager()
+  : totalBytes(0),
+    lastGeneration(0),
+    evicting(false),
+    cpuMipmaps(Settings::instance().cpuMipmaps),
+    compressionQuality(Settings::instance().textureCompression) {
+  std::fill(std::begin(categoryBytes), std::end(categoryBytes), 0);
+  std::fill(std::begin(evictionCallbacks), std::end(evictionCallbacks), nullptr);
+}
+
+GLuint TextureManager::create(Category category, Filter filter, GLenum format, Size<int> size, const void *pixels) {
+  assertCurrentEGLContext();
+
+  if(size.width < 0 || size.height < 0)
+    return 0;
+  if(format == GL_NONE) {
+    LogConsole::instance().log("Cannot create texture of unknown pixel format", LogConsole::LogLevel::Error);
+    return 0;
+  }
+  GLenum compressedFormat = getCompressedFormat(category, format, size, pixels);
+  std::vector<char> converted;
+  pixels = PixelConverter::instance().convert(format, size, pixels, converted);
+  format = PixelConverter::instance().getUploadFormat(format);
+
+  GLuint texture = acquire(format, size);
+  if(texture == 0) {
+    LogConsole::instance().log("Cannot create texture", LogConsole::LogLevel::Error);
+    return 0;
+  }
+
+  Texture &info = textures[texture];
+  info.filter = filter;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter == Filter::Nearest ? GL_NEAREST : filter == Filter::Linear ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter == Filter::Nearest ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  store(texture, info, format, size, pixels, compressedFormat);
+  account(info, category, GLState::instance().getTextureBytes(texture));
+  enforceBudget();
+  return texture;
+}
+
+GLenum TextureManager::getCompressedFormat(Category category, GLenum format, Size<int> size, const void *pixels) {
+  if(compressionQuality < 0 || pixels == nullptr || (category != Category::Tile && category != Category::Storyboard))
+    return GL_NONE;
+  GLenum compressedFormat = PixelConverter::instance().getEtcFormat();
+  if(compressedFormat == GL_NONE || !EtcEncoder::isOpaque(static_cast<const char*>(pixels), size, format))
+    return GL_NONE;
+  return compressedFormat;
+}
+
+GLuint TextureManager::acquire(GLenum format, Size<int> size) {
+  std::deque<GLuint>::iterator pooled = std::find_if(pool.begin(), pool.end(), [&](GLuint texture) {
+    const Texture &info = textures[texture];
+    return info.format == format && info.size == size;
+  });
+  if(pooled == pool.end() && !pool.empty()) // storage is respecified, but the texture object is reused
+    pooled = pool.begin();
+
+  GLuint texture = 0;
+  if(pooled != pool.end()) {
+    texture = *pooled;
+    pool.erase(pooled);
+  }
+  else {
+    glGenTextures(1, &texture);
+    if(texture == 0)
+      return 0;
+    textures[texture] = Texture { Category::Pool, Filter::Nearest, GL_NONE, {0, 0}, 0, 0, false };
+  }
+  GLState::instance().bindTexture(0, texture);
+  return texture;
+}
+
+void TextureManager::upload(GLuint texture, GLenum format, Size<int> size, const void *pixels) {
+  assertCurrentEGLContext();
+
+  std::unordered_map<GLuint, Texture>::iterator search = textures.find(texture);
+  if(search == textures.end() || search->second.category == Category::Pool) {
+    LogConsole::instance().log("Upload to unknown texture " + std::to_string(texture), LogConsole::LogLevel::Error);
+    return;
+  }
+  if(format == GL_NONE) {
+    LogConsole::instance().log("Cannot upload texture of unknown pixel format", LogConsole::LogLevel::Error);
+    return;
+  }
+  GLenum compressedFormat = getCompressedFormat(search->second.category, format, size, pixels);
+  std::vector<char> converted;
+  pixels = PixelConverter::instance().convert(format, size, pixels, converted);
+  format = PixelConverter::instance().getUploadFormat(format);
+
+  GLState::instance().bindTexture(0, texture);
+  store(texture, search->second, format, size, pixels, compressedFormat);
+  account(search->second, search->second.category, GLState::instance().getTextureBytes(texture));
+  enforceBudget();
+}
+
+void TextureManager::adopt(GLuint texture, Category category, Filter filter, GLenum format, Size<int> size) {
+  assertCurrentEGLContext();
+
+  if(texture == 0 || textures.count(texture) != 0)
+    return;
+  GLState::instance().setTextureStorage(texture, format, size.width, size.height, filter == Filter::Mipmap);
+  Texture &info = textures[texture];
+  info = Texture { Category::Pool, filter, format, size, 0, 0, false };
+  account(info, category, GLState::instance().getTextureBytes(texture));
+  enforceBudget();
+}
+
+void TextureManager::store(GLuint texture, Texture &info, GLenum format, Size<int> size, const void *pixels, GLenum compressedFormat) {
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if(info.format == format && info.size == size) { // no reallocation, driver doesn't have to orphan the storage
+    if(pixels != nullptr && size.width > 0 && size.height > 0)
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.width, size.height, format, GL_UNSIGNED_BYTE, pixels);
+  }
+  else {
+    GLState::instance().texImage2D(format, size.width, size.height, pixels);
+    info.format = format;
+    info.size = size;
+  }
+  info.generation = ++lastGeneration;
+  if(compressedFormat != GL_NONE) { // blocks come with their own mip chain, one of the uncompressed content would be built for nothing
+    if(info.filter == Filter::Mipmap) {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // until collectMipmaps() uploads the blocks
+      info.mipmapsPending = true;
+    }
+    compress(texture, info, compressedFormat, format, size, pixels);
+    return;
+  }
+  if(info.filter != Filter::Mipmap)
+    return;
+
+  if(cpuMipmaps && pixels != nullptr && (size.width > 1 || size.height > 1)) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // mipmaps of previous content, or none yet, mustn't be sampled
+    info.mipmapsPending = true;
+    mipmapGenerator.generate(texture, info.generation, format, size, pixels);
+    return;
+  }
+  GLState::instance().generateMipmap();
+  if(info.mipmapsPending)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  info.mipmapsPending = false;
+}
+
+void TextureManager::compress(GLuint texture, Texture &info, GLenum compressedFormat, GLenum format, Size<int> size, const void *pixels) {
+  // encoding takes tens of ms per image, level 0 of the uncompressed content stored just before is shown until the blocks are collected
+  mipmapGenerator.compress(texture, info.generation, compressedFormat, compressionQuality, info.filter == Filter::Mipmap, format, size, pixels);
+}
+
+int TextureManager::collectMipmaps() {
+  assertCurrentEGLContext();
+
+  int count = 0;
+  for(const MipmapGenerator::Chain &chain : mipmapGenerator.collect()) {
+    std::unordered_map<GLuint, Texture>::iterator search = textures.find(chain.texture);
+    if(search == textures.end() || search->second.category == Category::Pool || search->second.generation != chain.generation)
+      continue; // released or uploaded again since
+    Texture &info = search->second;
+    if(!chain.compressed.empty()) {
+      GLState::instance().bindTexture(0, chain.texture);
+      EtcEncoder::uploadChain(chain.compressed, chain.format); // storage is respecified, mip chain of the uncompressed content isn't needed anymore
+      if(info.mipmapsPending)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      info.mipmapsPending = false;
+      info.format = chain.format;
+      GLState::instance().setTextureStorage(chain.texture, info.format, info.size.width, info.size.height, info.filter == Filter::Mipmap);
+      account(info, info.category, GLState::instance().getTextureBytes(chain.texture));
+      ++count;
+      continue;
+    }
+    if(info.filter != Filter::Mipmap || !info.mipmapsPending)
+      continue;
+
+    GLState::instance().bindTexture(0, chain.texture);
+    MipmapGenerator::uploadChain(chain.levels, chain.format);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    info.mipmapsPending = false;
+    GLState::instance().setTextureStorage(chain.texture, info.format, info.size.width, info.size.height, true);
+    account(info, info.category, GLState::instance().getTextureBytes(chain.texture));
+    ++count;
+  }
+  if(count > 0)
+    enforceBudget();
+  return count;
+}
+
+void TextureManager::account(Texture &info, Category category, size_t bytes) {
+  categoryBytes[static_cast<int>(info.category)] -= info.bytes;
+  totalBytes -= info.bytes;
+  info.category = category;
+  info.bytes = bytes;
+  categoryBytes[static_cast<int>(info.category)] += info.bytes;
+  totalBytes += info.bytes;
+}
+
+void TextureManager::release(GLuint texture) {
+  assertCurrentEGLContext();
+
+  if(texture == 0)
+    return;
+  std::unordered_map<GLuint, Texture>::iterator search = textures.find(texture);
+  if(search == textures.end()) {
+    GLState::instance().deleteTexture(texture);
+    return;
+  }
+  if(search->second.category == Category::Pool)
+    return; // released already
+
+  if(evicting || Settings::instance().texturePoolSize <= 0 || search->second.bytes == 0) {
+    destroy(texture);
+    return;
+  }
+  account(search->second, Category::Pool, search->second.bytes);
+  pool.push_back(texture);
+  if(pool.size() > static_cast<size_t>(Settings::instance().texturePoolSize)) {
+    destroy(pool.front());
+    pool.pop_front();
+  }
+}
+
+void TextureManager::destroy(GLuint texture) {
+  std::unordered_map<GLuint, Texture>::iterator search = textures.find(texture);
+  if(search != textures.end()) {
+    account(search->second, search->second.category, 0);
+    textures.erase(search);
+  }
+  GLState::instance().deleteTexture(texture);
+}
+
+void TextureManager::enforceBudget() {
+  size_t budget = Settings::instance().textureBudgetBytes;
+  if(evicting || totalBytes <= budget)
+    return;
+
+  evicting = true; // textures released by the callbacks are deleted right away
+  while(totalBytes > budget && !pool.empty()) {
+    destroy(pool.front());
+    pool.pop_front();
+  }
+  for(int category = 0; category < static_cast<int>(Category::Count) && totalBytes > budget; ++category) {
+    if(evictionCallbacks[category] != nullptr)
+      evictionCallbacks[category](totalBytes - budget);
+  }
+  evicting = false;
+
+  if(totalBytes > budget)
+    LogConsole::instance().log("Textures take " + std::to_string(totalBytes / 1024) + " KB, over the budget of " + std::to_string(budget / 1024) + " KB", LogConsole::LogLevel::Info);
+}
+
+void TextureManager::setEvictionCallback(Category category, EvictionCallback callback) {
+  evictionCallbacks[static_cast<int>(category)] = callback;
+}
+
+void TextureManager::clear() {
+  assertCurrentEGLContext();
+
+  mipmapGenerator.stop();
+  for(GLuint texture : pool)
+    destroy(texture);
+  pool.clear();
+}
+
+int TextureManager::getStats(int *stats, int count) {
+  const int available = static_cast<int>(Category::Count);
+  for(int i = 0; stats != nullptr && i < std::min(count, available); ++i)
+    stats[i] = static_cast<int>(categoryBytes[i] / 1024);
+  return available;
+}
@@ -0,0 +1,299 @@
+#include "TextureUploader.h"
+#include "EtcEncoder.h"
+#include "GLState.h"
+#include "LogConsole.h"
+#include "MipmapGenerator.h"
+#include "PixelConverter.h"
+#include "TextureManager.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <string>
+
+namespace {
+
+struct EGLFunctions {
+  EGLDisplay (*getCurrentDisplay)();
+  EGLContext (*getCurrentContext)();
+  EGLBoolean (*queryContext)(EGLDisplay, EGLContext, EGLint, EGLint*);
+  EGLBoolean (*chooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*);
+  EGLContext (*createContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint*);
+  EGLBoolean (*destroyContext)(EGLDisplay, EGLContext);
+  EGLSurface (*createPbufferSurface)(EGLDisplay, EGLConfig, const EGLint*);
+  EGLBoolean (*destroySurface)(EGLDisplay, EGLSurface);
+  EGLBoolean (*makeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+  EGLBoolean (*releaseThread)();
+  const char* (*queryString)(EGLDisplay, EGLint);
+  EGLint (*getError)();
+  EGLSyncKHR (*createSync)(EGLDisplay, EGLenum, const EGLint*);
+  EGLBoolean (*destroySync)(EGLDisplay, EGLSyncKHR);
+  EGLint (*clientWaitSync)(EGLDisplay, EGLSyncKHR, EGLint, EGLTimeKHR);
+};
+
+const EGLFunctions& egl() {
+  static EGLFunctions functions = [] {
+    EGLFunctions f;
+    *(void **) (&f.getCurrentDisplay) = Utility::getProcAddress("eglGetCurrentDisplay");
+    *(void **) (&f.getCurrentContext) = Utility::getProcAddress("eglGetCurrentContext");
+    *(void **) (&f.queryContext) = Utility::getProcAddress("eglQueryContext");
+    *(void **) (&f.chooseConfig) = Utility::getProcAddress("eglChooseConfig");
+    *(void **) (&f.createContext) = Utility::getProcAddress("eglCreateContext");
+    *(void **) (&f.destroyContext) = Utility::getProcAddress("eglDestroyContext");
+    *(void **) (&f.createPbufferSurface) = Utility::getProcAddress("eglCreatePbufferSurface");
+    *(void **) (&f.destroySurface) = Utility::getProcAddress("eglDestroySurface");
+    *(void **) (&f.makeCurrent) = Utility::getProcAddress("eglMakeCurrent");
+    *(void **) (&f.releaseThread) = Utility::getProcAddress("eglReleaseThread");
+    *(void **) (&f.queryString) = Utility::getProcAddress("eglQueryString");
+    *(void **) (&f.getError) = Utility::getProcAddress("eglGetError");
+    *(void **) (&f.createSync) = Utility::getProcAddress("eglCreateSyncKHR");
+    *(void **) (&f.destroySync) = Utility::getProcAddress("eglDestroySyncKHR");
+    *(void **) (&f.clientWaitSync) = Utility::getProcAddress("eglClientWaitSyncKHR");
+    return f;
+  }();
+  return functions;
+}
+
+bool hasEGLExtension(EGLDisplay display, const std::string &extension) {
+  const char *extensions = egl().queryString(display, EGL_EXTENSIONS);
+  if(extensions == nullptr)
+    return false;
+  std::string list = std::string(" ") + extensions + " ";
+  return list.find(" " + extension + " ") != std::string::npos;
+}
+
+} // namespace
+
+TextureUploader::TextureUploader()
+  : stopRequested(false),
+    started(false),
+    running(false),
+    fenceSync(false),
+    display(EGL_NO_DISPLAY),
+    context(EGL_NO_CONTEXT),
+    surface(EGL_NO_SURFACE) {
+}
+
+TextureUploader::~TextureUploader() {
+  stop();
+}
+
+bool TextureUploader::start() {
+  assertCurrentEGLContext();
+
+  if(running)
+    return true;
+  if(!createContext())
+    return false;
+
+  stopRequested = false;
+  started = false;
+  thread = std::thread(&TextureUploader::run, this);
+  std::unique_lock<std::mutex> lock(mutex);
+  wakeUp.wait(lock, [this] { return started; });
+  if(!running) {
+    lock.unlock();
+    thread.join();
+    destroyContext();
+    LogConsole::instance().log("Cannot make texture upload context current, uploading on the render thread", LogConsole::LogLevel::Error);
+  }
+  return running;
+}
+
+bool TextureUploader::createContext() {
+  const EGLFunctions &f = egl();
+  if(!f.getCurrentDisplay || !f.getCurrentContext || !f.queryContext || !f.chooseConfig || !f.createContext || !f.makeCurrent) {
+    LogConsole::instance().log("EGL isn't available for texture uploads", LogConsole::LogLevel::Error);
+    return false;
+  }
+
+  display = f.getCurrentDisplay();
+  EGLContext renderContext = f.getCurrentContext();
+  if(display == EGL_NO_DISPLAY || renderContext == EGL_NO_CONTEXT)
+    return false;
+
+  EGLint configId = 0;
+  EGLint clientVersion = 2;
+  f.queryContext(display, renderContext, EGL_CONFIG_ID, &configId);
+  f.queryContext(display, renderContext, EGL_CONTEXT_CLIENT_VERSION, &clientVersion);
+  EGLConfig config = nullptr; // EGL_NO_CONFIG_KHR, for contexts created without one
+  if(configId != 0) {
+    const EGLint configAttribs[] = { EGL_CONFIG_ID, configId, EGL_NONE };
+    EGLint count = 0;
+    if(!f.chooseConfig(display, configAttribs, &config, 1, &count) || count < 1)
+      return false;
+  }
+
+  const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, clientVersion, EGL_NONE };
+  context = f.createContext(display, config, renderContext, contextAttribs);
+  if(context == EGL_NO_CONTEXT) {
+    LogConsole::instance().log("Cannot create shared context for texture uploads: " + std::to_string(f.getError()), LogConsole::LogLevel::Error);
+    return false;
+  }
+
+  fenceSync = hasEGLExtension(display, "EGL_KHR_fence_sync") && f.createSync && f.destroySync && f.clientWaitSync;
+  if(!hasEGLExtension(display, "EGL_KHR_surfaceless_context") && config != nullptr) {
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    surface = f.createPbufferSurface(display, config, surfaceAttribs);
+  }
+  return true;
+}
+
+void TextureUploader::destroyContext() {
+  if(context != EGL_NO_CONTEXT)
+    egl().destroyContext(display, context);
+  if(surface != EGL_NO_SURFACE)
+    egl().destroySurface(display, surface);
+  context = EGL_NO_CONTEXT;
+  surface = EGL_NO_SURFACE;
+}
+
+void TextureUploader::stop() {
+  if(!thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  wakeUp.notify_all();
+  thread.join();
+  running = false;
+
+  deleteFinished();
+  jobs.clear();
+  destroyContext();
+}
+
+void TextureUploader::deleteFinished() {
+  for(Finished &done : finished) {
+    if(done.fence != nullptr)
+      egl().destroySync(display, done.fence);
+    glDeleteTextures(1, &done.upload.texture);
+  }
+  finished.clear();
+}
+
+void TextureUploader::upload(int tileId, const char *pixels, Size<int> size, GLuint format) {
+  if(pixels == nullptr || size.width <= 0 || size.height <= 0 || format == GL_NONE)
+    return;
+  size_t bytes = static_cast<size_t>(size.width) * size.height * GLState::getBytesPerPixel(format);
+  TextureManager &textureManager = TextureManager::instance();
+  GLenum compressedFormat = textureManager.getCompressedFormat(TextureManager::Category::Tile, format, size, pixels);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({tileId, std::vector<char>(pixels, pixels + bytes), nullptr, nullptr, size, format, textureManager.isCpuMipmaps(), compressedFormat, textureManager.getCompressionQuality()});
+  }
+  wakeUp.notify_all();
+}
+
+void TextureUploader::uploadBackground(int tileId, std::shared_ptr<const std::vector<char>> pixels, Size<int> size, GLuint format) {
+  if(!pixels || pixels->empty() || size.width <= 0 || size.height <= 0 || format == GL_NONE)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({tileId, {}, pixels, nullptr, size, format, false, GL_NONE, -1});
+  }
+  wakeUp.notify_all();
+}
+
+void TextureUploader::uploadBackground(int tileId, std::shared_ptr<TextureCache::Image> file) {
+  if(!file)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({tileId, {}, nullptr, file, file->size, file->format, false, GL_NONE, -1});
+  }
+  wakeUp.notify_all();
+}
+
+void TextureUploader::run() {
+  bool current = egl().makeCurrent(display, surface, surface, context);
+  std::unique_lock<std::mutex> lock(mutex);
+  running = current;
+  started = true;
+  wakeUp.notify_all();
+  if(!current)
+    return;
+
+  while(true) {
+    wakeUp.wait(lock, [this] { return stopRequested || !jobs.empty(); });
+    if(stopRequested)
+      break;
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    lock.unlock();
+    process(job);
+    lock.lock();
+  }
+  lock.unlock();
+
+  glFinish(); // uncollected textures are deleted by the render thread
+  egl().makeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if(egl().releaseThread)
+    egl().releaseThread();
+}
+
+void TextureUploader::process(Job &job) {
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  if(texture == 0)
+    return;
+
+  bool background = job.background != nullptr || job.file != nullptr;
+  glBindTexture(GL_TEXTURE_2D, texture); // this context has its own bindings, GLState shadows the render context only
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, background ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR); // backgrounds are never minified
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  GLenum format = job.compressedFormat;
+  if(job.file) {
+    TextureCache::uploadLevels(*job.file);
+    format = job.file->format;
+  }
+  else if(format != GL_NONE) // compressed mipmaps can't be generated by GL
+    EtcEncoder::uploadChain(EtcEncoder::encodeChain(job.pixels.data(), job.size, job.format, static_cast<EtcEncoder::Quality>(job.quality), true), format);
+  else {
+    std::vector<char> converted;
+    const char *pixels = static_cast<const char*>(PixelConverter::instance().convert(job.format, job.size, background ? job.background->data() : job.pixels.data(), converted));
+    format = PixelConverter::instance().getUploadFormat(job.format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, job.size.width, job.size.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    if(!background && job.cpuMipmaps)
+      MipmapGenerator::uploadChain(MipmapGenerator::buildChain(pixels, job.size, format), format);
+    else if(!background)
+      glGenerateMipmap(GL_TEXTURE_2D);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  void *fence = fenceSync ? egl().createSync(display, EGL_SYNC_FENCE_KHR, nullptr) : EGL_NO_SYNC_KHR;
+  if(fence == EGL_NO_SYNC_KHR)
+    glFinish();
+  else
+    glFlush(); // fence can signal only once it has been submitted
+
+  std::lock_guard<std::mutex> lock(mutex);
+  finished.push_back({{job.tileId, texture, job.size, format, background}, fence});
+}
+
+std::vector<TextureUploader::Upload> TextureUploader::collect() {
+  assertCurrentEGLContext();
+
+  std::vector<Upload> uploads;
+  std::lock_guard<std::mutex> lock(mutex);
+  while(!finished.empty()) {
+    Finished &done = finished.front();
+    if(done.fence != nullptr) {
+      if(egl().clientWaitSync(display, done.fence, 0, 0) != EGL_CONDITION_SATISFIED_KHR) // later uploads are kept in order
+        break;
+      egl().destroySync(display, done.fence);
+    }
+    uploads.push_back(done.upload);
+    finished.pop_front();
+  }
+  return uploads;
+}
+
+bool TextureUploader::hasFinished() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !finished.empty();
+}
@@ -1,12 +1,27 @@
 #include "Tile.h"
+#include "GLState.h"
 #include "ProgramBuilder.h"
 #include "Settings.h"
 #include "Utility.h"
 #include "TextRenderer.h"
 #include "LogConsole.h"
+#include "StoryboardCache.h"
+#include "TextureManager.h"
 
 #include<sstream>
 
+namespace {
+
+const GLchar* vShaderTexStr =
+#include "shaders/tile.vert"
+;
+
+const GLchar* fShaderTexStr =
+#include "shaders/tile.frag"
+;
+
+} // namespace
+
 int Tile::staticTileObjectCount = 0;
 GLuint Tile::programObject    = GL_INVALID_VALUE;
 GLuint Tile::tileSizeLoc      = GL_INVALID_VALUE;
@@ -31,11 +46,12 @@ Tile::Tile(int tileId, Position<int> position, Size<int> size, float zoom, float
             active(false),
             runningPreview(false),
             previewReady(false),
-            previewTextureId(0),
+            previewShown(false),
             bitmapHash(0),
+            getStoryboardDataCallback(nullptr),
+            storyboardFrame(0),
             textureId(0) {
-  initGL();
-  initTextures();
+  requestProgram();
   setTexture(texturePixels, textureSize, textureFormat);
   ++staticTileObjectCount;
 }
@@ -52,11 +68,12 @@ Tile::Tile(int tileId, Position<int> position, Size<int> size, float zoom, float
             active(false),
             runningPreview(false),
             previewReady(false),
-            previewTextureId(0),
+            previewShown(false),
             bitmapHash(0),
+            getStoryboardDataCallback(nullptr),
+            storyboardFrame(0),
             textureId(0) {
-  initGL();
-  initTextures();
+  requestProgram();
   ++staticTileObjectCount;
 }
 
@@ -65,26 +82,18 @@ Tile::Tile(int tileId)
             active(false),
             runningPreview(false),
             previewReady(false),
-            previewTextureId(0),
+            previewShown(false),
             bitmapHash(0),
+            getStoryboardDataCallback(nullptr),
+            storyboardFrame(0),
             textureId(0) {
-  initGL();
-  initTextures();
+  requestProgram();
   ++staticTileObjectCount;
 }
 
-void Tile::initTextures() {
-  assertCurrentEGLContext();
-
-  if(textureId == 0)
-    glGenTextures(1, &textureId);
-  if(previewTextureId == 0)
-    glGenTextures(1, &previewTextureId);
-
-  if(textureId == 0 || previewTextureId == 0) {
-    LogConsole::instance().log("-----===== INVALID VALUES FOR TILE TEXTURES! =====-----", LogConsole::LogLevel::Error);
-    throw("-----===== INVALID VALUES FOR TILE TEXTURES! =====-----");
-  }
+void Tile::requestProgram() {
+  if(programObject == GL_INVALID_VALUE) // shared by all tiles
+    ProgramBuilder::prefetchProgram("tile", vShaderTexStr, fShaderTexStr);
 }
 
 void Tile::initGL() {
@@ -93,15 +102,7 @@ void Tile::initGL() {
   if(programObject != GL_INVALID_VALUE)
     return;
 
-  const GLchar* vShaderTexStr =
-#include "shaders/tile.vert"
-;
- 
-  const GLchar* fShaderTexStr =
-#include "shaders/tile.frag"
-;
-
-  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr);
+  programObject = ProgramBuilder::buildProgram(vShaderTexStr, fShaderTexStr, "tile");
 
   tileSizeLoc = glGetUniformLocation(programObject, "u_tileSize");
   tilePositionLoc = glGetUniformLocation(programObject, "u_tilePosition");
@@ -131,13 +132,17 @@ Tile::Tile(Tile &&other) { // update this move constructor when adding new membe
     storyboardBitmap = other.storyboardBitmap;
     storytileRect = other.storytileRect;
     previewReady = other.previewReady;
-    previewTextureId = other.previewTextureId;
-    storyboardBitmap = other.storyboardBitmap;
+    previewShown = other.previewShown;
     bitmapHash = other.bitmapHash;
     getStoryboardDataCallback = other.getStoryboardDataCallback;
+    storyboard = other.storyboard;
+    storyboardFrame = other.storyboardFrame;
 
     textureId = other.textureId;
     textureFormat = other.textureFormat;
+    backgroundImage = other.backgroundImage;
+    backgroundTextureId = other.backgroundTextureId;
+    cacheKey = other.cacheKey;
 
     ++staticTileObjectCount; // prevent destructor of the object we moved from from deleting OpenGL objects with ids keept in static fields
     programObject = other.programObject;
@@ -152,7 +157,7 @@ Tile::Tile(Tile &&other) { // update this move constructor when adding new membe
     storytileRectLoc = other.storytileRectLoc;
 
     other.textureId = 0; // prevent destructor of the object we moved from from deleting the texture
-    other.previewTextureId = 0; // prevent destructor of the object we moved from from deleting the texture
+    other.backgroundTextureId = 0;
   }
 }
 
@@ -160,15 +165,12 @@ Tile::~Tile() {
   assertCurrentEGLContext();
 
   if(textureId != 0) {
-    glDeleteTextures(1, &textureId);
+    TextureManager::instance().release(textureId);
     textureId = 0;
   }
-  if(previewTextureId != 0) {
-    glDeleteTextures(1, &previewTextureId);
-    previewTextureId = 0;
-  }
+  releaseBackgroundTexture();
   if(staticTileObjectCount == 1 && programObject != GL_INVALID_VALUE) {
-    glDeleteProgram(programObject);
+    GLState::instance().deleteProgram(programObject);
     programObject = GL_INVALID_VALUE;
 
     tileSizeLoc      = GL_INVALID_VALUE;
@@ -189,20 +191,59 @@ void Tile::setTexture(char *pixels, Size<int> size, GLuint format) {
   assertCurrentEGLContext();
 
   if(textureId == 0)
-    initTextures();
+    textureId = TextureManager::instance().create(TextureManager::Category::Tile, TextureManager::Filter::Mipmap, format, size, pixels);
+  else
+    TextureManager::instance().upload(textureId, format, size, pixels);
+  if(textureId == 0)
+    return;
+
+  textureFormat = format;
+  ++textureVersion;
+}
+
+void Tile::setUploadedTexture(GLuint texture, Size<int> size, GLuint format) {
+  assertCurrentEGLContext();
 
+  if(textureId != 0)
+    TextureManager::instance().release(textureId);
+  TextureManager::instance().adopt(texture, TextureManager::Category::Tile, TextureManager::Filter::Mipmap, format, size);
+  textureId = texture;
   textureFormat = format;
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textureId);
-  glTexImage2D(GL_TEXTURE_2D, 0, format, size.width, size.height, 0, format, GL_UNSIGNED_BYTE, pixels);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
+  ++textureVersion;
+}
+
+void Tile::setBackgroundImage(BackgroundImage image) {
+  releaseBackgroundTexture();
+  backgroundImage = image;
+  ++textureVersion;
+}
+
+void Tile::uploadBackgroundTexture() {
+  assertCurrentEGLContext();
+
+  if(backgroundTextureId != 0 || !backgroundImage.pixels)
+    return;
+  backgroundTextureId = TextureManager::instance().create(TextureManager::Category::Background, TextureManager::Filter::Linear, backgroundImage.format, backgroundImage.size, backgroundImage.pixels->data()); // never minified
+  if(backgroundTextureId != 0)
+    ++textureVersion;
+}
+
+void Tile::setUploadedBackgroundTexture(GLuint texture, Size<int> size, GLuint format) {
+  assertCurrentEGLContext();
+
+  releaseBackgroundTexture();
+  TextureManager::instance().adopt(texture, TextureManager::Category::Background, TextureManager::Filter::Linear, format, size); // never minified
+  backgroundTextureId = texture;
+  ++textureVersion;
+}
+
+void Tile::releaseBackgroundTexture() {
+  assertCurrentEGLContext();
+
+  if(backgroundTextureId != 0) {
+    TextureManager::instance().release(backgroundTextureId);
+    backgroundTextureId = 0;
+  }
 }
 
 void Tile::render() {
@@ -210,6 +251,7 @@ void Tile::render() {
 
   if(textureId == 0)
     return;
+  initGL();
 
   animation.update(position, zoom, size, opacity);
 
@@ -231,36 +273,29 @@ void Tile::render() {
   float texCoord[] = { 0.0f, 0.0f,    0.0f, 1.0f,
                        1.0f, 1.0f,    1.0f, 0.0f };
 
-  glUseProgram(programObject);
+  GLState::instance().useProgram(programObject);
 
-  glUniform2f(tileSizeLoc, static_cast<float>(rightPx - leftPx), static_cast<float>(topPx - downPx));
-  glUniform2f(tilePositionLoc, static_cast<float>(leftPx), static_cast<float>(downPx));
-  glUniform1f(opacityLoc, static_cast<GLfloat>(opacity));
-  glUniform2f(viewportLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
-  glUniform1f(scaleLoc, static_cast<GLfloat>(zoom));
+  GLState::instance().uniform2f(tileSizeLoc, static_cast<float>(rightPx - leftPx), static_cast<float>(topPx - downPx));
+  GLState::instance().uniform2f(tilePositionLoc, static_cast<float>(leftPx), static_cast<float>(downPx));
+  GLState::instance().uniform1f(opacityLoc, static_cast<GLfloat>(opacity));
+  GLState::instance().uniform2f(viewportLoc, static_cast<GLfloat>(Settings::instance().viewport.width), static_cast<GLfloat>(Settings::instance().viewport.height));
+  GLState::instance().uniform1f(scaleLoc, static_cast<GLfloat>(zoom));
 
   // getTextureId() updates texture data and metadata, so it should be called before setting texture metadata for the pipeline (before setting storytileRectLoc vec4 values)
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, getCurrentTextureId());
-  glUniform1i(samplerLoc, 0);
+  GLState::instance().bindTexture(0, getCurrentTextureId());
+  GLState::instance().uniform1i(samplerLoc, 0);
 
-  if(runningPreview && previewReady)
-    glUniform4f(storytileRectLoc, storytileRect.left / storyboardBitmap.bitmapWidth, storytileRect.top / storyboardBitmap.bitmapHeight, storytileRect.width() / storyboardBitmap.bitmapWidth, storytileRect.height() / storyboardBitmap.bitmapHeight);
+  if(previewShown)
+    GLState::instance().uniform4f(storytileRectLoc, storytileRect.left / storyboardBitmap.bitmapWidth, storytileRect.top / storyboardBitmap.bitmapHeight, storytileRect.width() / storyboardBitmap.bitmapWidth, storytileRect.height() / storyboardBitmap.bitmapHeight);
   else
-    glUniform4f(storytileRectLoc, 0.0f, 0.0f, 1.0f, 1.0f);
+    GLState::instance().uniform4f(storytileRectLoc, 0.0f, 0.0f, 1.0f, 1.0f);
 
-  glEnableVertexAttribArray(posLoc);
+  GLState::instance().vertexAttribArrays({posLoc, texLoc});
   glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 0, vVertices);
-  glEnableVertexAttribArray(texLoc);
   glVertexAttribPointer(texLoc, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
 
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
 
-  glDisableVertexAttribArray(posLoc);
-  glDisableVertexAttribArray(texLoc);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glUseProgram(0);
-
   if(active)
     renderName();
 }
@@ -321,6 +356,7 @@ void Tile::runPreview(bool run) {
 }
 
 GLuint Tile::getCurrentTextureId() {
+  previewShown = false;
   if(!runningPreview) // preview isn't running
     return textureId;
 
@@ -330,6 +366,9 @@ GLuint Tile::getCurrentTextureId() {
   if(delta < Settings::instance().tilePreviewDelay) // still during delay period; moved up here so tile resources are loaded as late as possible
     return textureId;
 
+  if(storyboard.isValid())
+    return getStoryboardTextureId(now, delta);
+
   StoryboardExternData storyboardData = getStoryboardData(previewReady ? delta : std::chrono::duration_values<std::chrono::milliseconds>::zero(), id);
 
   if(!storyboardData.isStoryboardValid) { // storyboard isn't valid
@@ -346,16 +385,16 @@ GLuint Tile::getCurrentTextureId() {
   }
 
   if(!storyboardData.isFrameReady) { // frame is not ready
-    if(previewReady) // if it's not a first frame, let's use last one
-      return previewTextureId;
-    return textureId; // we haven't got any preview's frame yet, so let's stick to default tile texture
+    GLuint previewTextureId = previewReady ? StoryboardCache::instance().findTexture(bitmapHash) : 0; // if it's not a first frame, let's use last one
+    previewShown = previewTextureId != 0;
+    return previewShown ? previewTextureId : textureId; // otherwise stick to default tile texture
   }
 
-  if(storyboardData.frame.bitmapHash != bitmapHash) { // new storyboard
-    storyboardBitmap = storyboardData.frame;
-    setPreviewTexture(storyboardData.frame);
-    bitmapHash = storyboardData.frame.bitmapHash;
-  }
+  GLuint previewTextureId = StoryboardCache::instance().getTexture(storyboardData.frame);
+  if(previewTextureId == 0)
+    return textureId;
+  storyboardBitmap = storyboardData.frame;
+  bitmapHash = storyboardData.frame.bitmapHash;
   storytileRect = Rect { // update frame rectangle metadata
     .left = storyboardData.frame.rectLeft,
     .right = storyboardData.frame.rectRight,
@@ -367,31 +406,37 @@ GLuint Tile::getCurrentTextureId() {
     previewReady = true; // frame is ready and preview is running
     storyboardPreviewStartTimePoint = now - Settings::instance().tilePreviewDelay; // so we don't skip beginning part when it's being loaded
   }
+  previewShown = true;
   return previewTextureId;
 }
 
-void Tile::setPreviewTexture(SubBitmapExtern frame) {
-  assertCurrentEGLContext();
-
-  if(previewTextureId == 0)
-    initTextures();
-
-  GLuint textureFormat = ConvertFormat(frame.bitmapInfoColorType);
+GLuint Tile::getStoryboardTextureId(std::chrono::time_point<std::chrono::steady_clock> now, std::chrono::milliseconds delta) {
+  int frame = previewReady ? storyboard.getPreviewFrameAt(delta - Settings::instance().tilePreviewDelay) : 0;
+  if(frame >= storyboard.getFrameCount()) { // preview has just finished
+    runningPreview = false;
+    return textureId;
+  }
 
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, previewTextureId);
-  glTexImage2D(GL_TEXTURE_2D, 0, textureFormat, frame.bitmapWidth, frame.bitmapHeight, 0, textureFormat, GL_UNSIGNED_BYTE, frame.bitmapBytes);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glGenerateMipmap(GL_TEXTURE_2D);
+  Storyboard::Frame shown;
+  if(storyboard.getFrame(frame, shown))
+    storyboardFrame = frame;
+  else if(!previewReady || !storyboard.getFrame(storyboardFrame, shown, false)) // sheet is requested, keep last frame meanwhile
+    return textureId;
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+  storyboardBitmap.bitmapWidth = shown.sheetSize.width;
+  storyboardBitmap.bitmapHeight = shown.sheetSize.height;
+  storytileRect = shown.rect;
+  if(!previewReady) {
+    previewReady = true;
+    storyboardPreviewStartTimePoint = now - Settings::instance().tilePreviewDelay; // so we don't skip beginning part when it's being loaded
+  }
+  previewShown = true;
+  return shown.textureId;
 }
 
 StoryboardExternData Tile::getStoryboardData(std::chrono::milliseconds position, int tileId) {
+  if(!getStoryboardDataCallback)
+    return StoryboardExternData{}; // isStoryboardValid = false
   if(position < std::chrono::duration_values<std::chrono::milliseconds>::zero())
     position = std::chrono::duration_values<std::chrono::milliseconds>::zero();
   return getStoryboardDataCallback(static_cast<long long>(position.count()), id);
@@ -0,0 +1,98 @@
+#include "TileImageResizer.h"
+#include "GLState.h"
+#include "ImageResampler.h"
+#include "Settings.h"
+
+#include <algorithm>
+
+TileImageResizer::TileImageResizer()
+  : lastSequence(0),
+    stopRequested(false) {
+}
+
+TileImageResizer::~TileImageResizer() {
+  stop();
+}
+
+bool TileImageResizer::needsResize(Size<int> size) {
+  Size<int> tileSize = ImageResampler::getIngestSize(size, Settings::instance().tileImageMaxSize);
+  return !(tileSize == size);
+}
+
+uint64_t TileImageResizer::resize(int tileId, const char *pixels, Size<int> size, GLuint format) {
+  size_t bytes = static_cast<size_t>(size.width) * size.height * GLState::getBytesPerPixel(format);
+  uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    sequence = ++lastSequence;
+    Job job { tileId, sequence, std::vector<char>(pixels, pixels + bytes), size, format };
+    std::deque<Job>::iterator queued = std::find_if(jobs.begin(), jobs.end(), [tileId](const Job &other) { return other.tileId == tileId; });
+    if(queued != jobs.end()) // image replaced before it was resized
+      *queued = std::move(job);
+    else
+      jobs.push_back(std::move(job));
+    if(!thread.joinable()) {
+      stopRequested = false;
+      thread = std::thread(&TileImageResizer::run, this);
+    }
+  }
+  wakeUp.notify_all();
+  return sequence;
+}
+
+void TileImageResizer::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    wakeUp.wait(lock, [this] { return stopRequested || !jobs.empty(); });
+    if(stopRequested)
+      break;
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    lock.unlock();
+    Result result = process(job);
+    lock.lock();
+    finished.push_back(std::move(result));
+  }
+}
+
+TileImageResizer::Result TileImageResizer::process(Job &job) {
+  Result result { job.tileId, job.sequence, std::make_shared<std::vector<char>>(), job.size, job.format, nullptr, job.size };
+  result.size = ImageResampler::getIngestSize(job.size, Settings::instance().tileImageMaxSize);
+  *result.pixels = ImageResampler::resize(job.pixels.data(), job.size, job.format, result.size);
+
+  // selected tile is also drawn full screen by Background, a tile sized image would be upscaled there
+  result.backgroundSize = ImageResampler::getIngestSize(job.size, Settings::instance().backgroundImageMaxSize);
+  if(result.backgroundSize.width > result.size.width || result.backgroundSize.height > result.size.height) {
+    result.backgroundPixels = std::make_shared<std::vector<char>>();
+    if(!(result.backgroundSize == job.size))
+      *result.backgroundPixels = ImageResampler::resize(job.pixels.data(), job.size, job.format, result.backgroundSize);
+    else
+      *result.backgroundPixels = std::move(job.pixels);
+  }
+  return result;
+}
+
+std::vector<TileImageResizer::Result> TileImageResizer::collect() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<Result> results(std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.end()));
+  finished.clear();
+  return results;
+}
+
+bool TileImageResizer::hasFinished() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !finished.empty();
+}
+
+void TileImageResizer::stop() {
+  if(!thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopRequested = true;
+  }
+  wakeUp.notify_all();
+  thread.join();
+  jobs.clear();
+  finished.clear();
+}
@@ -1,5 +1,6 @@
 #include <string>
 #include <sstream>
+#include <dlfcn.h>
 
 #include "Utility.h"
 #include "GLES.h"
@@ -7,7 +8,6 @@
 #include "log.h"
 
 #ifdef _DEBUG
-#include <dlfcn.h>
 
 namespace {
 
@@ -69,3 +69,39 @@ std::string Utility::getGLErrorString(int err) {
   return "Unknown Error";
 }
 
+
+bool Utility::hasGLExtension(const std::string &extension) {
+  assertCurrentEGLContext();
+
+  const char *extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if(extensions == nullptr)
+    return false;
+  std::istringstream iss(extensions);
+  std::string name;
+  while(iss >> name)
+    if(name == extension)
+      return true;
+  return false;
+}
+
+void* Utility::getProcAddress(const char *name) {
+  static void* (*eglGetProcAddressFunc)(const char*) = nullptr;
+  if(eglGetProcAddressFunc == nullptr) {
+    void *handle = dlopen("libEGL.so", RTLD_LAZY);
+    if(handle == nullptr)
+      handle = dlopen("libEGL.so.1", RTLD_LAZY);
+    if(handle != nullptr)
+      *(void **) (&eglGetProcAddressFunc) = dlsym(handle, "eglGetProcAddress");
+  }
+  void *proc = eglGetProcAddressFunc != nullptr ? eglGetProcAddressFunc(name) : nullptr;
+  return proc != nullptr ? proc : dlsym(RTLD_DEFAULT, name);
+}
+
+uint64_t Utility::fnv1a(uint64_t hash, const void *data, size_t length) {
+  const unsigned char *bytes = static_cast<const unsigned char*>(data);
+  for(size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
@@ -0,0 +1,72 @@
+#include "WorkScheduler.h"
+#include "LogConsole.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+WorkScheduler::WorkScheduler()
+  : budget(Settings::instance().deferredWorkBudget),
+    frameStart(std::chrono::steady_clock::now()),
+    waitingSince(frameStart) {
+}
+
+void WorkScheduler::schedule(Priority priority, Group group, uint64_t key, Task task) {
+  if(!hasPending())
+    waitingSince = std::chrono::steady_clock::now();
+
+  if(group != Group::None) {
+    for(std::deque<Entry> &queue : queues) {
+      std::deque<Entry>::iterator queued = std::find_if(queue.begin(), queue.end(), [group, key](const Entry &entry) { return entry.group == group && entry.key == key; });
+      if(queued != queue.end()) { // requested again every frame until it runs, it keeps its place
+        queued->task = std::move(task);
+        return;
+      }
+    }
+  }
+  queues[static_cast<int>(priority)].push_back({group, key, std::move(task)});
+}
+
+bool WorkScheduler::pop(Entry &entry) {
+  for(std::deque<Entry> &queue : queues) {
+    if(!queue.empty()) {
+      entry = std::move(queue.front());
+      queue.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+int WorkScheduler::run() {
+  bool overdue = std::chrono::steady_clock::now() - waitingSince >= Settings::instance().deferredWorkMaxDelay;
+  int count = 0;
+  Entry entry;
+  while((isWithinBudget() || (overdue && count == 0)) && pop(entry)) {
+    try {
+      entry.task();
+    } catch(const std::exception &e) {
+      LogConsole::instance().log(std::string("Deferred task failed: ") + e.what(), LogConsole::LogLevel::Error);
+    } catch(...) {
+      LogConsole::instance().log("Deferred task failed: unknown exception", LogConsole::LogLevel::Error);
+    }
+    ++count;
+  }
+  if(count > 0)
+    waitingSince = std::chrono::steady_clock::now();
+  return count;
+}
+
+bool WorkScheduler::hasPending() {
+  for(std::deque<Entry> &queue : queues) {
+    if(!queue.empty())
+      return true;
+  }
+  return false;
+}
+
+void WorkScheduler::clear() {
+  for(std::deque<Entry> &queue : queues)
+    queue.clear();
+}
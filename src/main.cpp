@@ -1,9 +1,18 @@
 #include <cstdio>
+#include <algorithm>
 
 #include "GLES.h"
 #include "ExternStructs.h"
 #include "CommonStructs.h"
+#include "EtcEncoder.h"
+#include "GLState.h"
 #include "Menu.h"
+#include "MipmapGenerator.h"
+#include "ProgramCache.h"
+#include "StartupReport.h"
+#include "StoryboardCache.h"
+#include "TextureCache.h"
+#include "TextureManager.h"
 #include "Utility.h"
 #include "version.h"
 
@@ -15,19 +24,46 @@
 extern "C" {
 #endif
 EXPORT_API void Create(); // needs to be run from eglContext synced methods
+EXPORT_API void SetProgramCacheDirectory(char* path, int pathLen); // writable directory for compiled shader programs, call before Create()
+EXPORT_API void SetTextureCacheDirectory(char* path, int pathLen); // writable directory for processed tile images, see SetTileDataCached()
+EXPORT_API int GetStartupReport(char* report, int reportLen); // copies startup timings as text, returns full length of the report
 EXPORT_API void Terminate(); // needs to be run from eglContext synced methods
 EXPORT_API void Draw(); // needs to be run from eglContext synced methods
+EXPORT_API int NeedsRedraw(); // returns 0 if the next Draw() would produce the same frame as the last one
+EXPORT_API void SetPartialRedraw(int enable); // host has to preserve back buffer content (EGL_BUFFER_PRESERVED or buffer age) when enabled
+EXPORT_API int GetDamageRegion(int* rects, int count); // {x, y, width, height} rectangles redrawn by last Draw(), origin in the bottom-left corner
+EXPORT_API int GetGLStateStats(int* stats, int count); // {issued, suppressed} GL calls for programs, textures, vertex attribs, blend func, enable/disable, uniforms; returns number of values
+EXPORT_API int GetStoryboardCacheStats(int* stats, int count); // hits, misses, evictions, cached sheets, cached KB; returns number of values
+EXPORT_API int GetTextureMemoryStats(int* stats, int count); // KB of textures for tiles, storyboards, icons, logo, texts, glyphs, layers, graphs, console, pool, backgrounds; returns number of values
+EXPORT_API void SetCpuMipmaps(int enable); // mipmaps of tiles, icons, logo and storyboards are built on a worker thread instead of by glGenerateMipmap
+EXPORT_API int BenchmarkMipmaps(int width, int height, int format, int iterations, int* results, int count); // average us per mip chain: glGenerateMipmap, scalar CPU, SIMD CPU, level uploads; returns number of values, needs to be run from eglContext synced methods
+EXPORT_API void SetTextureCompression(int quality); // opaque tiles and storyboards are ETC compressed when ETC2 or ETC1 is supported: -1 off, 0 fast, 1 normal, 2 high (slow)
+EXPORT_API int GetTextureCacheStats(int* stats, int count); // hits, misses, files written, files deleted over the budget; returns number of values
+EXPORT_API int BenchmarkTextureCompression(int width, int height, int quality, int threads, int* results, int count); // encode time in us, kilopixels per second, PSNR in 1/100 dB; returns number of values
 
 EXPORT_API int AddTile(); // needs to be run from eglContext synced methods
 EXPORT_API void SetTileData(TileExternData tileExternData); // needs to be run from eglContext synced methods
+EXPORT_API int SetTileDataCached(TileExternData tileExternData, unsigned long long hash); // with pixels nullptr, the image is loaded from the texture cache by the host's content hash (never 0), returns 0 on a miss; with pixels, works like SetTileData() and stores the image; needs to be run from eglContext synced methods
+EXPORT_API int SetBackgroundUploads(int enable); // tile images are uploaded by a thread with a context sharing the current one; returns 1 if it runs, needs to be run from eglContext synced methods
+EXPORT_API void SetDeferredWorkBudget(int microseconds); // time in a frame for inline texture uploads and text rasterization, the rest is deferred to later frames
 EXPORT_API int AddFont(char *data, int size); // needs to be run from eglContext synced methods
 EXPORT_API void SetIcon(ImageExternData image); // needs to be run from eglContext synced methods
 EXPORT_API void SetLoaderLogo(ImageExternData image); // needs to be run from eglContext synced methods
 EXPORT_API void SetSeekPreviewCallback(StoryboardExternData (*getSeekPreviewStoryboardData)());
+EXPORT_API void SetStoryboard(int storyboardId, StoryboardLayoutExternData layout); // tile id or -1 for the seek preview; replaces the storyboard callback while set
+EXPORT_API void SetStoryboardSheet(int storyboardId, int sheetIndex, ImageExternData sheet); // needs to be run from eglContext synced methods
+EXPORT_API void SetJankCallback(void (*jankCallback)(JankInfo jankInfo)); // called from Draw() when a frame takes more than 1.5x the frame budget
+EXPORT_API FrameStatsExternData GetFrameStats(int reset); // frame time percentiles and jank counters since start or last reset
+EXPORT_API int StartProcessSampler(int intervalMs); // samples CPU %, RSS MB, thread count and texture MB on a native thread; returns id of the first of 4 consecutive graphs
+EXPORT_API void StopProcessSampler();
 
 EXPORT_API void ShowMenu(int enable);
 EXPORT_API void ShowLoader(int enabled, int percent);
 EXPORT_API void ShowSubtitle(int duration, char* text, int textLen);
+EXPORT_API void AddSubtitleCues(SubtitleCueExternData* cues, int count); // cues are shown by media time, upcoming ones are rasterized on idle frames before they are due
+EXPORT_API int LoadSubtitleTrack(char* data, int dataLen, int format); // format: 0 - SRT, 1 - WebVTT; parsed cues are added like AddSubtitleCues() ones, returns their count
+EXPORT_API void ClearSubtitleCues();
+EXPORT_API void SetMediaTime(int time, int playing); // ms; while playing, media time advances on its own until next call
 EXPORT_API void SelectTile(int tileNo, int runPreview);
 EXPORT_API void UpdatePlaybackControls(PlaybackExternData playbackExternData);
 EXPORT_API void SetFooter(char* footer, int footerLen);
@@ -45,7 +81,8 @@ EXPORT_API void UpdateGraphValues(int graphId, float* values, int valuesCount);
 EXPORT_API void UpdateGraphValue(int graphId, float value);
 EXPORT_API void UpdateGraphRange(int graphId, float minVal, float maxVal);
 EXPORT_API void SetLogConsoleVisibility(int visible);
-EXPORT_API void PushLog(char* log, int logLen);
+EXPORT_API void PushLog(char* log, int logLen); // can be called from any thread
+EXPORT_API long long GetDroppedLogCount(); // log lines pushed out of the fixed-size console buffer by newer ones
 EXPORT_API void ShowAlert(AlertExternData alertExternData);
 EXPORT_API void HideAlert();
 EXPORT_API int IsAlertVisible();
@@ -57,18 +94,52 @@ Menu *menu = nullptr;
 
 void Create()
 {
+  StartupReport::instance().start();
   initEGLFunctions();
   setCurrentEGLContext();
 
   if(menu != nullptr)
     delete menu;
   menu = new Menu();
+  StartupReport::instance().addEvent("menu created");
+}
+
+void SetProgramCacheDirectory(char* path, int pathLen)
+{
+  ProgramCache::instance().setDirectory(std::string(path, pathLen));
+}
+
+void SetTextureCacheDirectory(char* path, int pathLen)
+{
+  TextureCache::instance().setDirectory(std::string(path, pathLen));
+}
+
+int GetStartupReport(char* report, int reportLen)
+{
+  std::string text = StartupReport::instance().toString();
+  if(report != nullptr && reportLen > 0) {
+    int n = std::min(static_cast<int>(text.size()), reportLen - 1);
+    text.copy(report, n);
+    report[n] = '\0';
+  }
+  return static_cast<int>(text.size());
 }
 
 void Terminate()
 {
   if(menu != nullptr)
     delete menu;
+  TextureManager::instance().clear(); // textures released by the menu are pooled
+}
+
+int SetBackgroundUploads(int enable)
+{
+  return static_cast<int>(menu->setBackgroundUploads(enable));
+}
+
+void SetDeferredWorkBudget(int microseconds)
+{
+  menu->setDeferredWorkBudget(std::chrono::microseconds(std::max(microseconds, 0)));
 }
 
 void ShowMenu(int enable)
@@ -93,6 +164,18 @@ void SetTileData(TileExternData tileExternData)
       tileExternData.getStoryboardData});
 }
 
+int SetTileDataCached(TileExternData tileExternData, unsigned long long hash)
+{
+  return menu->setCachedTileData(TileData {
+      tileExternData.tileId,
+      tileExternData.pixels,
+      {tileExternData.width, tileExternData.height},
+      std::string(tileExternData.name, tileExternData.nameLen),
+      std::string(tileExternData.desc, tileExternData.descLen),
+      ConvertFormat(tileExternData.format),
+      tileExternData.getStoryboardData}, hash);
+}
+
 int AddFont(char *data, int size)
 {
   return menu->addFont(data, size);
@@ -149,11 +232,91 @@ void Draw()
   menu->render();
 }
 
+int NeedsRedraw()
+{
+  return static_cast<int>(menu->needsRedraw());
+}
+
+void SetPartialRedraw(int enable)
+{
+  menu->setPartialRedraw(static_cast<bool>(enable));
+}
+
+int GetDamageRegion(int* rects, int count)
+{
+  return menu->getDamageRegion(rects, count);
+}
+
+int GetGLStateStats(int* stats, int count)
+{
+  return GLState::instance().getStats(stats, count);
+}
+
+int GetStoryboardCacheStats(int* stats, int count)
+{
+  return StoryboardCache::instance().getStats(stats, count);
+}
+
+int GetTextureMemoryStats(int* stats, int count)
+{
+  return TextureManager::instance().getStats(stats, count);
+}
+
+void SetCpuMipmaps(int enable)
+{
+  TextureManager::instance().setCpuMipmaps(enable);
+}
+
+int BenchmarkMipmaps(int width, int height, int format, int iterations, int* results, int count)
+{
+  return MipmapGenerator::benchmark({width, height}, ConvertFormat(format), iterations, results, count);
+}
+
+int GetTextureCacheStats(int* stats, int count)
+{
+  return TextureCache::instance().getStats(stats, count);
+}
+
+void SetTextureCompression(int quality)
+{
+  TextureManager::instance().setCompression(quality < 0 ? -1 : std::min(quality, static_cast<int>(EtcEncoder::Quality::High)));
+}
+
+int BenchmarkTextureCompression(int width, int height, int quality, int threads, int* results, int count)
+{
+  return EtcEncoder::benchmark({width, height}, static_cast<EtcEncoder::Quality>(std::min(std::max(quality, 0), static_cast<int>(EtcEncoder::Quality::High))), threads, results, count);
+}
+
 void ShowSubtitle(int duration, char* text, int textLen)
 {
   menu->showSubtitle(duration, std::string(text, textLen));
 }
 
+void AddSubtitleCues(SubtitleCueExternData* cues, int count)
+{
+  std::vector<Subtitles::Cue> added;
+  for(int i = 0; i < count; ++i)
+    added.push_back({ std::chrono::milliseconds(cues[i].startTime), std::chrono::milliseconds(cues[i].endTime), std::string(cues[i].text, cues[i].textLen) });
+  menu->addSubtitleCues(added);
+}
+
+int LoadSubtitleTrack(char* data, int dataLen, int format)
+{
+  if(format < 0 || format >= static_cast<int>(SubtitleTrack::Format::Unknown) || dataLen < 0)
+    return 0;
+  return menu->loadSubtitleTrack(data, static_cast<size_t>(dataLen), static_cast<SubtitleTrack::Format>(format));
+}
+
+void ClearSubtitleCues()
+{
+  menu->clearSubtitleCues();
+}
+
+void SetMediaTime(int time, int playing)
+{
+  menu->setMediaTime(time, playing);
+}
+
 int OpenGLLibVersion() {
 #ifdef VERSION
   return VERSION;
@@ -218,6 +381,10 @@ void PushLog(char* log, int logLen) {
   menu->pushLog(std::string(log, logLen));
 }
 
+long long GetDroppedLogCount() {
+  return static_cast<long long>(menu->getDroppedLogs());
+}
+
 
 void ShowAlert(AlertExternData alertExternData) {
   menu->showAlert(AlertData {
@@ -237,3 +404,39 @@ int IsAlertVisible() {
 void SetSeekPreviewCallback(StoryboardExternData (*getSeekPreviewStoryboardData)()) {
   menu->setSeekPreviewCallback(getSeekPreviewStoryboardData);
 }
+
+void SetStoryboard(int storyboardId, StoryboardLayoutExternData layout) {
+  menu->setStoryboard(storyboardId, Storyboard::Layout {
+      layout.sheetCount,
+      layout.columns,
+      layout.rows,
+      layout.frameCount,
+      std::chrono::milliseconds(layout.frameIntervalMs),
+      std::chrono::milliseconds(layout.previewFrameMs),
+      layout.requestSheet});
+}
+
+void SetStoryboardSheet(int storyboardId, int sheetIndex, ImageExternData sheet) {
+  menu->setStoryboardSheet(storyboardId, sheetIndex, ImageData {
+      sheet.id,
+      sheet.pixels,
+      {sheet.width, sheet.height},
+      ConvertFormat(sheet.format)});
+}
+
+void SetJankCallback(void (*jankCallback)(JankInfo jankInfo)) {
+  menu->setJankCallback(jankCallback);
+}
+
+FrameStatsExternData GetFrameStats(int reset) {
+  FrameStats::Summary summary = menu->getFrameStats(reset != 0);
+  return FrameStatsExternData { summary.frames, summary.p50, summary.p90, summary.p99, summary.max, summary.jankFrames, summary.severeJankFrames };
+}
+
+int StartProcessSampler(int intervalMs) {
+  return menu->startProcessSampler(intervalMs);
+}
+
+void StopProcessSampler() {
+  menu->stopProcessSampler();
+}
@@ -0,0 +1,107 @@
+// Parses SRT and WebVTT tracks with overlapping cues and checks which cues SubtitleTrack::find reports as shown,
+// in start order, around the starts and ends of the overlaps.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SubtitleTrack.h"
+
+namespace {
+
+const char SRT[] =
+  "1\n"
+  "00:00:01,000 --> 00:00:05,000\n"
+  "SIGN: EXIT\n"
+  "\n"
+  "2\n"
+  "00:00:02,000 --> 00:00:03,000\n"
+  "- Where are we?\n"
+  "\n"
+  "3\n"
+  "00:00:02,500 --> 00:00:04,000\n"
+  "- No idea.\n"
+  "\n"
+  "4\n"
+  "00:00:06,000 --> 00:00:07,000\n"
+  "Later\n";
+
+const char VTT[] =
+  "WEBVTT\n"
+  "\n"
+  "00:10.000 --> 00:20.000\n"
+  "Long cue\n"
+  "\n"
+  "00:11.000 --> 00:12.000\n"
+  "Short &amp; inside\n";
+
+struct Lookup {
+  int time; // ms
+  std::vector<std::string> texts; // expected, in start order
+};
+
+bool check(SubtitleTrack &track, const char *name, const std::vector<Lookup> &lookups) {
+  bool passed = true;
+  for(const Lookup &lookup : lookups) {
+    std::vector<std::string> texts;
+    for(size_t cue : track.find(std::chrono::milliseconds(lookup.time)))
+      texts.push_back(track.getText(cue));
+    if(texts != lookup.texts) {
+      std::printf("FAIL: %s at %d ms: %zu cues shown, %zu expected\n", name, lookup.time, texts.size(), lookup.texts.size());
+      for(const std::string &text : texts)
+        std::printf("  shown: %s\n", text.c_str());
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+} // namespace
+
+int main() {
+  bool passed = true;
+
+  SubtitleTrack srt;
+  if(srt.load(SRT, std::strlen(SRT), SubtitleTrack::Format::Srt) != 4) {
+    std::printf("FAIL: SRT cues not parsed\n");
+    return 1;
+  }
+  passed = check(srt, "SRT", {
+    { 500, {} },
+    { 1000, { "SIGN: EXIT" } },
+    { 2000, { "SIGN: EXIT", "- Where are we?" } },
+    { 2700, { "SIGN: EXIT", "- Where are we?", "- No idea." } },
+    { 3000, { "SIGN: EXIT", "- No idea." } }, // ends are exclusive
+    { 4500, { "SIGN: EXIT" } },
+    { 5500, {} },
+    { 6500, { "Later" } },
+  }) && passed;
+
+  SubtitleTrack vtt;
+  if(vtt.load(VTT, std::strlen(VTT), SubtitleTrack::Format::WebVtt) != 2) {
+    std::printf("FAIL: WebVTT cues not parsed\n");
+    return 1;
+  }
+  passed = check(vtt, "WebVTT", {
+    { 10500, { "Long cue" } },
+    { 11500, { "Long cue", "Short & inside" } },
+    { 12500, { "Long cue" } },
+  }) && passed;
+
+  // cues added out of order are sorted by start
+  SubtitleTrack added;
+  added.add(std::chrono::milliseconds(300), std::chrono::milliseconds(900), "second");
+  added.add(std::chrono::milliseconds(100), std::chrono::milliseconds(1000), "first");
+  added.add(std::chrono::milliseconds(500), std::chrono::milliseconds(600), "third");
+  passed = check(added, "added", {
+    { 550, { "first", "second", "third" } },
+    { 950, { "first" } },
+  }) && passed;
+
+  if(!passed)
+    return 1;
+  std::printf("PASS\n");
+  return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef _SURFACELESS_CONTEXT_H_
+#define _SURFACELESS_CONTEXT_H_
+
+// GLES2 context without a surface on Mesa's surfaceless EGL platform, for tests run on desktops without a display.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "Utility.h"
+
+const int SKIPPED = 77; // exit code of a test which can't run here, see SKIP_RETURN_CODE in CMakeLists.txt
+
+class SurfacelessContext {
+private:
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+
+public:
+  SurfacelessContext(const SurfacelessContext&) = delete;
+  SurfacelessContext& operator=(const SurfacelessContext&) = delete;
+  SurfacelessContext() {}
+
+  ~SurfacelessContext() {
+    if(context != EGL_NO_CONTEXT) {
+      eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      eglDestroyContext(display, context);
+    }
+    if(display != EGL_NO_DISPLAY)
+      eglTerminate(display);
+  }
+
+  bool create() { // made current and registered with setCurrentEGLContext()
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if(getPlatformDisplay == nullptr)
+      return false;
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_ES_API))
+      return false;
+
+    const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT, EGL_RED_SIZE, 8, EGL_ALPHA_SIZE, 8, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint count = 0;
+    if(!eglChooseConfig(display, configAttribs, &config, 1, &count) || count < 1)
+      return false;
+    const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+      return false;
+    initEGLFunctions();
+    setCurrentEGLContext();
+    return true;
+  }
+};
+
+#endif // _SURFACELESS_CONTEXT_H_
@@ -0,0 +1,118 @@
+// Runs the mipmap and ETC benchmarks behind BenchmarkMipmaps and BenchmarkTextureCompression on a Mesa surfaceless
+// EGL display. Checks that SIMD mip chains equal scalar ones byte for byte and that encoded images decode
+// above a PSNR threshold per quality. Exits with 77 (skipped) when the surfaceless platform isn't available.
+
+#include <cstdio>
+#include <vector>
+
+#include "EtcEncoder.h"
+#include "MipmapGenerator.h"
+#include "SurfacelessContext.h"
+
+namespace {
+
+std::vector<char> createImage(Size<int> size, int bytesPerPixel) {
+  std::vector<char> pixels(static_cast<size_t>(size.width) * size.height * bytesPerPixel);
+  uint32_t state = 12345; // noise on top of gradients, so rounding differences show up
+  for(size_t i = 0; i < pixels.size(); ++i) {
+    state = state * 1664525 + 1013904223;
+    size_t pixel = i / bytesPerPixel;
+    int x = static_cast<int>(pixel % size.width), y = static_cast<int>(pixel / size.width);
+    pixels[i] = static_cast<char>(x * 3 + y * 2 + static_cast<int>(i % bytesPerPixel) * 40 + static_cast<int>(state >> 28));
+  }
+  return pixels;
+}
+
+bool checkChains() {
+  struct Case {
+    GLenum format;
+    int bytesPerPixel;
+    Size<int> size;
+  };
+  const Case cases[] = {
+    { GL_RGBA, 4, Size<int>(64, 64) },
+    { GL_RGBA, 4, Size<int>(61, 37) }, // odd sizes drop the last row or column
+    { GL_BGRA_EXT, 4, Size<int>(37, 61) },
+    { GL_RGB, 3, Size<int>(61, 37) },
+    { GL_RGBA, 4, Size<int>(1, 9) },
+  };
+
+  bool passed = true;
+  for(const Case &test : cases) {
+    std::vector<char> pixels = createImage(test.size, test.bytesPerPixel);
+    std::vector<MipmapGenerator::Level> scalar = MipmapGenerator::buildChain(pixels.data(), test.size, test.format, false);
+    std::vector<MipmapGenerator::Level> simd = MipmapGenerator::buildChain(pixels.data(), test.size, test.format, true);
+    bool same = !scalar.empty() && scalar.size() == simd.size();
+    for(size_t i = 0; same && i < scalar.size(); ++i)
+      same = scalar[i].size == simd[i].size && scalar[i].pixels == simd[i].pixels;
+    if(!same) {
+      std::printf("FAIL: SIMD mip chain of %dx%d format 0x%x differs from scalar\n", test.size.width, test.size.height, test.format);
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+bool checkMipmapBenchmark() {
+  int results[4] = {};
+  if(MipmapGenerator::benchmark(Size<int>(512, 512), GL_RGBA, 2, results, 4) != 4) {
+    std::printf("FAIL: mipmap benchmark didn't run\n");
+    return false;
+  }
+  std::printf("mipmaps 512x512 us: glGenerateMipmap %d, scalar %d, SIMD %d, upload %d\n", results[0], results[1], results[2], results[3]);
+  for(int result : results) {
+    if(result < 0) {
+      std::printf("FAIL: negative mipmap benchmark time\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool checkCompression() {
+  struct Case {
+    EtcEncoder::Quality quality;
+    const char *name;
+    int minPsnr; // 1/100 dB, on the benchmark's photo-like test image
+  };
+  const Case cases[] = {
+    { EtcEncoder::Quality::Fast, "fast", 2400 },
+    { EtcEncoder::Quality::Normal, "normal", 2700 },
+    { EtcEncoder::Quality::High, "high", 2750 },
+  };
+
+  bool passed = true;
+  for(const Case &test : cases) {
+    int results[3] = {};
+    if(EtcEncoder::benchmark(Size<int>(256, 256), test.quality, 2, results, 3) != 3) {
+      std::printf("FAIL: %s ETC benchmark didn't run\n", test.name);
+      passed = false;
+      continue;
+    }
+    std::printf("ETC %s 256x256: %d us, %d kilopixels/s, PSNR %d.%02d dB\n", test.name, results[0], results[1], results[2] / 100, results[2] % 100);
+    if(results[2] < test.minPsnr) {
+      std::printf("FAIL: %s ETC PSNR below %d.%02d dB\n", test.name, test.minPsnr / 100, test.minPsnr % 100);
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+} // namespace
+
+int main() {
+  bool passed = checkChains(); // no GL needed
+
+  SurfacelessContext context;
+  if(!context.create()) {
+    std::printf("SKIP: no Mesa surfaceless EGL display\n");
+    return passed ? SKIPPED : 1;
+  }
+  passed = checkMipmapBenchmark() && passed;
+  passed = checkCompression() && passed;
+
+  if(!passed)
+    return 1;
+  std::printf("PASS\n");
+  return 0;
+}
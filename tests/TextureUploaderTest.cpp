@@ -0,0 +1,96 @@
+// Uploads a tile image through TextureUploader on a Mesa surfaceless EGL display, waits until its fence
+// lets collect() return it and reads the texture back in the render context through a framebuffer.
+// Exits with 77 (skipped) when the surfaceless platform isn't available.
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "GLES.h"
+#include "SurfacelessContext.h"
+#include "TextureUploader.h"
+
+namespace {
+
+std::vector<char> createImage(Size<int> size) {
+  std::vector<char> pixels(static_cast<size_t>(size.width) * size.height * 4);
+  for(int y = 0; y < size.height; ++y) {
+    for(int x = 0; x < size.width; ++x) {
+      char *pixel = &pixels[(static_cast<size_t>(y) * size.width + x) * 4];
+      pixel[0] = static_cast<char>(x * 4);
+      pixel[1] = static_cast<char>(y * 6);
+      pixel[2] = static_cast<char>((x + y) * 3);
+      pixel[3] = static_cast<char>(255);
+    }
+  }
+  return pixels;
+}
+
+bool readBack(GLuint texture, Size<int> size, std::vector<char> &pixels) {
+  GLuint framebuffer = 0;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+  bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  if(complete) {
+    pixels.resize(static_cast<size_t>(size.width) * size.height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.width, size.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &framebuffer);
+  return complete && glGetError() == GL_NO_ERROR;
+}
+
+} // namespace
+
+int main() {
+  SurfacelessContext context;
+  if(!context.create()) {
+    std::printf("SKIP: no Mesa surfaceless EGL display\n");
+    return SKIPPED;
+  }
+
+  int result = 1;
+  {
+    TextureUploader uploader;
+    if(!uploader.start()) {
+      std::printf("FAIL: uploader didn't start\n");
+      return 1;
+    }
+
+    const int tileId = 7;
+    const Size<int> size(61, 37); // odd size, rows aren't 4-byte aligned
+    std::vector<char> pixels = createImage(size);
+    uploader.upload(tileId, pixels.data(), size, GL_RGBA);
+
+    std::vector<TextureUploader::Upload> uploads;
+    std::chrono::time_point<std::chrono::steady_clock> deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(uploads.empty() && std::chrono::steady_clock::now() < deadline) {
+      uploads = uploader.collect(); // returns the texture only once its fence has signaled
+      if(uploads.empty())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<char> uploaded;
+    if(uploads.size() != 1)
+      std::printf("FAIL: %zu uploads collected\n", uploads.size());
+    else if(uploads[0].tileId != tileId || !(uploads[0].size == size) || uploads[0].format != GL_RGBA)
+      std::printf("FAIL: upload of tile %d, %dx%d, format 0x%x\n", uploads[0].tileId, uploads[0].size.width, uploads[0].size.height, uploads[0].format);
+    else if(!readBack(uploads[0].texture, size, uploaded))
+      std::printf("FAIL: texture can't be read back in the render context\n");
+    else if(uploaded != pixels)
+      std::printf("FAIL: texture content differs\n");
+    else
+      result = 0;
+
+    for(TextureUploader::Upload &upload : uploads)
+      glDeleteTextures(1, &upload.texture);
+    uploader.stop();
+  }
+
+  if(result == 0)
+    std::printf("PASS\n");
+  return result;
+}